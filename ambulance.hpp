@@ -2,6 +2,12 @@
 #define AMBULANCE_HPP
 
 #include "utils.hpp"
+#include "events.hpp"   // change notifications
+#include "cdc.hpp"      // change-data-capture stream
+#include "crew.hpp"     // crews assigned to the units
+#include "staging.hpp"  // standby positions from incident history
+#include "roads.hpp"    // travel times over the road network
+#include "memory.hpp"   // accounting and the role's memory limit
 
 #define AMB_FILE "ambulances.txt"
 
@@ -137,7 +143,7 @@ struct AmbulanceCQueue {
     void loadFromFile(const char* filename) {
         ifstream in(filename);
         if (!in) {
-            cout << "[Info] " << filename
+            load_log() << "[Info] " << filename
                  << " not found. Starting with empty ambulances.\n";
             clear();
             return;
@@ -150,7 +156,7 @@ struct AmbulanceCQueue {
             strncpy(a.plate, plate.c_str(), sizeof(a.plate) - 1);
             if (!enqueue(a)) break; // stop if the queue is full
         }
-        cout << "[OK] Loaded ambulances from " << filename
+        load_log() << "[OK] Loaded ambulances from " << filename
              << " (count=" << count << ")\n";
     }
 };
@@ -163,6 +169,17 @@ struct AmbulanceCQueue {
 // --------------------------------------------------------------------------
 inline AmbulanceCQueue gAmb;
 
+inline MemRegister gAmbMem(MEM_AMBULANCES, "rotation array",
+                           [] { return sizeof(gAmb); });
+
+// Plates in rotation order (the units the crew roster must staff)
+inline vector<string> amb_plates() {
+    vector<string> plates;
+    for (int i = 0; i < gAmb.count; ++i)
+        plates.push_back(gAmb.data[(gAmb.head + i) % MAX_AMBULANCES].plate);
+    return plates;
+}
+
 // ====================== UI FUNCTIONS FOR ROLE 4 ============================
 
 // --------------------------------------------------------------------------
@@ -180,6 +197,7 @@ inline void ui_register_ambulance() {
         cout << "Ambulance roster full.\n";
         return;
     }
+    if (!mem_admit_or_report(MEM_AMBULANCES)) return;
 
     Ambulance a{};
     cout << "Enter Ambulance Plate/ID: ";
@@ -187,7 +205,11 @@ inline void ui_register_ambulance() {
 
     if (gAmb.enqueue(a)) {
         cout << "Ambulance added to active-duty list.\n";
+        publish_event(EV_AMBULANCES, EV_INSERT, a.plate, gAmb.count, "",
+                      cdc_image({ a.plate, to_string(gAmb.count - 1) }));
         gAmb.saveToFile(AMB_FILE);
+        gRoster.syncUnits(amb_plates());   // staff the new unit
+        staging_set_units(gAmb.count);     // one more staging point
     } else {
         cout << "Failed to register.\n";
     }
@@ -209,6 +231,15 @@ inline void ui_rotate_shift() {
         return;
     }
     gAmb.rotateOnce();
+    // Every ambulance moves up one place; the old head goes to the back
+    for (int i = 0; i < gAmb.count; ++i) {
+        const char* plate = gAmb.data[(gAmb.head + i) % MAX_AMBULANCES].plate;
+        int before = (i + 1) % gAmb.count;
+        if (before == i) break;                      // single ambulance
+        publish_event(EV_AMBULANCES, EV_UPDATE, plate, i,
+                      cdc_image({ plate, to_string(before) }),
+                      cdc_image({ plate, to_string(i) }));
+    }
     cout << "Shift rotated. Next up is now at head.\n";
     gAmb.saveToFile(AMB_FILE);
 }
@@ -222,6 +253,11 @@ inline void ui_rotate_shift() {
 //   1) Register Ambulance (enqueue)
 //   2) Rotate Ambulance Shift
 //   3) Display Ambulance Schedule
+//   4) View Crew Roster (who staffs each unit in an hour)
+//   5) Register Crew Member
+//   6) Crew Sick / Back on Duty (repairs the roster)
+//   7) Recommended Staging Points (where idle units should wait)
+//   8) Rank Units by ETA (travel time to an incident position)
 //   0) Back (return to main menu)
 // --------------------------------------------------------------------------
 inline void menu_ambulance() {
@@ -232,10 +268,16 @@ inline void menu_ambulance() {
         cout << "1) Register Ambulance (enqueue)\n";
         cout << "2) Rotate Ambulance Shift\n";
         cout << "3) Display Ambulance Schedule\n";
+        cout << "4) View Crew Roster\n";
+        cout << "5) Register Crew Member\n";
+        cout << "6) Crew Sick / Back on Duty\n";
+        cout << "7) Recommended Staging Points\n";
+        cout << "8) Rank Units by ETA\n";
         cout << "0) Back\n> ";
 
         int ch;
         if (!(cin >> ch)) {
+            if (cin.eof()) return;          // end of input
             cin.clear();
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
             continue;
@@ -246,6 +288,11 @@ inline void menu_ambulance() {
         else if (ch == 1) ui_register_ambulance();
         else if (ch == 2) ui_rotate_shift();
         else if (ch == 3) gAmb.print();
+        else if (ch == 4) ui_view_roster();
+        else if (ch == 5) ui_register_crew();
+        else if (ch == 6) ui_crew_sick();
+        else if (ch == 7) print_staging(amb_plates());
+        else if (ch == 8) ui_rank_by_eta(amb_plates());
         else cout << "Invalid choice.\n";
     }
 }
@@ -254,10 +301,16 @@ inline void menu_ambulance() {
 // load_ambulances_from_file()
 // --------------------------------------------------------------------------
 // Convenience wrapper for main.cpp to load ambulances into the global
-// circular queue from AMB_FILE at program startup.
+// circular queue from AMB_FILE at program startup, their crews from
+// CREW_FILE and the road network from ROAD_FILE, and to plan one staging
+// point per unit.
 // --------------------------------------------------------------------------
 inline void load_ambulances_from_file() {
     gAmb.loadFromFile(AMB_FILE);
+    gRoster.loadFromFile(CREW_FILE);
+    gRoster.syncUnits(amb_plates());
+    staging_set_units(gAmb.count);
+    load_roads_from_file();
 }
 
 #endif
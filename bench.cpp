@@ -0,0 +1,1279 @@
+// bench.cpp
+// ---------------------------------------------------------------------------
+// Container benchmarks for the Hospital Patient Care Management System.
+//
+// This is a separate program from main.cpp. Build and run it with e.g.
+//
+//   g++ -std=c++17 -O2 -march=native bench.cpp -o bench
+//   ./bench
+//
+// Benchmarks:
+//   emerg : EmergencyMaxHeap vs EmergencyFlatQueue at growing queue sizes,
+//           to find the crossover size below which the flat engine wins
+//           (pick the engine with -DEMERG_ENGINE_FLAT when building main),
+//           and the cost of the EDF engine at a few sizes.
+//   cont  : the other role containers at a steady size: chunked patient
+//           queue (serve + admit), supply stack (use + restock) and the
+//           ambulance ring (rotate one place).
+//   snap  : cost of a consistent copy of the queue: array copy of
+//           EmergencyMaxHeap vs O(1) snapshot of EmergencyPersistentHeap.
+//   meld  : taking over another site's backlog: one push per case vs
+//           meld() of the array heap (heapify) and the pairing heap (O(1)).
+//   events: cost of publish() on the event bus (events.hpp), alone and with
+//           a reader thread polling at the same time.
+//   assign: batch dispatch (dispatch.hpp) of K cases to K units: the
+//           class-split DP of assign_dispatch() (the live path without
+//           incident positions) against the Hungarian assign_min_cost(),
+//           which checks its total and is the live path when road travel
+//           times are given, and against sending units in turn.
+//   roads : contraction hierarchy (roads.hpp) on a synthetic city grid:
+//           build time, then query time against plain Dijkstra (the
+//           answers are checked to be equal).
+//   kmeans: staging point clustering (staging.hpp) on 2 million incidents,
+//           1 thread vs all threads, cold start vs warm start after the
+//           incidents of one more hour are added.
+//   report: operation reports (report.hpp) over synthetic change stream
+//           segments in the temp directory, at 1, 2, 4, ... threads.
+//   master: patient master index (master_index.hpp) in the temp directory:
+//           latency of every write while runs are flushed and merged in the
+//           background, then lookups of IDs present and absent.
+//   e2e   : whole operations through the real role menus (menu_patients()
+//           etc.) with scripted input, in a scratch directory: operations
+//           per second per role and where the time goes (input parsing,
+//           output formatting, console writes, file rewrite, change logs).
+//
+// Hardware counters: on Linux the emerg, cont and events benchmarks also
+// report cycles, instructions, cache misses and branch misses per
+// operation, read with perf_event_open() around the timed loop only.
+// Layout changes (array of structs vs split arrays, handles, ...) should be
+// judged on cache misses as well as time. A counter the kernel or VM does
+// not provide is shown as "n/a"; with none at all (perf_event_paranoid > 2,
+// no PMU in a virtual machine, not Linux) the emerg counter table is
+// skipped and the other tables show only times.
+// ---------------------------------------------------------------------------
+
+// Larger capacity than the default so we can test beyond the crossover
+#define HOSPITAL_MAX_EMERG 4096
+
+#include "emergency.hpp"
+#include "staging.hpp"
+#include "dispatch.hpp"
+#include "roads.hpp"
+#include "report.hpp"
+#include "supply.hpp"
+#include "ambulance.hpp"
+#include <chrono>     // for steady_clock
+#include <cstdint>
+#include <sstream>    // scripted menu input
+#include <thread>     // reader thread for the event bus benchmark
+#ifdef __linux__
+#include <linux/perf_event.h>   // hardware performance counters
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <fcntl.h>              // for open (stdout to /dev/null)
+#include <unistd.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Small deterministic random generator (xorshift32), so every run and every
+// engine sees exactly the same sequence of priorities.
+// ---------------------------------------------------------------------------
+struct BenchRng {
+    uint32_t s = 2463534242u;
+    uint32_t next() {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return s;
+    }
+    int priority() { return 1 + (int)(next() % 10); }   // 1..10 like the UI
+};
+
+inline double now_ns() {
+    return (double)chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Keeps the optimiser from deleting the benchmark loops
+inline volatile long long gBenchSink = 0;
+
+// ---------------------------------------------------------------------------
+// PerfCounters
+// ---------------------------------------------------------------------------
+// Hardware counters of this thread (user space only), each opened on its
+// own so that one missing counter does not disable the others. The values
+// are scaled by time enabled / time running in case the kernel had to
+// multiplex them. Without __linux__ every counter is unavailable.
+// ---------------------------------------------------------------------------
+enum PerfCounterId { PC_CYCLES, PC_INSTRUCTIONS, PC_CACHE_MISSES, PC_BRANCH_MISSES,
+                     PERF_COUNTERS };
+
+struct PerfSample {
+    double value[PERF_COUNTERS];   // per operation, < 0 = not available
+};
+
+struct PerfCounters {
+    int fd[PERF_COUNTERS];
+
+    PerfCounters() {
+        for (int i = 0; i < PERF_COUNTERS; ++i) fd[i] = -1;
+#ifdef __linux__
+        const unsigned long long config[PERF_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            perf_event_attr a;
+            memset(&a, 0, sizeof a);
+            a.size           = sizeof a;
+            a.type           = PERF_TYPE_HARDWARE;
+            a.config         = config[i];
+            a.disabled       = 1;
+            a.exclude_kernel = 1;
+            a.exclude_hv     = 1;
+            a.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd[i] = (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int i = 0; i < PERF_COUNTERS; ++i)
+            if (fd[i] >= 0) close(fd[i]);
+#endif
+    }
+
+    bool any() const {
+        for (int i = 0; i < PERF_COUNTERS; ++i)
+            if (fd[i] >= 0) return true;
+        return false;
+    }
+
+    void start() {
+#ifdef __linux__
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            if (fd[i] < 0) continue;
+            ioctl(fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Stop counting and return the counts divided by `ops`
+    PerfSample stop(long long ops) {
+        PerfSample ps;
+        for (int i = 0; i < PERF_COUNTERS; ++i) ps.value[i] = -1;
+#ifdef __linux__
+        for (int i = 0; i < PERF_COUNTERS; ++i)
+            if (fd[i] >= 0) ioctl(fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        for (int i = 0; i < PERF_COUNTERS; ++i) {
+            uint64_t v[3];   // value, time enabled, time running
+            if (fd[i] < 0 || read(fd[i], v, sizeof v) != (ssize_t)sizeof v || v[2] == 0)
+                continue;
+            ps.value[i] = (double)v[0] * ((double)v[1] / (double)v[2]) / (double)ops;
+        }
+#else
+        (void)ops;
+#endif
+        return ps;
+    }
+};
+
+inline PerfCounters gPerf;
+
+// One counter value for a table column
+inline void print_perf_value(double v, int width) {
+    if (v < 0) cout << setw(width) << "n/a";
+    else       cout << setw(width) << fixed << setprecision(v < 10 ? 2 : 1) << v;
+}
+
+// The counter columns of a table row: the four counters, then IPC
+inline void print_perf_sample(const PerfSample& ps) {
+    cout << right;
+    for (int i = 0; i < PERF_COUNTERS; ++i) print_perf_value(ps.value[i], 12);
+    if (ps.value[PC_CYCLES] > 0 && ps.value[PC_INSTRUCTIONS] >= 0)
+        print_perf_value(ps.value[PC_INSTRUCTIONS] / ps.value[PC_CYCLES], 8);
+    else
+        cout << setw(8) << "n/a";
+    cout << left;
+    cout.unsetf(ios::floatfield);
+}
+
+// Their headings
+inline void print_perf_heading() {
+    cout << right << setw(12) << "cycles" << setw(12) << "instr"
+         << setw(12) << "cache-miss" << setw(12) << "branch-miss"
+         << setw(8) << "IPC" << left;
+}
+
+// ---------------------------------------------------------------------------
+// bench_emerg_steady()
+// ---------------------------------------------------------------------------
+// Purpose : Fill the queue to n cases, then time `ops` rounds of
+//           push(random) + top() + pop() so the size stays at n.
+// Return  : nanoseconds per round.
+// ---------------------------------------------------------------------------
+template <class Q>
+double bench_emerg_steady(Q& q, int n, int ops, PerfSample* ps = nullptr) {
+    q.clear();
+    BenchRng rng;
+    EmergencyCase e = q.make("Bench Patient", "Bench", 0);
+    long long base = e.arrival;   // deadlines for the EDF engine
+    for (int i = 0; i < n; ++i) {
+        e.priority = rng.priority();
+        e.deadline = base + response_target(e.priority) + i % 60;
+        q.push(e);
+    }
+    long long sink = 0;
+    if (ps) gPerf.start();
+    double t0 = now_ns();
+    for (int i = 0; i < ops; ++i) {
+        e.priority = rng.priority();
+        e.deadline = base + response_target(e.priority) + i % 60;
+        q.push(e);
+        sink += q.top().priority;
+        q.pop();
+    }
+    double t1 = now_ns();
+    if (ps) *ps = gPerf.stop(ops);
+    gBenchSink = gBenchSink + sink;
+    return (t1 - t0) / ops;
+}
+
+// Same pop order (by priority) from both engines for the same input
+template <class A, class B>
+bool same_priority_order(A& a, B& b, int n) {
+    a.clear();
+    b.clear();
+    BenchRng rng;
+    for (int i = 0; i < n; ++i) {
+        int p = rng.priority();
+        a.push(a.make("X", "Y", p));
+        b.push(b.make("X", "Y", p));
+    }
+    while (!a.isEmpty()) {
+        if (b.isEmpty() || a.top().priority != b.top().priority) return false;
+        a.pop();
+        b.pop();
+    }
+    return b.isEmpty();
+}
+
+EmergencyMaxHeap        gBenchHeap;
+EmergencyFlatQueue      gBenchFlat;
+EmergencyPersistentHeap gBenchPers;
+EmergencyMaxHeap        gBenchCopy;   // destination of the array copy
+EmergencyPairingHeap    gBenchPair;
+EmergencyPairingHeap    gBenchPair2;
+EmergencyDeadlineQueue  gBenchEdf;
+
+// ---------------------------------------------------------------------------
+// bench_emerg_counters()
+// ---------------------------------------------------------------------------
+// Purpose : Hardware counters per push + top + pop round for every engine
+//           at a few queue sizes (one run each, after the timing runs).
+// ---------------------------------------------------------------------------
+template <class Q>
+void bench_counters_row(const char* engine, Q& q, int n) {
+    PerfSample ps;
+    bench_emerg_steady(q, n, 200000, &ps);
+    cout << left << setw(8) << n << setw(12) << engine;
+    print_perf_sample(ps);
+    cout << "\n";
+}
+
+void bench_emerg_counters() {
+    line();
+    cout << "Hardware counters per push + top + pop round:\n";
+    if (!gPerf.any()) {
+        cout << "(no hardware counters available here, e.g. no PMU in a VM or\n"
+             << " perf_event_paranoid too high: skipped)\n";
+        return;
+    }
+    cout << left << setw(8) << "n" << setw(12) << "engine";
+    print_perf_heading();
+    cout << "\n";
+    const int sizes[] = { 64, 1024, 4000 };
+    for (int n : sizes) {
+        bench_counters_row("heap",       gBenchHeap, n);
+        bench_counters_row("flat",       gBenchFlat, n);
+        bench_counters_row("persistent", gBenchPers, n);
+        bench_counters_row("pairing",    gBenchPair, n);
+        bench_counters_row("edf",        gBenchEdf,  n);
+    }
+}
+
+void bench_emerg() {
+    line('=');
+    cout << "EMERGENCY ENGINES: push + top + pop at steady size n\n";
+    line('=');
+
+    if (!same_priority_order(gBenchHeap, gBenchFlat, 1000) ||
+        !same_priority_order(gBenchHeap, gBenchPers, 1000) ||
+        !same_priority_order(gBenchHeap, gBenchPair, 1000)) {
+        cout << "[Error] Engines disagree on pop order.\n";
+        return;
+    }
+
+    const int sizes[] = { 4, 8, 16, 32, 64, 100, 128, 192, 256, 384,
+                          512, 768, 1024, 2048, 4000 };
+    cout << left << setw(8) << "n"
+         << setw(16) << "heap ns/op"
+         << setw(16) << "flat ns/op"
+         << "faster" << "\n";
+    line();
+
+    // Crossover = first size from which the heap wins at every larger size
+    // (single noisy wins of either engine do not move it)
+    int crossover = -1;
+    for (int n : sizes) {
+        const int ops = 200000;
+        double th = 1e18, tf = 1e18;
+        for (int rep = 0; rep < 3; ++rep) {     // best of 3 to reduce noise
+            th = min(th, bench_emerg_steady(gBenchHeap, n, ops));
+            tf = min(tf, bench_emerg_steady(gBenchFlat, n, ops));
+        }
+        cout << left << setw(8) << n
+             << setw(16) << fixed << setprecision(1) << th
+             << setw(16) << tf
+             << (tf < th ? "flat" : "heap") << "\n";
+        if (tf < th)              crossover = -1;
+        else if (crossover < 0)   crossover = n;
+    }
+    line();
+    if (crossover < 0)
+        cout << "Flat engine faster at every tested size.\n";
+    else
+        cout << "Crossover: heap is faster from about n = " << crossover
+             << ". Below that backlog size build main with"
+             << " -DEMERG_ENGINE_FLAT.\n";
+
+    // The EDF engine (-DEMERG_ENGINE_EDF) is a heap too, with a larger
+    // record and the breach counts updated on every push and pop
+    cout << "EDF engine ns/op:";
+    for (int n : { 64, 1024, 4000 })
+        cout << "  n=" << n << " " << fixed << setprecision(1)
+             << bench_emerg_steady(gBenchEdf, n, 200000);
+    cout << "\n";
+    cout.unsetf(ios::floatfield);
+
+    bench_emerg_counters();
+}
+
+// ---------------------------------------------------------------------------
+// bench_containers()
+// ---------------------------------------------------------------------------
+// Purpose : Time one operation of the patient queue, supply stack and
+//           ambulance ring at a steady size near their capacity, with the
+//           hardware counters of the timed loop (see bench_counted()).
+// ---------------------------------------------------------------------------
+
+// Time `ops` calls of step(i) and print a row: ns and counters per call
+template <class F>
+void bench_counted(const char* what, int n, int ops, F step) {
+    gPerf.start();
+    double t0 = now_ns();
+    for (int i = 0; i < ops; ++i) step(i);
+    double t1 = now_ns();
+    PerfSample ps = gPerf.stop(ops);
+    cout << left << setw(30) << what << setw(6) << n << right << setw(8) << fixed
+         << setprecision(1) << (t1 - t0) / ops;
+    print_perf_sample(ps);
+    cout << "\n";
+}
+
+PatientIndex gBenchPatientIndex;
+PatientQueue gBenchPatients(&gBenchPatientIndex);
+SupplyStack  gBenchSupplies;
+AmbulanceCQueue gBenchAmb;
+
+void bench_containers() {
+    line('=');
+    cout << "CONTAINERS: one operation at steady size n\n";
+    line('=');
+    cout << left << setw(30) << "operation" << setw(6) << "n" << right << setw(8) << "ns";
+    print_perf_heading();
+    cout << "\n";
+    line();
+    const int ops = 2000000;
+
+    // Patient queue: serve the front patient, admit them again at the back
+    // (IDs stay unique, so the ID index sees real inserts and erases)
+    int np = MAX_PATIENTS * 3 / 4;
+    gBenchPatients.clear();
+    for (int i = 0; i < np; ++i)
+        gBenchPatients.enqueue(gBenchPatients.make("P" + to_string(i), "Bench Patient", "Flu"));
+    Patient p;
+    bench_counted("patients: dequeue + enqueue", np, ops, [&](int) {
+        gBenchPatients.dequeue(p);
+        gBenchPatients.enqueue(p);
+    });
+
+    // Supply stack: use the top batch, restock it (units per type kept)
+    int ns = MAX_SUPPLIES * 3 / 4;
+    const char* types[] = { "Gloves", "Surgical Masks", "Syringes", "Saline", "Bandages" };
+    gBenchSupplies.clear();
+    for (int i = 0; i < ns; ++i)
+        gBenchSupplies.push(gBenchSupplies.make(types[i % 5], 10 + i % 40, "B" + to_string(i)));
+    Supply su;
+    bench_counted("supplies: pop + push", ns, ops, [&](int) {
+        gBenchSupplies.pop(su);
+        gBenchSupplies.push(su);
+    });
+
+    // Ambulance ring: next unit in the rotation goes to the back
+    int na = MAX_AMBULANCES;
+    gBenchAmb.clear();
+    for (int i = 0; i < na; ++i) {
+        Ambulance a{};
+        snprintf(a.plate, sizeof a.plate, "AMB-%d", 100 + i);
+        gBenchAmb.enqueue(a);
+    }
+    bench_counted("ambulances: rotateOnce", na, ops, [&](int) { gBenchAmb.rotateOnce(); });
+    gBenchSink = gBenchSink + gBenchPatients.count + gBenchSupplies.top + gBenchAmb.head;
+
+    if (!gPerf.any())
+        cout << "(no hardware counters available here: times only)\n";
+}
+
+// ---------------------------------------------------------------------------
+// bench_snapshot()
+// ---------------------------------------------------------------------------
+// Purpose : Compare the cost of taking a consistent copy of the queue (what
+//           views/reports need) for both heap kinds, at several sizes.
+//           The persistent heap's push/pop cost is shown for reference.
+// ---------------------------------------------------------------------------
+void bench_snapshot() {
+    line('=');
+    cout << "EMERGENCY SNAPSHOTS: consistent copy of the queue\n";
+    line('=');
+    cout << left << setw(8) << "n"
+         << setw(18) << "heap copy ns"
+         << setw(18) << "persistent ns"
+         << "persistent push+pop ns" << "\n";
+    line();
+
+    const int sizes[] = { 16, 100, 1000, 4000 };
+    for (int n : sizes) {
+        const int reps = 20000;
+        double pp = bench_emerg_steady(gBenchPers, n, 200000);
+        bench_emerg_steady(gBenchHeap, n, 1);   // leaves both at size n
+
+        double t0 = now_ns();
+        for (int r = 0; r < reps; ++r) {
+            gBenchCopy.sz = gBenchHeap.sz;
+            for (int i = 1; i <= gBenchHeap.sz; ++i)
+                gBenchCopy.data[i] = gBenchHeap.data[i];
+            gBenchSink = gBenchSink + gBenchCopy.data[1].priority;
+        }
+        double tc = (now_ns() - t0) / reps;
+
+        t0 = now_ns();
+        for (int r = 0; r < reps; ++r) {
+            EmergencySnapshot snap = gBenchPers.snapshot();
+            gBenchSink = gBenchSink + snap.top().priority;
+        }
+        double ts = (now_ns() - t0) / reps;
+
+        cout << left << setw(8) << n
+             << setw(18) << fixed << setprecision(1) << tc
+             << setw(18) << ts
+             << pp << "\n";
+    }
+}
+
+// Fill q with n random cases (fixed seed per call)
+template <class Q>
+void bench_fill(Q& q, int n, uint32_t seed) {
+    q.clear();
+    BenchRng rng;
+    rng.s = seed;
+    EmergencyCase e = q.make("Diverted Patient", "Bench", 0);
+    for (int i = 0; i < n; ++i) {
+        e.priority = rng.priority();
+        q.push(e);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// bench_meld()
+// ---------------------------------------------------------------------------
+// Purpose : Time taking over a backlog of n cases into a queue of n cases.
+//           Only the transfer itself is timed, not building the backlog.
+// ---------------------------------------------------------------------------
+void bench_meld() {
+    line('=');
+    cout << "EMERGENCY MELD: take over a backlog of n cases (queue has n)\n";
+    line('=');
+    cout << left << setw(8) << "n"
+         << setw(18) << "push each ns"
+         << setw(18) << "heap meld ns"
+         << "pairing meld ns" << "\n";
+    line();
+
+    const int sizes[] = { 16, 256, 2000 };
+    for (int n : sizes) {
+        const int reps = 50;
+        double tPush = 0, tHeap = 0, tPair = 0;
+        for (int r = 0; r < reps; ++r) {
+            bench_fill(gBenchHeap, n, 11);
+            bench_fill(gBenchCopy, n, 22);
+            double t0 = now_ns();
+            for (int i = 1; i <= gBenchCopy.sz; ++i) {
+                EmergencyCase e = gBenchCopy.data[i];   // strings move too
+                repool_case(e, gBenchHeap.pool, gBenchCopy.pool);
+                gBenchHeap.push(e);
+            }
+            tPush += now_ns() - t0;
+
+            bench_fill(gBenchHeap, n, 11);
+            t0 = now_ns();
+            gBenchHeap.meld(gBenchCopy);
+            tHeap += now_ns() - t0;
+
+            bench_fill(gBenchPair, n, 11);
+            bench_fill(gBenchPair2, n, 22);
+            t0 = now_ns();
+            gBenchPair.meld(gBenchPair2);
+            tPair += now_ns() - t0;
+            gBenchSink = gBenchSink + gBenchHeap.top().priority + gBenchPair.top().priority;
+        }
+        cout << left << setw(8) << n
+             << setw(18) << fixed << setprecision(1) << tPush / reps
+             << setw(18) << tHeap / reps
+             << tPair / reps << "\n";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// bench_events()
+// ---------------------------------------------------------------------------
+// Purpose : Time the ring append, publish(), on the mutation path: with no
+//           reader, and with one fast reader thread polling concurrently
+//           (the listeners run in the bench_e2e sessions). Also checks
+//           that a reader that never keeps up is detected (lost > 0).
+// ---------------------------------------------------------------------------
+void bench_events() {
+    line('=');
+    cout << "EVENT BUS: publish() cost\n";
+    line('=');
+    const int n = 2000000;
+
+    gPerf.start();
+    double t0 = now_ns();
+    for (int i = 0; i < n; ++i)
+        gEvents.publish(EV_EMERGENCIES, EV_INSERT, "Bench Patient", i & 15);
+    double alone = (now_ns() - t0) / n;
+    PerfSample psAlone = gPerf.stop(n);
+
+    static EventSubscriber reader("bench reader");
+    static EventSubscriber sleeper("never polls");
+    gEvents.subscribe(reader);
+    gEvents.subscribe(sleeper);
+    atomic<bool> done{false};
+    long long seen = 0;
+    thread th([&] {
+        Event ev;
+        while (!done.load(memory_order_acquire) || reader.lag() > 0)
+            while (reader.poll(ev)) seen++;
+    });
+    gPerf.start();                     // the publishing thread only
+    t0 = now_ns();
+    for (int i = 0; i < n; ++i)
+        gEvents.publish(EV_EMERGENCIES, EV_INSERT, "Bench Patient", i & 15);
+    double withReader = (now_ns() - t0) / n;
+    PerfSample psReader = gPerf.stop(n);
+    done.store(true, memory_order_release);
+    th.join();
+
+    Event ev;
+    sleeper.poll(ev);   // first poll notices it was lapped
+    cout << left << setw(26) << "" << right << setw(8) << "ns";
+    print_perf_heading();
+    cout << "\n";
+    cout << left << setw(26) << "publish, no reader" << right << setw(8) << fixed
+         << setprecision(1) << alone;
+    print_perf_sample(psAlone);
+    cout << "\n";
+    cout << left << setw(26) << "publish, 1 reader" << right << setw(8) << fixed
+         << setprecision(1) << withReader;
+    print_perf_sample(psReader);
+    cout << "\n";
+    cout << "Reader got " << seen << " + lost " << reader.lost.load()
+         << " of " << n << " events.\n";
+    line();
+    print_event_bus();
+}
+
+// ---------------------------------------------------------------------------
+// bench_kmeans()
+// ---------------------------------------------------------------------------
+// Purpose : Time kmeans() on synthetic incidents around 20 hot spots, the
+//           way an hourly refresh would see them.
+// ---------------------------------------------------------------------------
+void bench_kmeans() {
+    line('=');
+    cout << "STAGING: k-means on incident positions\n";
+    line('=');
+    const int n = 2000000, k = 20, spots = 20;
+    BenchRng rng;
+    auto unit = [&] { return (rng.next() >> 8) * (1.0f / 16777216.0f); };
+    float hx[spots], hy[spots];
+    for (int i = 0; i < spots; ++i) {
+        hx[i] = unit() * 30 - 15;
+        hy[i] = unit() * 30 - 15;
+    }
+    IncidentSet pts;
+    auto add = [&](int m) {
+        for (int i = 0; i < m; ++i) {
+            int h = (int)(rng.next() % spots);
+            pts.x.push_back(hx[h] + (unit() + unit() + unit() - 1.5f) * 2);
+            pts.y.push_back(hy[h] + (unit() + unit() + unit() - 1.5f) * 2);
+        }
+    };
+    add(n);
+    int threads = max(1, (int)thread::hardware_concurrency());
+
+    KMeansResult one  = kmeans(pts, k, nullptr, 1);
+    KMeansResult cold = kmeans(pts, k, nullptr, threads);
+    add(n / 24);                                  // one more hour on file
+    KMeansResult warm = kmeans(pts, k, &cold, threads);
+
+    auto row = [&](const char* what, const KMeansResult& r, size_t points) {
+        cout << left << setw(30) << what << right << setw(6) << r.iters << " iter "
+             << fixed << setprecision(1) << setw(9) << r.ms << " ms "
+             << setw(7) << r.ms * 1e6 / ((double)points * r.iters) << " ns/point/iter\n";
+        cout.unsetf(ios::floatfield);
+    };
+    cout << n << " points, k = " << k << ", " << threads << " thread(s)\n";
+    line();
+    row("cold start, 1 thread", one, n);
+    row("cold start, all threads", cold, n);
+    row("warm start, +1 hour of data", warm, pts.size());
+    gBenchSink += warm.count[0];
+}
+
+// ---------------------------------------------------------------------------
+// bench_report()
+// ---------------------------------------------------------------------------
+// Purpose : Time run_report() over 128 full segments (8 MB) of changes
+//           mixed like a busy day, at growing thread counts, and check that
+//           every thread count gives the same totals.
+// ---------------------------------------------------------------------------
+void bench_report() {
+    line('=');
+    cout << "REPORTS: map-reduce over change stream segments\n";
+    line('=');
+    const int segs = 128;
+    const char* conds[] = { "Flu", "Checkup", "Fractured Arm", "Migraine", "Asthma Attack",
+                            "Food Poisoning", "High Fever", "Diabetes Follow-up" };
+    const char* types[] = { "Surgical Masks", "Gloves", "Saline 500ml", "Gauze", "Syringes" };
+    BenchRng rng;
+    vector<string> files;
+    Lsn lsn = 1;
+    string dir = filesystem::temp_directory_path().string() + "/";
+    for (int s = 0; s < segs; ++s) {
+        files.push_back(dir + "bench_report_" + to_string(s) + ".log");
+        ofstream out(files.back());
+        long long bytes = 0;
+        while (bytes < CDC_SEGMENT_BYTES) {
+            uint32_t r = rng.next();
+            string rec = to_string(lsn++) + '\t';
+            string id = "P" + to_string(r % 100000);
+            switch (r % 5) {
+            case 0: rec += "patients\tinsert\t\t" + id + "|Patient Name|" + conds[r / 5 % 8] + "|1"; break;
+            case 1: rec += "patients\tremove\t" + id + "|Patient Name|" + conds[r / 5 % 8] + "|1\t"; break;
+            case 2: rec += string("supplies\tremove\t") + types[r / 5 % 5] + "|" + to_string(r / 40 % 200 + 1) + "|B-1\t"; break;
+            case 3: rec += "emergencies\tinsert\t\tCase Name|Stroke|" + to_string(r / 5 % 11) + "|"; break;
+            default: rec += "ambulances\tupdate\tAMB-" + to_string(r / 5 % 20) + "|0\tAMB-" + to_string(r / 5 % 20) + "|19"; break;
+            }
+            rec += '\n';
+            out << rec;
+            bytes += (long long)rec.size();
+        }
+    }
+    long long total = 0;
+    for (const string& f : files) total += (long long)filesystem::file_size(f);
+
+    int hw = max(1, (int)thread::hardware_concurrency());
+    cout << segs << " segments, " << total / 1024 << " KB, " << hw << " hardware thread(s)\n";
+    line();
+    double base = 0;
+    long long lines1 = -1, disc1 = -1;
+    for (int t = 1; t <= max(2, hw); t *= 2) {
+        double best = 1e300;
+        ReportAgg r;
+        for (int rep = 0; rep < 3; ++rep) {
+            double t0 = now_ns();
+            r = run_report(files, t);
+            best = min(best, now_ns() - t0);
+        }
+        long long disc = 0;
+        for (const auto& kv : r.discharges) disc += kv.second;
+        if (lines1 < 0) { lines1 = r.lines; disc1 = disc; base = best; }
+        cout << left << setw(12) << (to_string(t) + " thread(s)") << right << fixed
+             << setprecision(1) << setw(9) << best / 1e6 << " ms " << setw(8)
+             << total / (best / 1e9) / 1e6 << " MB/s  speedup " << setprecision(2)
+             << base / best << "x"
+             << (r.lines != lines1 || disc != disc1 ? "  MISMATCH" : "") << "\n";
+        cout.unsetf(ios::floatfield);
+    }
+    cout << "(speedup is bounded by the hardware threads: " << hw << " here)\n";
+    for (const string& f : files) remove(f.c_str());
+}
+
+// Percentile (0..1) of a list of timings, sorting it
+double bench_percentile(vector<double>& v, double p) {
+    sort(v.begin(), v.end());
+    return v.empty() ? 0 : v[min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+// ---------------------------------------------------------------------------
+// bench_master()
+// ---------------------------------------------------------------------------
+// Purpose : Write 2 million patients (1 in 8 written twice) to a fresh
+//           master index, timing each put(), then time lookups of present
+//           and absent IDs once the background work has finished. Every
+//           present ID must be found with its latest name.
+// ---------------------------------------------------------------------------
+void bench_master() {
+    line('=');
+    cout << "MASTER INDEX: LSM store of every patient ever seen\n";
+    line('=');
+    const int n = 2000000, lookups = 100000;
+    string dir = (filesystem::temp_directory_path() / "bench_master").string();
+    error_code ec;
+    filesystem::remove_all(dir, ec);
+    filesystem::create_directories(dir, ec);
+
+    MasterIndex mi;
+    mi.open(dir);
+    BenchRng rng;
+    vector<double> put;
+    put.reserve(n + n / 8);
+    MasterRecord r;
+    r.condition = "Flu";
+    r.status = "waiting";
+    double t0 = now_ns();
+    for (int i = 0; i < n + n / 8; ++i) {
+        int p = i < n ? i : (int)(rng.next() % n);   // then some updates
+        string id = "P" + to_string((uint32_t)p * 2654435761u % 1000000007u);
+        r.name = "Patient " + to_string(p) + (i < n ? "" : " v2");
+        r.updated = i;
+        double s = now_ns();
+        mi.put(id, r);
+        put.push_back(now_ns() - s);
+    }
+    double writeMs = (now_ns() - t0) / 1e6;
+    t0 = now_ns();
+    mi.waitIdle();
+    double idleMs = (now_ns() - t0) / 1e6;
+    double avgPut = 0;
+    for (double v : put) avgPut += v;
+    avgPut /= put.size();
+    cout << fixed << setprecision(1);
+    cout << put.size() << " put()s in " << writeMs << " ms: mean "
+         << avgPut / 1e3 << " us, p99.9 " << bench_percentile(put, 0.999) / 1e3
+         << " us, max " << put.back() / 1e3 << " us\n";
+    cout << "background work left after the last put: " << idleMs << " ms ("
+         << mi.flushes << " flushes, " << mi.merges << " merges, "
+         << mi.runs.size() << " runs now)\n";
+    line();
+
+    // Lookups: the latest name of a present ID ("v2" if it was updated)
+    vector<double> hit, miss;
+    int wrong = 0;
+    for (int i = 0; i < lookups; ++i) {
+        int p = (int)(rng.next() % n);
+        string id = "P" + to_string((uint32_t)p * 2654435761u % 1000000007u);
+        MasterRecord got;
+        double s = now_ns();
+        bool found = mi.get(id, got);
+        hit.push_back(now_ns() - s);
+        if (!found || got.name.compare(0, ("Patient " + to_string(p)).size(),
+                                       "Patient " + to_string(p)) != 0) wrong++;
+        s = now_ns();
+        if (mi.get("Q" + to_string(p), got)) wrong++;
+        miss.push_back(now_ns() - s);
+    }
+    double avgHit = 0, avgMiss = 0;
+    for (int i = 0; i < lookups; ++i) { avgHit += hit[i]; avgMiss += miss[i]; }
+    cout << left << setw(16) << "lookup" << right << setw(12) << "mean us"
+         << setw(12) << "p99 us" << setw(12) << "max us" << "\n";
+    cout << left << setw(16) << "present ID" << right << setw(12) << avgHit / lookups / 1e3
+         << setw(12) << bench_percentile(hit, 0.99) / 1e3 << setw(12) << hit.back() / 1e3 << "\n";
+    cout << left << setw(16) << "absent ID" << right << setw(12) << avgMiss / lookups / 1e3
+         << setw(12) << bench_percentile(miss, 0.99) / 1e3 << setw(12) << miss.back() / 1e3 << "\n";
+    cout.unsetf(ios::floatfield);
+    size_t mem = 0;
+    long long disk = 0;
+    for (const auto& run : mi.runs) { mem += run->memBytes(); disk += run->dataBytes; }
+    cout << "runs: " << disk / (1024 * 1024) << " MB on disk, " << mem / (1024 * 1024)
+         << " MB of filters and sparse indexes in memory"
+         << (wrong ? ", " + to_string(wrong) + " WRONG ANSWER(S)" : string()) << "\n";
+    mi.close();
+    filesystem::remove_all(dir, ec);
+}
+
+// ---------------------------------------------------------------------------
+// BenchScript
+// ---------------------------------------------------------------------------
+// Console input for one menu session, and how each line is read, so that
+// the parsing alone can be timed (bench_parse()):
+//   'n' cin >> int + ignore, 's' safe_getline(string), 'p' safe_getline(char*)
+// ---------------------------------------------------------------------------
+struct BenchScript {
+    string text, kinds;
+    int ops = 0;
+    void num(int v) { text += to_string(v) + '\n'; kinds += 'n'; }
+    void str(const string& v, char kind = 's') { text += v + '\n'; kinds += kind; }
+};
+
+// Names from common first and last names, so the duplicate-name index and
+// its warnings see realistic keys
+string bench_name(uint32_t i) {
+    static const char* first[] = { "Ahmad", "Siti", "Wei Ling", "Priya", "John", "Mei", "Ravi",
+                                   "Nurul", "Kumar", "Lina", "Hafiz", "Grace", "Aisha",
+                                   "David", "Yusof", "Farah" };
+    static const char* last[] = { "Lim", "Abdullah", "Chong", "Raman", "Smith", "Ong", "Ismail",
+                                  "Lee", "Nair", "Wong", "Hassan", "Teo", "Kaur", "Ng",
+                                  "Rahman", "Goh" };
+    return string(first[i % 16]) + " " + last[i / 16 % 16];
+}
+
+// One session of each role: `cycles` times add + remove (rotate for
+// ambulances), IDs prefixed with `tag` so sessions never collide
+BenchScript bench_script(int role, int cycles, const string& tag, BenchRng& rng) {
+    static const char* conds[] = { "Flu", "Checkup", "Fractured Arm", "Migraine", "Asthma Attack" };
+    static const char* types[] = { "Surgical Masks", "Gloves", "Saline 500ml", "Gauze", "Syringes" };
+    BenchScript s;
+    for (int i = 0; i < cycles; ++i) {
+        uint32_t r = rng.next();
+        if (role == 1) {
+            s.num(1); s.str(tag + to_string(i)); s.str(bench_name(r)); s.str(conds[r % 5]);
+            s.num(2);
+            s.ops += 2;
+        } else if (role == 2) {
+            s.num(1); s.str(types[r % 5]); s.num(1 + (int)(r % 200)); s.str(tag + to_string(i));
+            s.num(2);
+            s.ops += 2;
+        } else if (role == 3) {
+            s.num(1); s.str(bench_name(r)); s.str("Chest Pain"); s.num(1 + (int)(r % 10));
+            s.num(2);
+            s.ops += 2;
+        } else {
+            s.num(2);
+            s.ops += 1;
+        }
+    }
+    s.num(0);
+    return s;
+}
+
+// Output of a session: the real console path to /dev/null, a stream that
+// drops what it gets (formatting still done), or a failed stream (no
+// formatting at all: operator<< returns at once)
+enum BenchOut { OUT_CONSOLE, OUT_DISCARD, OUT_NONE };
+
+struct BenchNullBuf : streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// Run one menu on a script; returns ns
+double bench_drive(void (*menu)(), const BenchScript& s, BenchOut out) {
+    istringstream in(s.text);
+    streambuf* oldIn = cin.rdbuf(in.rdbuf());
+    BenchNullBuf nullBuf;
+    streambuf* oldOut = cout.rdbuf();
+#ifdef __linux__
+    int saved = -1;
+    if (out == OUT_CONSOLE) {                  // cout -> stdout -> /dev/null
+        cout.flush();
+        fflush(stdout);
+        saved = dup(1);
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, 1);
+        close(devNull);
+    }
+#else
+    ofstream devNull("NUL");
+    if (out == OUT_CONSOLE) cout.rdbuf(devNull.rdbuf());
+#endif
+    if (out != OUT_CONSOLE) cout.rdbuf(&nullBuf);
+    if (out == OUT_NONE) cout.setstate(ios::badbit);
+    double t0 = now_ns();
+    menu();
+    cout.flush();
+    fflush(stdout);
+    double t = now_ns() - t0;
+    cout.clear();
+    cout.rdbuf(oldOut);
+#ifdef __linux__
+    if (saved >= 0) {
+        dup2(saved, 1);
+        close(saved);
+    }
+#endif
+    cin.rdbuf(oldIn);
+    cin.clear();
+    return t;
+}
+
+// Only the reads the menus make for a script; returns ns
+double bench_parse(const BenchScript& s) {
+    istringstream in(s.text);
+    streambuf* old = cin.rdbuf(in.rdbuf());
+    string line;
+    char plate[16];
+    int v;
+    double t0 = now_ns();
+    for (char k : s.kinds) {
+        if (k == 'n') {
+            cin >> v;
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            gBenchSink += v;
+        } else if (k == 's') {
+            safe_getline(line);
+        } else {
+            safe_getline(plate, 16);
+        }
+    }
+    double t = now_ns() - t0;
+    cin.rdbuf(old);
+    cin.clear();
+    return t;
+}
+
+// ---------------------------------------------------------------------------
+// bench_e2e()
+// ---------------------------------------------------------------------------
+// Purpose : Operations per second through the real menu code of each role,
+//           and a breakdown per operation by layer.
+// Method  : In a scratch directory, fill the roles to a working size
+//           (100 patients, 50 supply batches, 100 emergencies, 20 units),
+//           then run rounds of four short sessions (50-100 cycles), all
+//           on the same script (only the ID prefix differs): the real one
+//           (console output, role file on disk), which gives the total,
+//           and one per BenchOut mode with the role file linked to
+//           /dev/null (Linux), so the jitter of the disk writes does not
+//           enter the differences between them. Each session adds and
+//           removes as many records, so all start at the same size. The
+//           sessions take turns to go first. Per round:
+//             console = console - discard      (stdout writes)
+//             format  = discard - none         (operator<< formatting)
+//           Input parsing, the file rewrite (one saveToFile() per
+//           operation) and the change logs (as many change stream lines
+//           as the session wrote, with the role's own images, and the
+//           master index puts it made) are timed on their own, and
+//           "other" (menus, containers, events, metrics, name index) is
+//           what is left of the total. The table shows the median over
+//           the rounds, so a round slowed down by the file system
+//           (writeback, other processes) does not skew it.
+// ---------------------------------------------------------------------------
+void bench_e2e() {
+    line('=');
+    cout << "END-TO-END: operations through the role menus\n";
+    line('=');
+    filesystem::path home = filesystem::current_path();
+    filesystem::path dir = filesystem::temp_directory_path() / "bench_e2e";
+    error_code ec;
+    filesystem::remove_all(dir, ec);
+    filesystem::create_directories(dir, ec);
+    filesystem::current_path(dir);
+    gMaster.open();
+
+    BenchRng rng;
+    BenchScript fill[5];
+    for (int i = 0; i < 100; ++i) {
+        uint32_t r = rng.next();
+        fill[1].num(1); fill[1].str("W" + to_string(i)); fill[1].str(bench_name(r)); fill[1].str("Flu");
+        fill[3].num(1); fill[3].str(bench_name(r >> 8)); fill[3].str("Fall"); fill[3].num(1 + (int)(r % 10));
+        if (i < 50) { fill[2].num(1); fill[2].str("Gloves"); fill[2].num(10); fill[2].str("B" + to_string(i)); }
+        if (i < 20) { fill[4].num(1); fill[4].str("AMB-" + to_string(i), 'p'); }
+    }
+    void (*menus[5])() = { nullptr, menu_patients, menu_supplies, menu_emergency, menu_ambulance };
+    const char* names[5] = { "", "patients", "supplies", "emergencies", "ambulances" };
+    const int chunk[5] = { 0, 50, 50, 50, 100 };   // cycles per session
+    const int rounds = 40;
+    for (int role = 1; role <= 4; ++role) {
+        fill[role].num(0);
+        bench_drive(menus[role], fill[role], OUT_NONE);
+    }
+
+    cout << left << setw(13) << "role" << right << setw(9) << "ops/s" << setw(9) << "us/op"
+         << "  |" << setw(8) << "input" << setw(8) << "format" << setw(9) << "console"
+         << setw(7) << "file" << setw(7) << "logs" << setw(8) << "other" << "\n";
+    line();
+    enum { L_TOTAL, L_INPUT, L_FORMAT, L_CONSOLE, L_FILE, L_LOGS, L_OTHER, LAYERS };
+    double all = 0, allFile = 0, allOut = 0;
+    const EventRole evRole[5] = { EV_PATIENTS, EV_PATIENTS, EV_SUPPLIES, EV_EMERGENCIES,
+                                  EV_AMBULANCES };
+    const char* files[5] = { "", PATIENT_FILE, SUPPLY_FILE, EMERG_FILE, AMB_FILE };
+    for (int role = 1; role <= 4; ++role) {
+        // Change stream lines like the role's sessions write (before, after):
+        // an insert and a remove of a record of the role, or for the
+        // ambulances the place updates of one rotation
+        vector<pair<string, string> > logLines;
+        string img;
+        if (role == 1) img = patient_image(gPatients, gPatients.front(), 1);
+        else if (role == 2) {
+            const Supply& top = gSupplies.data[gSupplies.top];
+            img = cdc_image({ gSupplies.str(top.type), to_string(top.quantity),
+                              gSupplies.str(top.batch) });
+        } else if (role == 3) img = emergency_image(gEmerg, gEmerg.top());
+        if (role < 4) {
+            logLines.push_back(make_pair(string(), img));
+            logLines.push_back(make_pair(img, string()));
+        } else {
+            for (int i = 0; i < gAmb.count; ++i) {
+                const char* plate = gAmb.data[(gAmb.head + i) % MAX_AMBULANCES].plate;
+                logLines.push_back(make_pair(cdc_image({ plate, to_string((i + 1) % gAmb.count) }),
+                                             cdc_image({ plate, to_string(i) })));
+            }
+        }
+
+        vector<double> layer[LAYERS];              // ns per operation, per round
+        string real = string(files[role]) + ".real";
+        for (int r = 0; r < rounds; ++r) {
+            double t[4];                           // per BenchOut mode, then real
+            int ops = 0;
+            long long cdcLines = 0;
+            BenchRng roundRng = rng;               // the same draws in every session
+            rng.next();
+            for (int k = 0; k < 4; ++k) {
+                int m = (k + r) % 4;               // each session goes first in turn
+                string tag = string(1, "CDNR"[m]) + to_string(r) + "-";
+                BenchRng sessionRng = roundRng;
+                BenchScript s = bench_script(role, chunk[role], tag, sessionRng);
+#ifdef __linux__
+                if (m < 3) {                       // role file -> /dev/null
+                    filesystem::rename(files[role], real, ec);
+                    filesystem::create_symlink("/dev/null", files[role], ec);
+                }
+#endif
+                Lsn lsn0 = gCdc.nextLsn;
+                t[m] = bench_drive(menus[role], s, m < 3 ? (BenchOut)m : OUT_CONSOLE);
+#ifdef __linux__
+                if (m < 3) {
+                    filesystem::remove(files[role], ec);
+                    filesystem::rename(real, files[role], ec);
+                }
+#endif
+                if (m == 3) {
+                    cdcLines = (long long)(gCdc.nextLsn - lsn0);
+                    ops = s.ops;
+                    layer[L_INPUT].push_back(bench_parse(s) / ops);
+                }
+            }
+            double t0 = now_ns();
+            for (int i = 0; i < ops; ++i) {
+                if (role == 1) gPatients.saveToFile(PATIENT_FILE);
+                else if (role == 2) gSupplies.saveToFile(SUPPLY_FILE);
+                else if (role == 3) gEmerg.saveToFile(EMERG_FILE);
+                else gAmb.saveToFile(AMB_FILE);
+            }
+            layer[L_FILE].push_back((now_ns() - t0) / ops);
+            t0 = now_ns();
+            for (long long i = 0; i < cdcLines; ++i) {
+                const pair<string, string>& l = logLines[i % logLines.size()];
+                cdc_emit(evRole[role], l.first.empty() ? EV_INSERT
+                                       : l.second.empty() ? EV_REMOVE : EV_UPDATE,
+                         l.first, l.second);
+            }
+            if (role == 1)
+                for (int i = 0; i < ops; ++i)
+                    master_record("X" + to_string(i), "Siti Abdullah", "Checkup", "waiting");
+            layer[L_LOGS].push_back((now_ns() - t0) / ops);
+            layer[L_TOTAL].push_back(t[3] / ops);
+            layer[L_CONSOLE].push_back((t[0] - t[1]) / ops);
+            layer[L_FORMAT].push_back((t[1] - t[2]) / ops);
+            layer[L_OTHER].push_back(t[3] / ops - layer[L_CONSOLE].back() - layer[L_FORMAT].back()
+                                     - layer[L_INPUT].back() - layer[L_FILE].back()
+                                     - layer[L_LOGS].back());
+        }
+        double med[LAYERS];
+        for (int l = 0; l < LAYERS; ++l) med[l] = bench_percentile(layer[l], 0.5) / 1e3;
+        cout << left << setw(13) << names[role] << right << fixed << setprecision(0)
+             << setw(9) << 1e6 / med[L_TOTAL] << setprecision(1) << setw(9) << med[L_TOTAL]
+             << "  |" << setw(8) << med[L_INPUT] << setw(8) << med[L_FORMAT]
+             << setw(9) << med[L_CONSOLE] << setw(7) << med[L_FILE] << setw(7) << med[L_LOGS]
+             << setw(8) << med[L_OTHER] << "\n";
+        cout.unsetf(ios::floatfield);
+        all += med[L_TOTAL];
+        allFile += med[L_FILE];
+        allOut += med[L_FORMAT] + med[L_CONSOLE];
+    }
+    line();
+    cout << fixed << setprecision(0) << "Share of all time: file rewrite " << 100 * allFile / all
+         << "%, console output (formatting + writes) " << 100 * allOut / all << "%\n";
+    cout.unsetf(ios::floatfield);
+    cout << "(median us per operation; console = stdout to /dev/null, no terminal drawing;\n"
+            " layers are differences of timings, so small ones can come out below 0)\n";
+
+    gMaster.close();
+    if (gCdc.out.is_open()) gCdc.out.close();
+    gCdc.opened = false;
+    filesystem::current_path(home);
+    filesystem::remove_all(dir, ec);
+}
+
+// ---------------------------------------------------------------------------
+// bench_assign()
+// ---------------------------------------------------------------------------
+// Purpose : Time assign_dispatch() (the live path) on batches like the
+//           dispatcher builds (random priorities and case types, one unit in
+//           five ICU), against assign_min_cost() on the same costs, which
+//           must reach the same total, and on uniformly random costs, which
+//           need the most augmenting work.
+// ---------------------------------------------------------------------------
+void bench_assign() {
+    line('=');
+    cout << "BATCH DISPATCH: K cases x K units\n";
+    line('=');
+    cout << left << setw(8) << "K" << right << setw(14) << "dispatch ms" << setw(14)
+         << "Hungarian ms" << setw(12) << "vs in turn" << setw(14) << "random ms" << "\n";
+    line();
+    BenchRng rng;
+    for (int n : { 25, 50, 100, 200, 300 }) {
+        vector<double> cost((size_t)n * n), noise((size_t)n * n);
+        vector<DispatchCase> cases(n);
+        for (DispatchCase& c : cases) {
+            c.priority = rng.priority();
+            c.icu = c.priority >= DISPATCH_ICU_PRIORITY || rng.next() % 4 == 0;
+        }
+        stable_sort(cases.begin(), cases.end(), [](const DispatchCase& a, const DispatchCase& b) {
+            return a.priority > b.priority;
+        });
+        vector<int> rank(n);
+        vector<bool> icu(n);
+        for (int j = 0; j < n; ++j) {
+            rank[j] = j;
+            icu[j] = j % 5 == 0;
+        }
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j) {
+                cost[(size_t)i * n + j]  = dispatch_cost(cases[i], rank[j], icu[j]);
+                noise[(size_t)i * n + j] = rng.next() % 100000;
+            }
+        const int reps = 20;                   // the fast solver, averaged
+        vector<int> unit;
+        double t0 = now_ns();
+        for (int r = 0; r < reps; ++r) unit = assign_dispatch(cases, rank, icu);
+        double ms = (now_ns() - t0) / 1e6 / reps;
+        t0 = now_ns();
+        vector<int> col = assign_min_cost(cost, n, n);
+        double msHungarian = (now_ns() - t0) / 1e6;
+        t0 = now_ns();
+        vector<int> col2 = assign_min_cost(noise, n, n);
+        double msRandom = (now_ns() - t0) / 1e6;
+        double total = 0, reference = 0, inTurn = 0;
+        for (int i = 0; i < n; ++i) {
+            total     += cost[(size_t)i * n + unit[i]];
+            reference += cost[(size_t)i * n + col[i]];
+            inTurn    += cost[(size_t)i * n + i];
+        }
+        gBenchSink += col2[0];
+        cout << left << setw(8) << n << right << fixed << setprecision(3) << setw(14) << ms
+             << setw(14) << msHungarian << setprecision(0) << setw(11) << 100 * total / inTurn
+             << "%" << setprecision(3) << setw(14) << msRandom << "\n";
+        cout.unsetf(ios::floatfield);
+        if (total != reference)
+            cout << "[Error] assign_dispatch() cost " << total << " != Hungarian " << reference << "\n";
+    }
+}
+
+// Plain Dijkstra over the original edges (reference for bench_roads)
+int bench_dijkstra(const vector<vector<pair<int, int> > >& adj, int s, int t) {
+    vector<int> dist(adj.size(), ROAD_INF);
+    vector<pair<int, int> > h;
+    dist[s] = 0;
+    h.push_back({ 0, s });
+    while (!h.empty()) {
+        pop_heap(h.begin(), h.end(), greater<pair<int, int> >());
+        int d = h.back().first, v = h.back().second;
+        h.pop_back();
+        if (v == t) return d;
+        if (d > dist[v]) continue;
+        for (auto& e : adj[v])
+            if (d + e.second < dist[e.first]) {
+                dist[e.first] = d + e.second;
+                h.push_back({ dist[e.first], e.first });
+                push_heap(h.begin(), h.end(), greater<pair<int, int> >());
+            }
+    }
+    return ROAD_INF;
+}
+
+// ---------------------------------------------------------------------------
+// bench_roads()
+// ---------------------------------------------------------------------------
+// Purpose : Build a contraction hierarchy over a side x side street grid
+//           (every 6th street an arterial, some streets missing or
+//           one-way) and time random queries against Dijkstra.
+// ---------------------------------------------------------------------------
+void bench_roads() {
+    line('=');
+    cout << "ROADS: contraction hierarchy vs Dijkstra\n";
+    line('=');
+    cout << left << setw(10) << "junctions" << right << setw(11) << "build ms"
+         << setw(11) << "shortcuts" << setw(10) << "CH us" << setw(12) << "Dijkstra us"
+         << "\n";
+    line();
+    BenchRng rng;
+    for (int side : { 60, 120, 200 }) {
+        RoadGraph g;
+        vector<RoadEdge> edges;
+        for (int j = 0; j < side; ++j)
+            for (int i = 0; i < side; ++i) {
+                g.x.push_back(i * 0.5f);
+                g.y.push_back(j * 0.5f);
+                for (int dir = 0; dir < 2; ++dir) {
+                    int i2 = i + (dir == 0), j2 = j + (dir == 1);
+                    if (i2 == side || j2 == side) continue;
+                    bool arterial = (dir == 0 ? j : i) % 6 == 0;
+                    if (!arterial && rng.next() % 100 < 8) continue;
+                    int a = j * side + i, b = j2 * side + i2;
+                    int sec = (arterial ? 36 : 60) + (int)(rng.next() % 15);
+                    edges.push_back({ a, b, sec });
+                    if (arterial || rng.next() % 10) edges.push_back({ b, a, sec });
+                }
+            }
+        g.build(edges);
+        vector<vector<pair<int, int> > > adj(g.size());
+        for (const RoadEdge& e : edges) adj[e.from].push_back({ e.to, e.sec });
+
+        const int queries = 200;
+        vector<pair<int, int> > st;
+        for (int q = 0; q < queries; ++q)
+            st.push_back({ (int)(rng.next() % g.size()), (int)(rng.next() % g.size()) });
+        vector<int> chSec, djSec;
+        double t0 = now_ns();
+        for (auto& p : st) chSec.push_back(g.search(p.first, p.second));
+        double chUs = (now_ns() - t0) / 1000 / queries;
+        t0 = now_ns();
+        for (auto& p : st) djSec.push_back(bench_dijkstra(adj, p.first, p.second));
+        double djUs = (now_ns() - t0) / 1000 / queries;
+
+        cout << left << setw(10) << g.size() << right << fixed << setprecision(0)
+             << setw(11) << g.buildMs << setw(11) << g.shortcuts << setprecision(1)
+             << setw(10) << chUs << setw(12) << djUs
+             << (chSec == djSec ? "" : "  MISMATCH") << "\n";
+        cout.unsetf(ios::floatfield);
+    }
+}
+
+int main() {
+    bench_emerg();
+    bench_containers();
+    bench_snapshot();
+    bench_meld();
+    bench_events();
+    bench_assign();
+    bench_roads();
+    bench_kmeans();
+    bench_report();
+    bench_master();
+    bench_e2e();
+    return 0;
+}
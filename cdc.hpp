@@ -0,0 +1,321 @@
+#ifndef CDC_HPP
+#define CDC_HPP
+
+#include "utils.hpp"
+#include "events.hpp"   // EventRole / EventKind name the table and operation
+#include "memory.hpp"   // accounting
+#include <vector>
+#include <cstdio>       // for remove() (retention)
+#include <cstdlib>      // for strtoull
+#include <initializer_list>
+
+// ---------------------------------------------------------------------------
+// cdc.hpp
+// ---------------------------------------------------------------------------
+// Change-data-capture stream for downstream analytics.
+//
+// saveToFile() rewrites a whole role file after every change, so an ETL job
+// that reads those files has to diff them. Instead, every change of the
+// four role containers (every event published with a record image, see
+// events.hpp) is also appended here as ONE line with a change
+// number (LSN) and the record's before/after image:
+//
+//   <lsn> TAB <role> TAB <insert|remove|update> TAB <before> TAB <after>
+//
+// An image is the record's fields joined with '|' (empty = no image, e.g.
+// no "before" for an insert). '\', TAB, newline and '|' inside a field are
+// escaped as \\, \t, \n and \|. Image fields per role:
+//   patients    : id|name|condition|room   (1 = main queue, 2 = room 2)
+//   supplies    : type|quantity|batch
+//   emergencies : patient|type|priority|patient ID
+//   ambulances  : plate|position in the rotation (0 = next up)
+//
+// Files:
+//   cdc_<first lsn>.log   segment files. A new segment starts when the
+//                         current one reaches CDC_SEGMENT_BYTES (rolling).
+//   cdc_manifest.txt      "<first lsn> <bytes>" per segment, oldest first.
+//                         Whole segments are deleted, oldest first, while
+//                         all segments together exceed CDC_RETAIN_BYTES.
+//   cdc_offsets.txt       "<consumer> <last lsn read>" per consumer.
+//
+// A consumer reads incrementally with
+//   main --cdc-read NAME
+// which prints every change after NAME's offset and then stores the new
+// offset. If retention already deleted changes the consumer had not read,
+// a warning with the missing LSN range is printed on cerr.
+//
+// Note: an escalation replayed from escalations.log after a crash (see
+// emergency.hpp) is emitted again, so consumers may see it twice.
+// ---------------------------------------------------------------------------
+
+#ifndef HOSPITAL_CDC_SEGMENT_BYTES
+#define HOSPITAL_CDC_SEGMENT_BYTES (64 * 1024)
+#endif
+#ifndef HOSPITAL_CDC_RETAIN_BYTES
+#define HOSPITAL_CDC_RETAIN_BYTES  (1024 * 1024)
+#endif
+
+const long long CDC_SEGMENT_BYTES = HOSPITAL_CDC_SEGMENT_BYTES;
+const long long CDC_RETAIN_BYTES  = HOSPITAL_CDC_RETAIN_BYTES;
+
+#define CDC_MANIFEST "cdc_manifest.txt"
+#define CDC_OFFSETS  "cdc_offsets.txt"
+
+typedef unsigned long long Lsn;
+
+inline string cdc_segment_name(Lsn first) {
+    char buf[40];
+    snprintf(buf, sizeof buf, "cdc_%012llu.log", first);
+    return buf;
+}
+
+// Escape one image field (see the format above)
+inline void cdc_escape(string& out, const string& field) {
+    for (char c : field) {
+        if      (c == '\\') out += "\\\\";
+        else if (c == '\t') out += "\\t";
+        else if (c == '\n') out += "\\n";
+        else if (c == '|')  out += "\\|";
+        else                out += c;
+    }
+}
+
+// Build an image from its fields, e.g. cdc_image({ id, name, cond, "1" })
+inline string cdc_image(initializer_list<string> fields) {
+    string img;
+    bool first = true;
+    for (const string& f : fields) {
+        if (!first) img += '|';
+        cdc_escape(img, f);
+        first = false;
+    }
+    return img;
+}
+
+// Split an image into its n unescaped fields, the first n strings of `out`
+// (returns n). The strings are reused from call to call, so a reader of
+// many lines rarely allocates.
+inline size_t cdc_fields(const char* p, const char* end, vector<string>& out) {
+    if (p == end) return 0;           // no image
+    size_t n = 0;
+    if (out.empty()) out.resize(1);
+    out[0].clear();
+    while (true) {
+        const char* q = p;            // copy up to the next '|' or escape
+        while (q < end && *q != '|' && *q != '\\') ++q;
+        out[n].append(p, q - p);
+        if (q == end) break;
+        if (*q == '|') {
+            if (++n == out.size()) out.resize(n + 1);
+            out[n].clear();
+            p = q + 1;
+        } else if (q + 1 < end) {
+            char c = q[1];
+            out[n] += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+            p = q + 2;
+        } else {
+            p = q + 1;
+        }
+    }
+    return n + 1;
+}
+
+// ---------------------------------------------------------------------------
+// CdcLog
+// ---------------------------------------------------------------------------
+// The writer. It opens lazily at the first change, continuing after the
+// last LSN found in the newest segment.
+// ---------------------------------------------------------------------------
+struct CdcSegment {
+    Lsn first;        // LSN of the first change in the segment
+    long long bytes;  // size of the segment file
+};
+
+struct CdcLog {
+    vector<CdcSegment> segments;   // oldest first, last one is active
+    ofstream out;                  // active segment
+    Lsn  nextLsn = 1;
+    bool opened  = false;
+
+    // ----------------------------------------------------------------------
+    // open()
+    // ----------------------------------------------------------------------
+    // Purpose : Read the manifest and find the next LSN by scanning the
+    //           newest segment (at most CDC_SEGMENT_BYTES).
+    // ----------------------------------------------------------------------
+    void open() {
+        opened = true;
+        segments.clear();
+        ifstream man(CDC_MANIFEST);
+        CdcSegment s;
+        while (man >> s.first >> s.bytes) segments.push_back(s);
+        if (segments.empty()) return;          // first segment made on append
+
+        CdcSegment& last = segments.back();
+        nextLsn = last.first;
+        ifstream in(cdc_segment_name(last.first));
+        string rec;
+        while (getline(in, rec)) {
+            Lsn lsn = strtoull(rec.c_str(), nullptr, 10);
+            if (lsn >= nextLsn) nextLsn = lsn + 1;
+        }
+        out.open(cdc_segment_name(last.first), ios::app);
+        out.seekp(0, ios::end);
+        last.bytes = (long long)out.tellp();
+    }
+
+    void saveManifest() const {
+        ofstream man(CDC_MANIFEST);
+        for (const CdcSegment& s : segments) man << s.first << ' ' << s.bytes << '\n';
+    }
+
+    // ----------------------------------------------------------------------
+    // roll()
+    // ----------------------------------------------------------------------
+    // Purpose : Start a new segment at nextLsn, then apply size-based
+    //           retention: drop the oldest segments while the total size
+    //           is above CDC_RETAIN_BYTES (the new segment always stays).
+    // ----------------------------------------------------------------------
+    void roll() {
+        if (out.is_open()) out.close();
+        segments.push_back(CdcSegment{ nextLsn, 0 });
+        out.open(cdc_segment_name(nextLsn), ios::trunc);
+
+        long long total = 0;
+        for (const CdcSegment& s : segments) total += s.bytes;
+        size_t drop = 0;
+        while (drop + 1 < segments.size() && total > CDC_RETAIN_BYTES) {
+            total -= segments[drop].bytes;
+            remove(cdc_segment_name(segments[drop].first).c_str());
+            drop++;
+        }
+        segments.erase(segments.begin(), segments.begin() + drop);
+        saveManifest();
+    }
+
+    // ----------------------------------------------------------------------
+    // append()
+    // ----------------------------------------------------------------------
+    // Purpose : Write one change line and flush it, rolling to a new
+    //           segment first if the active one is full.
+    // ----------------------------------------------------------------------
+    void append(EventRole role, EventKind kind,
+                const string& before, const string& after) {
+        if (!opened) open();
+        if (segments.empty() || segments.back().bytes >= CDC_SEGMENT_BYTES) roll();
+
+        string rec = to_string(nextLsn++);
+        rec += '\t';  rec += event_role_name(role);
+        rec += '\t';  rec += event_kind_name(kind);
+        rec += '\t';  rec += before;
+        rec += '\t';  rec += after;
+        rec += '\n';
+        out << rec << flush;
+        if (!out) {
+            cout << "[Error] Cannot write change stream segment.\n";
+            out.clear();
+            return;
+        }
+        segments.back().bytes += (long long)rec.size();
+    }
+};
+
+// The change stream of this process (C++17 inline variable)
+inline CdcLog gCdc;
+
+// Writer state and its file buffer (BUFSIZ while a segment is open)
+inline MemRegister gCdcMem(MEM_SHARED, "change stream writer", [] {
+    return sizeof(gCdc) + mem_vector(gCdc.segments) + (gCdc.out.is_open() ? BUFSIZ : 0);
+});
+
+// Append one change (the bus listener below; benchmarks call it directly)
+inline void cdc_emit(EventRole role, EventKind kind,
+                     const string& before, const string& after) {
+    gCdc.append(role, kind, before, after);
+}
+
+// Every published event that carries a record image is one change
+inline EventListen gCdcListen([](const Event& ev, const string& before,
+                                 const string& after) {
+    if (!before.empty() || !after.empty())
+        cdc_emit((EventRole)ev.role, (EventKind)ev.kind, before, after);
+});
+
+// ---------------------------------------------------------------------------
+// Consumer offsets
+// ---------------------------------------------------------------------------
+inline Lsn cdc_load_offset(const string& consumer) {
+    ifstream in(CDC_OFFSETS);
+    string name;
+    Lsn off;
+    while (in >> name >> off)
+        if (name == consumer) return off;
+    return 0;
+}
+
+inline void cdc_store_offset(const string& consumer, Lsn offset) {
+    vector<pair<string, Lsn> > all;
+    {
+        ifstream in(CDC_OFFSETS);
+        string name;
+        Lsn off;
+        while (in >> name >> off)
+            if (name != consumer) all.push_back(make_pair(name, off));
+    }
+    all.push_back(make_pair(consumer, offset));
+    ofstream out(CDC_OFFSETS);
+    for (auto& c : all) out << c.first << ' ' << c.second << '\n';
+}
+
+// ---------------------------------------------------------------------------
+// cdc_read_cli()
+// ---------------------------------------------------------------------------
+// Purpose : "--cdc-read NAME": print every change after NAME's offset to
+//           stdout (same line format as the segments) and commit the
+//           offset of the last change printed.
+// Return  : process exit code.
+// ---------------------------------------------------------------------------
+inline int cdc_read_cli(const string& consumer) {
+    if (consumer.find_first_of(" \t") != string::npos || consumer.empty()) {
+        cerr << "[Error] Consumer name must be one word.\n";
+        return 1;
+    }
+    Lsn offset = cdc_load_offset(consumer);
+
+    vector<CdcSegment> segments;
+    ifstream man(CDC_MANIFEST);
+    CdcSegment s;
+    while (man >> s.first >> s.bytes) segments.push_back(s);
+
+    if (!segments.empty() && segments[0].first > offset + 1)
+        cerr << "[Warn] " << consumer << ": changes " << (offset + 1) << ".."
+             << (segments[0].first - 1) << " were removed by retention.\n";
+
+    Lsn last = offset;
+    long long n = 0;
+    bool partial = false;
+    for (size_t i = 0; i < segments.size() && !partial; ++i) {
+        // Skip whole segments that end before the offset
+        if (i + 1 < segments.size() && segments[i + 1].first <= offset + 1) continue;
+        ifstream in(cdc_segment_name(segments[i].first));
+        string rec;
+        while (getline(in, rec)) {
+            // No '\n' yet: the writer is still appending this line. Stop at
+            // the last complete one; the next read starts from there.
+            if (in.eof()) {
+                partial = true;
+                break;
+            }
+            Lsn lsn = strtoull(rec.c_str(), nullptr, 10);
+            if (lsn <= last) continue;
+            cout << rec << '\n';
+            last = lsn;
+            n++;
+        }
+    }
+    cdc_store_offset(consumer, last);
+    cerr << "[CDC] " << consumer << ": " << n << " change(s), offset now " << last << "\n";
+    return 0;
+}
+
+#endif
@@ -0,0 +1,532 @@
+#ifndef CREW_HPP
+#define CREW_HPP
+
+#include "utils.hpp"
+#include "memory.hpp"   // accounting (ambulance role)
+#include <vector>
+#include <unordered_map>
+#include <chrono>     // for steady_clock (repair timing)
+#include <ctime>      // for localtime (current hour)
+
+#define CREW_FILE "crew.txt"
+
+// ==========================================================================
+// AMBULANCE CREWS (part of ROLE 4)
+// --------------------------------------------------------------------------
+// Crew members have certifications and a daily shift, and are assigned to
+// the units of the ambulance rotation so that every unit is staffed.
+//
+// Staffing rules:
+//   - every unit has two positions: a driver (needs D) and a medic (needs
+//     P; units whose plate starts with "ICU" need P and I);
+//   - a crew member can fill a position in hour h if their shift covers
+//     the whole hour and they have not called in sick;
+//   - nobody fills two positions in the same hour.
+//
+// Engine: the day is split into ROSTER_SLOTS hourly slots, and each slot is
+// a bipartite matching of positions to crew members (augmenting paths,
+// Kuhn's algorithm). Hour h is built from hour h-1: whoever staffed a
+// position and is still on shift keeps it, so a crew member stays on one
+// unit for their whole shift (interval scheduling), and only the gaps are
+// searched for.
+//
+// Changes are repaired incrementally instead of rebuilding the roster:
+//   - call in sick: in every hour the member was on, free their position
+//     and search ONE augmenting path from it;
+//   - new crew member / back from sick: in every hour their shift covers,
+//     ONE search that starts from them (a new path can only end at the
+//     member who became available), trying the positions they are
+//     certified for;
+//   - new unit: search paths only from the new unit's two positions.
+// Each search is O(edges of one slot), so even thousands of crew members
+// are repaired in well under a millisecond.
+//
+// File format (CREW_FILE), 5 lines per crew member:
+//   id, name, certifications (letters D, P, I), shift "HH:MM-HH:MM"
+//   (may pass midnight, e.g. 19:00-07:00), status ("on" or "sick")
+// ==========================================================================
+
+const int ROSTER_SLOTS = 24;     // one slot per hour of the day
+
+enum CrewCert { CERT_DRIVER = 1, CERT_PARAMEDIC = 2, CERT_ICU = 4 };
+
+// Kinds of positions, and the certifications each one needs
+enum PositionType { POS_DRIVER, POS_MEDIC, POS_ICU_MEDIC, POS_TYPES };
+const int POS_CERTS[POS_TYPES] = { CERT_DRIVER, CERT_PARAMEDIC, CERT_PARAMEDIC | CERT_ICU };
+
+struct CrewMember {
+    string id;
+    string name;
+    int    certs;     // CrewCert bits
+    int    start;     // shift start, minutes after midnight
+    int    end;       // shift end (end <= start: the shift passes midnight)
+    bool   sick;
+};
+
+// Certifications as letters, e.g. "DP"
+inline string crew_certs_str(int certs) {
+    string s;
+    if (certs & CERT_DRIVER)    s += 'D';
+    if (certs & CERT_PARAMEDIC) s += 'P';
+    if (certs & CERT_ICU)       s += 'I';
+    return s.empty() ? "-" : s;
+}
+
+// Parse letters D/P/I (any case); false if another letter is used
+inline bool crew_parse_certs(const string& s, int& certs) {
+    certs = 0;
+    for (char c : s) {
+        if      (c == 'D' || c == 'd') certs |= CERT_DRIVER;
+        else if (c == 'P' || c == 'p') certs |= CERT_PARAMEDIC;
+        else if (c == 'I' || c == 'i') certs |= CERT_ICU;
+        else if (c != ' ' && c != ',') return false;
+    }
+    return certs != 0;
+}
+
+inline string crew_time_str(int minutes) {
+    char buf[8];
+    snprintf(buf, sizeof buf, "%02d:%02d", minutes / 60 % 24, minutes % 60);
+    return buf;
+}
+
+// Parse "HH:MM-HH:MM" into minutes after midnight
+inline bool crew_parse_shift(const string& s, int& start, int& end) {
+    int h1, m1, h2, m2;
+    if (sscanf(s.c_str(), "%d:%d-%d:%d", &h1, &m1, &h2, &m2) != 4) return false;
+    if (h1 < 0 || h1 > 23 || h2 < 0 || h2 > 24 || m1 < 0 || m1 > 59 || m2 < 0 || m2 > 59)
+        return false;
+    start = h1 * 60 + m1;
+    end   = (h2 * 60 + m2) % (24 * 60);
+    return start != end;
+}
+
+// true if the shift covers the whole hour `slot`
+inline bool crew_covers(const CrewMember& c, int slot) {
+    int a = slot * 60, b = a + 60;
+    if (c.start < c.end) return c.start <= a && b <= c.end;
+    return a >= c.start || b <= c.end;               // passes midnight
+}
+
+// ---------------------------------------------------------------------------
+// CrewRoster
+// ---------------------------------------------------------------------------
+struct CrewRoster {
+    vector<CrewMember> crew;
+    unordered_map<string, int> byId;   // crew ID -> index in crew
+    vector<string> units;              // plates; unit u has positions 2u, 2u+1
+
+    // Per slot: who fills each position (-1 = nobody), which position each
+    // crew member fills (-1 = none), and the crew members who could fill
+    // each type of position in that hour
+    vector<int> posCrew[ROSTER_SLOTS];
+    vector<int> crewPos[ROSTER_SLOTS];
+    vector<int> cand[ROSTER_SLOTS][POS_TYPES];
+
+    // Visit marks of the augmenting-path searches (stamp instead of
+    // clearing): crew members in augment(), positions in augmentFrom()
+    vector<unsigned> seen;
+    vector<unsigned> posSeen;
+    unsigned stamp = 0;
+
+    int positions() const { return (int)units.size() * 2; }
+
+    PositionType posType(int p) const {
+        if (p % 2 == 0) return POS_DRIVER;
+        return units[p / 2].compare(0, 3, "ICU") == 0 ? POS_ICU_MEDIC : POS_MEDIC;
+    }
+
+    bool eligible(int c, PositionType t, int slot) const {
+        const CrewMember& m = crew[c];
+        return !m.sick && (m.certs & POS_CERTS[t]) == POS_CERTS[t] && crew_covers(m, slot);
+    }
+
+    // Put crew member c into the candidate lists of the hours they work
+    void addCandidate(int c) {
+        for (int s = 0; s < ROSTER_SLOTS; ++s) {
+            crewPos[s].push_back(-1);
+            for (int t = 0; t < POS_TYPES; ++t)
+                if ((crew[c].certs & POS_CERTS[t]) == POS_CERTS[t] && crew_covers(crew[c], s))
+                    cand[s][t].push_back(c);
+        }
+        seen.push_back(0);
+    }
+
+    // ----------------------------------------------------------------------
+    // augment()
+    // ----------------------------------------------------------------------
+    // Purpose : Try to staff position p in hour `slot`, moving other crew
+    //           members to other positions if that frees someone suitable.
+    //           A free crew member is taken first, so the roster changes as
+    //           little as possible.
+    // Return  : true if p is staffed afterwards.
+    // ----------------------------------------------------------------------
+    bool augment(int slot, int p) {
+        for (int c : cand[slot][posType(p)]) {
+            if (crewPos[slot][c] >= 0 || crew[c].sick) continue;
+            posCrew[slot][p] = c;
+            crewPos[slot][c] = p;
+            return true;
+        }
+        for (int c : cand[slot][posType(p)]) {
+            if (seen[c] == stamp || crew[c].sick) continue;
+            seen[c] = stamp;
+            int q = crewPos[slot][c];
+            if (q < 0 || augment(slot, q)) {
+                posCrew[slot][p] = c;
+                crewPos[slot][c] = p;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool staff(int slot, int p) {
+        ++stamp;
+        return augment(slot, p);
+    }
+
+    // ----------------------------------------------------------------------
+    // augmentFrom()
+    // ----------------------------------------------------------------------
+    // Purpose : The same search from the other side: find a position for
+    //           crew member c (free in hour `slot`), moving the holder of a
+    //           position c is certified for to another one if needed. An
+    //           empty position is taken first, the one c held in the hour
+    //           before if possible.
+    // Return  : true if c is placed afterwards.
+    // ----------------------------------------------------------------------
+    bool augmentFrom(int slot, int c) {
+        int prev = crewPos[(slot + ROSTER_SLOTS - 1) % ROSTER_SLOTS][c];
+        if (prev >= 0 && posCrew[slot][prev] < 0 && eligible(c, posType(prev), slot)) {
+            posCrew[slot][prev] = c;
+            crewPos[slot][c] = prev;
+            return true;
+        }
+        for (int p = 0; p < positions(); ++p) {
+            if (posCrew[slot][p] >= 0 || !eligible(c, posType(p), slot)) continue;
+            posCrew[slot][p] = c;
+            crewPos[slot][c] = p;
+            return true;
+        }
+        for (int p = 0; p < positions(); ++p) {
+            if (posSeen[p] == stamp || !eligible(c, posType(p), slot)) continue;
+            posSeen[p] = stamp;
+            int d = posCrew[slot][p];
+            crewPos[slot][d] = -1;             // d looks for another position
+            if (augmentFrom(slot, d)) {
+                posCrew[slot][p] = c;
+                crewPos[slot][c] = p;
+                return true;
+            }
+            crewPos[slot][d] = p;
+        }
+        return false;
+    }
+
+    // Crew member c has become available (new, or back from sick): place
+    // them in every hour they work, one search per hour
+    void placeCrew(int c) {
+        posSeen.resize(positions(), 0);
+        for (int s = 0; s < ROSTER_SLOTS; ++s) {
+            if (crewPos[s][c] >= 0 || !crew_covers(crew[c], s)) continue;
+            ++stamp;
+            augmentFrom(s, c);
+        }
+    }
+
+    // Staff the empty positions [from, to) of one hour (all by default);
+    // the first pass prefers whoever held the position in the hour before
+    // (same unit for the whole shift)
+    void fillSlot(int s, int from = 0, int to = -1) {
+        if (to < 0) to = positions();
+        int prev = (s + ROSTER_SLOTS - 1) % ROSTER_SLOTS;
+        for (int p = from; p < to; ++p) {
+            if (posCrew[s][p] >= 0) continue;
+            int c = posCrew[prev][p];
+            if (c >= 0 && crewPos[s][c] < 0 && eligible(c, posType(p), s)) {
+                posCrew[s][p] = c;
+                crewPos[s][c] = p;
+            }
+        }
+        for (int p = from; p < to; ++p)
+            if (posCrew[s][p] < 0) staff(s, p);
+    }
+
+    // ----------------------------------------------------------------------
+    // rebuild()
+    // ----------------------------------------------------------------------
+    // Purpose : Build the whole roster from scratch (after loading).
+    // ----------------------------------------------------------------------
+    void rebuild() {
+        for (int s = 0; s < ROSTER_SLOTS; ++s) {
+            posCrew[s].assign(positions(), -1);
+            crewPos[s].clear();
+            for (int t = 0; t < POS_TYPES; ++t) cand[s][t].clear();
+        }
+        seen.clear();
+        for (int c = 0; c < (int)crew.size(); ++c) addCandidate(c);
+        for (int s = 0; s < ROSTER_SLOTS; ++s) fillSlot(s);
+        // Hour 0 was built before hour 23 existed: let it continue hour 23
+        // where the positions are still free
+        fillSlot(0);
+    }
+
+    // Add units that are new in the rotation and staff them
+    void syncUnits(const vector<string>& plates) {
+        for (const string& plate : plates) {
+            bool known = false;
+            for (const string& u : units) known = known || u == plate;
+            if (known) continue;
+            units.push_back(plate);
+            for (int s = 0; s < ROSTER_SLOTS; ++s) posCrew[s].resize(positions(), -1);
+            for (int s = 0; s < ROSTER_SLOTS; ++s)   // only the new positions
+                fillSlot(s, positions() - 2, positions());
+        }
+    }
+
+    // Add a crew member and staff whatever they can now cover
+    bool addMember(const CrewMember& m) {
+        if (byId.count(m.id)) return false;
+        byId[m.id] = (int)crew.size();
+        crew.push_back(m);
+        addCandidate((int)crew.size() - 1);
+        placeCrew((int)crew.size() - 1);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------
+    // callInSick()
+    // ----------------------------------------------------------------------
+    // Purpose : Take crew member c off the roster and repair every hour
+    //           they were staffing with one augmenting-path search each.
+    // Return  : number of hours that are still short-staffed afterwards.
+    // ----------------------------------------------------------------------
+    int callInSick(int c) {
+        crew[c].sick = true;
+        int gaps = 0;
+        for (int s = 0; s < ROSTER_SLOTS; ++s) {
+            int p = crewPos[s][c];
+            if (p < 0) continue;
+            crewPos[s][c] = -1;
+            posCrew[s][p] = -1;
+            if (!staff(s, p)) gaps++;
+        }
+        return gaps;
+    }
+
+    // Back on duty: fill the gaps they can cover
+    void backOnDuty(int c) {
+        crew[c].sick = false;
+        placeCrew(c);
+    }
+
+    // true if both positions of unit `plate` are filled in hour `slot`. With
+    // no crew on file staffing is not tracked and every unit counts.
+    bool staffed(const string& plate, int slot) const {
+        if (crew.empty()) return true;
+        for (size_t u = 0; u < units.size(); ++u)
+            if (units[u] == plate)
+                return posCrew[slot][2 * u] >= 0 && posCrew[slot][2 * u + 1] >= 0;
+        return false;
+    }
+
+    // Positions nobody staffs, over all hours
+    int unstaffed() const {
+        int n = 0;
+        for (int s = 0; s < ROSTER_SLOTS; ++s)
+            for (int c : posCrew[s]) n += (c < 0);
+        return n;
+    }
+
+    // ----------------------------------------------------------------------
+    // print()
+    // ----------------------------------------------------------------------
+    // Purpose : Show who staffs every unit in hour `slot`.
+    // ----------------------------------------------------------------------
+    void print(int slot) const {
+        cout << "Crew roster " << crew_time_str(slot * 60) << "-"
+             << crew_time_str(slot * 60 + 60) << "\n";
+        line();
+        cout << left << setw(12) << "Unit" << setw(24) << "Driver" << "Medic" << "\n";
+        line();
+        for (size_t u = 0; u < units.size(); ++u) {
+            cout << left << setw(12) << units[u];
+            for (int k = 0; k < 2; ++k) {
+                int c = posCrew[slot][2 * u + k];
+                string who = c < 0 ? "UNSTAFFED" : crew[c].name + " (" + crew[c].id + ")";
+                if (k == 0) cout << setw(24) << who;
+                else        cout << who;
+            }
+            cout << "\n";
+        }
+        int n = unstaffed();
+        if (n) cout << "[Warn] " << n << " position-hour(s) unstaffed over the day.\n";
+    }
+
+    // ----------------------------------------------------------------------
+    // saveToFile() / loadFromFile()
+    // ----------------------------------------------------------------------
+    // Format  : see the top of this file (5 lines per crew member).
+    // ----------------------------------------------------------------------
+    void saveToFile(const char* filename) const {
+        ofstream out(filename);
+        if (!out) {
+            cout << "[Error] Cannot open " << filename << " for writing.\n";
+            return;
+        }
+        for (const CrewMember& m : crew)
+            out << m.id << '\n' << m.name << '\n' << crew_certs_str(m.certs) << '\n'
+                << crew_time_str(m.start) << '-' << crew_time_str(m.end) << '\n'
+                << (m.sick ? "sick" : "on") << '\n';
+    }
+
+    void loadFromFile(const char* filename) {
+        crew.clear();
+        byId.clear();
+        ifstream in(filename);
+        if (!in) {
+            load_log() << "[Info] " << filename
+                 << " not found. Starting with no crew.\n";
+            rebuild();
+            return;
+        }
+        while (true) {
+            string id, name, certs, shift, status;
+            if (!getline(in, id)) break;
+            if (id.empty()) continue;
+            if (!getline(in, name) || !getline(in, certs) ||
+                !getline(in, shift) || !getline(in, status)) break;
+            CrewMember m;
+            m.id   = id;
+            m.name = name;
+            m.sick = (status == "sick");
+            if (!crew_parse_certs(certs, m.certs) ||
+                !crew_parse_shift(shift, m.start, m.end) || byId.count(id)) {
+                load_log() << "[Warn] Skipping bad crew record " << id << ".\n";
+                continue;
+            }
+            byId[id] = (int)crew.size();
+            crew.push_back(m);
+        }
+        rebuild();
+        load_log() << "[OK] Loaded crew from " << filename
+             << " (count=" << crew.size() << ")\n";
+    }
+};
+
+// Crew of the ambulance service (C++17 inline variable)
+inline CrewRoster gRoster;
+
+inline MemRegister gRosterMem(MEM_AMBULANCES, "crew roster", [] {
+    const CrewRoster& r = gRoster;
+    size_t b = mem_vector(r.crew) + mem_hash(r.byId) + mem_vector(r.units) + mem_vector(r.seen);
+    for (const CrewMember& m : r.crew) b += mem_string(m.id) + mem_string(m.name);
+    for (const auto& kv : r.byId) b += mem_string(kv.first);
+    for (const string& u : r.units) b += mem_string(u);
+    for (int s = 0; s < ROSTER_SLOTS; ++s) {
+        b += mem_vector(r.posCrew[s]) + mem_vector(r.crewPos[s]);
+        for (int t = 0; t < POS_TYPES; ++t) b += mem_vector(r.cand[s][t]);
+    }
+    return b;
+});
+
+// Hour of the day now (local time), the roster slot shown by default
+inline int crew_current_slot() {
+    time_t t = time(nullptr);
+    tm* lt = localtime(&t);
+    return lt ? lt->tm_hour : 0;
+}
+
+// ====================== UI FUNCTIONS FOR CREWS ============================
+
+// --------------------------------------------------------------------------
+// ui_view_roster()
+// --------------------------------------------------------------------------
+// Purpose : Show the roster of the current hour, or of an hour the user
+//           enters (empty line = now).
+// --------------------------------------------------------------------------
+inline void ui_view_roster() {
+    cout << "Hour (0-23, empty = now): ";
+    string s;
+    safe_getline(s);
+    int slot = crew_current_slot();
+    if (!s.empty()) {
+        char* end;
+        long h = strtol(s.c_str(), &end, 10);
+        if (*end || h < 0 || h >= ROSTER_SLOTS) {
+            cout << "Invalid hour.\n";
+            return;
+        }
+        slot = (int)h;
+    }
+    gRoster.print(slot);
+}
+
+// --------------------------------------------------------------------------
+// ui_register_crew()
+// --------------------------------------------------------------------------
+// Purpose : Add a crew member and staff the positions they can cover.
+// --------------------------------------------------------------------------
+inline void ui_register_crew() {
+    CrewMember m;
+    m.sick = false;
+    cout << "Crew ID (e.g., C041): ";
+    safe_getline(m.id);
+    if (m.id.empty() || gRoster.byId.count(m.id)) {
+        cout << "Crew ID is empty or already registered.\n";
+        return;
+    }
+    cout << "Name: ";
+    safe_getline(m.name);
+
+    string s;
+    cout << "Certifications (D = driver, P = paramedic, I = ICU, e.g. DP): ";
+    safe_getline(s);
+    if (!crew_parse_certs(s, m.certs)) {
+        cout << "Invalid certifications.\n";
+        return;
+    }
+    cout << "Shift (HH:MM-HH:MM, e.g. 07:00-19:00): ";
+    safe_getline(s);
+    if (!crew_parse_shift(s, m.start, m.end)) {
+        cout << "Invalid shift.\n";
+        return;
+    }
+    gRoster.addMember(m);
+    cout << "Crew member registered.\n";
+    gRoster.saveToFile(CREW_FILE);
+}
+
+// --------------------------------------------------------------------------
+// ui_crew_sick()
+// --------------------------------------------------------------------------
+// Purpose : A crew member calls in sick (or comes back): repair the roster
+//           incrementally and report how long that took.
+// --------------------------------------------------------------------------
+inline void ui_crew_sick() {
+    cout << "Crew ID: ";
+    string id;
+    safe_getline(id);
+    auto it = gRoster.byId.find(id);
+    if (it == gRoster.byId.end()) {
+        cout << "No crew member " << id << ".\n";
+        return;
+    }
+    int c = it->second;
+    auto t0 = chrono::steady_clock::now();
+    int gaps = 0;
+    bool sick = !gRoster.crew[c].sick;
+    if (sick) gaps = gRoster.callInSick(c);
+    else      gRoster.backOnDuty(c);
+    auto us = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - t0).count();
+
+    cout << gRoster.crew[c].name << (sick ? " called in sick" : " is back on duty")
+         << "; roster repaired in " << us << " us.\n";
+    if (gaps)
+        cout << "[Warn] No replacement found for " << gaps << " hour(s).\n";
+    gRoster.saveToFile(CREW_FILE);
+}
+
+#endif
@@ -0,0 +1,383 @@
+#ifndef DISPATCH_HPP
+#define DISPATCH_HPP
+
+#include "utils.hpp"
+#include "emergency.hpp"   // cases come from gEmerg
+#include "ambulance.hpp"   // units come from gAmb, staffing from gRoster
+#include <vector>
+#include <algorithm>       // for stable_sort (cases by weight)
+#include <chrono>          // for steady_clock (solve time)
+#include <cctype>          // for tolower (case type keywords)
+
+// ==========================================================================
+// BATCH DISPATCH (ROLE 3 -> ROLE 4)
+// --------------------------------------------------------------------------
+// When several cases are waiting, sending the next unit in the rotation to
+// the most critical case, one case at a time, can leave the wrong unit on
+// the wrong case (an ICU unit on a sprain while the next stroke gets a
+// standard crew). Batch dispatch takes the K most critical cases and all
+// units that are staffed this hour and assigns them together, minimising
+// the total priority-weighted response cost.
+//
+// Cost of sending unit j to case i (in minutes, see the constants below):
+//   (priority_i + 1) * ( travel_ij
+//                      + DISPATCH_NO_ICU_MIN if i needs ICU care and j is
+//                        not an ICU unit )
+//   + DISPATCH_ICU_RESERVE if i does not need ICU care and j is an ICU unit
+// travel_ij is the road travel time from j's stand-by position to the
+// incident (roads.hpp) when the dispatcher gives the incident position,
+// else DISPATCH_RANK_MIN per place of j in the rotation.
+// A case needs ICU care if its priority is DISPATCH_ICU_PRIORITY or more, or
+// its type names one of the conditions in case_needs_icu().
+//
+// Solver:
+//   - No incident positions (assign_dispatch()): the cost only depends on
+//     the case's weight and ICU need, and on the unit's place and class
+//     (ICU or standard). Within one class an optimal assignment uses the
+//     units nearest the front and gives them to the heaviest cases first,
+//     so only the split of the cases between the two classes is left to
+//     choose: a DP over the cases, heaviest first, on how many went to ICU
+//     units. O(K * ICU units), well under a millisecond for K in the
+//     hundreds.
+//   - With road travel times the cost is no longer linear in the place in
+//     the rotation and the DP does not apply: the general Hungarian method
+//     (assign_min_cost(), O(K^2 * units)) solves the K x units matrix of
+//     dispatch_cost(). It is also the reference in the dispatch benchmark
+//     in bench.cpp.
+// Units left over stay in the rotation.
+// ==========================================================================
+
+const double DISPATCH_RANK_MIN     = 1.0;   // per place further back in rotation
+const double DISPATCH_NO_ICU_MIN   = 15.0;  // ICU team has to meet the unit
+const double DISPATCH_ICU_RESERVE  = 20.0;  // ICU unit tied up on a basic case
+const int    DISPATCH_ICU_PRIORITY = 9;
+
+// true if the case should get an ICU unit
+inline bool case_needs_icu(const string& type, int priority) {
+    static const char* words[] = { "stroke", "cardiac", "heart", "arrest", "seizure",
+                                   "trauma", "pregnan", "breath", "unconscious" };
+    if (priority >= DISPATCH_ICU_PRIORITY) return true;
+    string t;
+    for (char c : type) t += (char)tolower((unsigned char)c);
+    for (const char* w : words)
+        if (t.find(w) != string::npos) return true;
+    return false;
+}
+
+inline bool unit_is_icu(const string& plate) {
+    return plate.compare(0, 3, "ICU") == 0;   // same rule as the crew roster
+}
+
+// --------------------------------------------------------------------------
+// assign_min_cost()
+// --------------------------------------------------------------------------
+// Purpose : Minimum-cost assignment of n rows to m columns (n <= m).
+// Input   : cost[i * m + j] = cost of giving column j to row i.
+// Return  : for every row, its column.
+// Note    : Rows are added one at a time; each gets a shortest augmenting
+//           path over reduced costs (Jonker-Volgenant). The columns are
+//           kept in one array split into scanned | at the current minimum
+//           distance | not reached yet, so every step only looks at the
+//           columns not reached yet, and the search stops at the first
+//           free column at the minimum distance (many equal costs are
+//           common here: units differ mostly by their place in rotation).
+// --------------------------------------------------------------------------
+inline vector<int> assign_min_cost(const vector<double>& cost, int n, int m) {
+    vector<double> v(m, 0), d(m);      // column potentials, path distances
+    vector<int> rowOf(m, -1), colOf(n, -1), pred(m), cols(m);
+    for (int f = 0; f < n; ++f) {
+        const double* cf = &cost[(size_t)f * m];
+        for (int j = 0; j < m; ++j) {
+            cols[j] = j;
+            d[j] = cf[j] - v[j];
+            pred[j] = f;
+        }
+        // cols[0, lo) scanned, [lo, hi) at distance `mind`, [hi, m) the rest
+        int lo = 0, hi = 0, ready = 0, end = -1;
+        double mind = 0;
+        while (end < 0) {
+            if (lo == hi) {                    // next distance level
+                ready = lo;
+                mind = d[cols[lo]];
+                hi = lo + 1;
+                for (int k = hi; k < m; ++k) {
+                    int j = cols[k];
+                    if (d[j] > mind) continue;
+                    if (d[j] < mind) { hi = lo; mind = d[j]; }
+                    cols[k] = cols[hi];
+                    cols[hi++] = j;
+                }
+                for (int k = lo; k < hi && end < 0; ++k)
+                    if (rowOf[cols[k]] < 0) end = cols[k];
+                if (end >= 0) break;
+            }
+            int j1 = cols[lo++];               // extend the path through j1
+            int i = rowOf[j1];
+            const double* ci = &cost[(size_t)i * m];
+            double h = ci[j1] - v[j1] - mind;
+            for (int k = hi; k < m; ++k) {
+                int j = cols[k];
+                double cred = ci[j] - v[j] - h;
+                if (cred >= d[j]) continue;
+                d[j] = cred;
+                pred[j] = i;
+                if (cred == mind) {
+                    if (rowOf[j] < 0) { end = j; break; }
+                    cols[k] = cols[hi];
+                    cols[hi++] = j;
+                }
+            }
+        }
+        for (int k = 0; k < ready; ++k) {      // keep reduced costs >= 0
+            int j = cols[k];
+            v[j] += d[j] - mind;
+        }
+        for (int j = end;;) {                  // flip the path back to f
+            int i = pred[j];
+            rowOf[j] = i;
+            swap(colOf[i], j);
+            if (i == f) break;
+        }
+    }
+    return colOf;
+}
+
+// One case taken from gEmerg for a batch (strings copied out of its pool)
+struct DispatchCase {
+    string patient, type, patientId;
+    int    priority;
+    bool   icu;
+    int    to = -1;     // junction of the incident (roads.hpp), -1 = not known
+};
+
+// Travel part of the cost for the unit at place `rank` in the rotation
+inline double dispatch_travel_min(const DispatchCase& c, int rank) {
+    if (c.to < 0) return DISPATCH_RANK_MIN * rank;
+    return unit_eta(rank, c.to) / 60.0;
+}
+
+// Cost of one case/unit pair, see the top of this file
+inline double dispatch_cost(const DispatchCase& c, int rank, bool icuUnit) {
+    double minutes = dispatch_travel_min(c, rank);
+    if (c.icu && !icuUnit) minutes += DISPATCH_NO_ICU_MIN;
+    double cost = (c.priority + 1) * minutes;
+    if (!c.icu && icuUnit) cost += DISPATCH_ICU_RESERVE;
+    return cost;
+}
+
+// --------------------------------------------------------------------------
+// assign_dispatch()
+// --------------------------------------------------------------------------
+// Purpose : Minimum total dispatch_cost() assignment of the cases to the
+//           units (cases.size() <= units).
+// Input   : rank[j] = place of unit j in the rotation, icu[j] = its class.
+//           No case may have an incident position (see the top of this
+//           file): the method needs the cost to be linear in rank.
+// Return  : for every case, its unit.
+// Method  : dispatch_cost() is (priority + 1) * rank + a term of the case
+//           and the unit's class only, so (exchange argument)
+//             - a class's chosen units are its first ones by rank, and
+//             - within a class, heavier cases get the lower ranks.
+//           Taking the cases heaviest first, case i with a cases already
+//           on ICU units goes to ICU unit a or to standard unit i - a:
+//           best[i][a] is a DP with two moves per state, traced back
+//           through the stored moves. Equal weights may go either way at
+//           the same cost.
+// --------------------------------------------------------------------------
+inline vector<int> assign_dispatch(const vector<DispatchCase>& cases,
+                                   const vector<int>& rank, const vector<bool>& icu) {
+    int n = (int)cases.size();
+    vector<int> order(n), icuUnits, stdUnits;
+    for (int i = 0; i < n; ++i) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return cases[a].priority > cases[b].priority;
+    });
+    for (int j = 0; j < (int)rank.size(); ++j) (icu[j] ? icuUnits : stdUnits).push_back(j);
+    auto byRank = [&](int a, int b) { return rank[a] < rank[b]; };
+    stable_sort(icuUnits.begin(), icuUnits.end(), byRank);
+    stable_sort(stdUnits.begin(), stdUnits.end(), byRank);
+
+    const int nI = (int)icuUnits.size(), nS = (int)stdUnits.size(), w = nI + 1;
+    const double NONE = numeric_limits<double>::infinity();
+    vector<double> best(w, NONE), next(w);
+    vector<char> toIcu((size_t)(n + 1) * w, 0);   // move taken into [i][a]
+    best[0] = 0;
+    for (int i = 0; i < n; ++i) {
+        const DispatchCase& c = cases[order[i]];
+        fill(next.begin(), next.end(), NONE);
+        for (int a = 0; a <= min(i, nI); ++a) {
+            if (best[a] == NONE) continue;
+            if (a < nI) {
+                double t = best[a] + dispatch_cost(c, rank[icuUnits[a]], true);
+                if (t < next[a + 1]) {
+                    next[a + 1] = t;
+                    toIcu[(size_t)(i + 1) * w + a + 1] = 1;
+                }
+            }
+            if (i - a < nS) {
+                double t = best[a] + dispatch_cost(c, rank[stdUnits[i - a]], false);
+                if (t < next[a]) {
+                    next[a] = t;
+                    toIcu[(size_t)(i + 1) * w + a] = 0;
+                }
+            }
+        }
+        best.swap(next);
+    }
+    int a = (int)(min_element(best.begin(), best.end()) - best.begin());
+    vector<int> unitOf(n, -1);
+    for (int i = n; i > 0; --i) {
+        if (toIcu[(size_t)i * w + a]) unitOf[order[i - 1]] = icuUnits[--a];
+        else unitOf[order[i - 1]] = stdUnits[i - 1 - a];
+    }
+    return unitOf;
+}
+
+// --------------------------------------------------------------------------
+// send_to_back()
+// --------------------------------------------------------------------------
+// Purpose : Move the dispatched units (sent[i] = true for the i-th unit in
+//           rotation order) to the back of the rotation, keeping their
+//           order, and record the new places.
+// --------------------------------------------------------------------------
+inline void send_to_back(const vector<bool>& sent) {
+    vector<Ambulance> order;
+    for (int pass = 0; pass < 2; ++pass)
+        for (int i = 0; i < gAmb.count; ++i)
+            if (sent[i] == (pass == 1))
+                order.push_back(gAmb.data[(gAmb.head + i) % MAX_AMBULANCES]);
+    vector<string> before = amb_plates();
+    gAmb.clear();
+    for (const Ambulance& a : order) gAmb.enqueue(a);
+    for (int i = 0; i < gAmb.count; ++i) {
+        const char* plate = gAmb.data[i].plate;
+        int was = 0;
+        while (before[was] != plate) ++was;
+        if (was != i)
+            publish_event(EV_AMBULANCES, EV_UPDATE, plate, i,
+                          cdc_image({ plate, to_string(was) }),
+                          cdc_image({ plate, to_string(i) }));
+    }
+    gAmb.saveToFile(AMB_FILE);
+}
+
+// --------------------------------------------------------------------------
+// ui_batch_dispatch()
+// --------------------------------------------------------------------------
+// Purpose : Dispatch the most critical cases to the staffed units at once.
+// Steps   :
+//   1) List the units staffed this hour, in rotation order.
+//   2) Ask how many cases to take (empty = one per available unit) and
+//      take them off gEmerg, most critical first.
+//   3) With a road network, ask for each case's incident position (empty
+//      = not known) so the units' travel times count.
+//   4) Solve the assignment, show it with its cost next to the cost of
+//      sending units in turn, most critical case first.
+//   5) Record the removals (like Process Most Critical) and move the units
+//      that were sent to the back of the rotation.
+// --------------------------------------------------------------------------
+inline void ui_batch_dispatch() {
+    if (gEmerg.isEmpty()) {
+        cout << "No emergencies in queue.\n";
+        return;
+    }
+    int slot = crew_current_slot();
+    vector<int> avail;                      // rotation places of staffed units
+    vector<string> plates = amb_plates();
+    for (int i = 0; i < (int)plates.size(); ++i)
+        if (gRoster.staffed(plates[i], slot)) avail.push_back(i);
+    if (avail.empty()) {
+        cout << "No staffed ambulances available this hour.\n";
+        return;
+    }
+
+    int k = min(gEmerg.size(), (int)avail.size());
+    string s;
+    cout << "Cases to dispatch (1-" << k << ", empty = " << k << "): ";
+    safe_getline(s);
+    if (!s.empty()) {
+        char* end;
+        long want = strtol(s.c_str(), &end, 10);
+        if (*end || want < 1) {
+            cout << "Invalid number.\n";
+            return;
+        }
+        k = (int)min<long>(want, k);
+    }
+
+    vector<DispatchCase> cases;
+    vector<string> images;                  // change-stream images, published below
+    for (int i = 0; i < k; ++i) {
+        EmergencyCase e = gEmerg.top();
+        DispatchCase c{ gEmerg.str(e.patient), gEmerg.str(e.type),
+                        gEmerg.str(e.patientId), e.priority, false };
+        c.icu = case_needs_icu(c.type, c.priority);
+        images.push_back(emergency_image(gEmerg, e));
+        gEmerg.pop();
+        cases.push_back(c);
+    }
+
+    // The cases are off gEmerg now: a bad or missing answer only means
+    // "position not known", never an abort
+    bool byRoad = false;
+    if (!gRoads.isEmpty()) {
+        cout << "Incident positions (x y, km; empty = not known):\n";
+        for (DispatchCase& c : cases) {
+            cout << "  " << c.patient << " (" << c.type << "): ";
+            string pos;
+            safe_getline(pos);
+            float px, py;
+            if (sscanf(pos.c_str(), "%f %f", &px, &py) == 2) {
+                c.to = gRoads.nearest(px, py);
+                byRoad = true;
+            } else if (!pos.empty()) {
+                cout << "  Invalid position; place in rotation used instead.\n";
+            }
+        }
+    }
+
+    int m = (int)avail.size();
+    vector<bool> icu(m);
+    for (int j = 0; j < m; ++j) icu[j] = unit_is_icu(plates[avail[j]]);
+    auto t0 = chrono::steady_clock::now();
+    vector<double> cost((size_t)k * m);
+    for (int i = 0; i < k; ++i)
+        for (int j = 0; j < m; ++j)
+            cost[(size_t)i * m + j] = dispatch_cost(cases[i], avail[j], icu[j]);
+    vector<int> unitOf = byRoad ? assign_min_cost(cost, k, m)
+                                : assign_dispatch(cases, avail, icu);
+    auto us = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - t0).count();
+
+    double total = 0, inTurn = 0;
+    vector<bool> sent(plates.size(), false);
+    line();
+    cout << left << setw(10) << "Unit" << setw(5) << "Pri" << setw(22) << "Patient"
+         << "Emergency" << "\n";
+    line();
+    for (int i = 0; i < k; ++i) {
+        const DispatchCase& c = cases[i];
+        int j = unitOf[i];
+        total  += cost[(size_t)i * m + j];
+        inTurn += cost[(size_t)i * m + i];              // i-th case gets the i-th unit
+        sent[avail[j]] = true;
+        cout << left << setw(10) << plates[avail[j]] << setw(5) << c.priority
+             << setw(22) << c.patient << c.type << (c.icu ? " [ICU]" : "");
+        if (c.to >= 0) cout << " [ETA " << road_time_str(unit_eta(avail[j], c.to)) << "]";
+        if (!c.patientId.empty()) cout << " [escalated patient " << c.patientId << "]";
+        cout << "\n";
+        gNames.drop(EV_EMERGENCIES, c.patient);
+        publish_event(EV_EMERGENCIES, EV_REMOVE, c.patient.c_str(), c.priority,
+                      images[i], "");
+    }
+    line();
+    cout << "Dispatched " << k << " case(s) to " << m << " available unit(s)"
+         << (byRoad ? " by road travel time" : "") << " in " << us
+         << " us. Weighted cost " << fixed << setprecision(0) << total
+         << " (in turn: " << inTurn << ").\n";
+    cout.unsetf(ios::floatfield);
+    save_emergencies();
+    send_to_back(sent);
+}
+
+#endif
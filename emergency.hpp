@@ -2,14 +2,27 @@
 #define EMERGENCY_HPP
 
 #include "utils.hpp"
+#include "patient.hpp"   // escalation takes patients out of gPatients
+#include "emergency_case.hpp"
+#include "emergency_flat.hpp"
+#include "emergency_persistent.hpp"
+#include "emergency_pairing.hpp"
+#include "emergency_edf.hpp"
+#include "memory.hpp"    // accounting and the role's memory limit
+#include <memory>     // for unique_ptr (import buffer)
+#include <chrono>     // for timing the meld
+#include <sstream>    // for reading escalation journal lines
+#include <algorithm>  // for replace (journal field separators)
 
 #define EMERG_FILE "emergencies.txt"
+#define ESCALATION_LOG "escalations.log"   // pending escalations journal
 
 // ==========================================================================
 // ROLE 3: EMERGENCY DEPARTMENT OFFICER (PRIORITY QUEUE)
 // --------------------------------------------------------------------------
 // This module manages emergency cases using a PRIORITY QUEUE implemented
-// as a BINARY MAX-HEAP stored in an array.
+// as a BINARY MAX-HEAP stored in an array. (Other engines can be selected
+// at build time, see EmergencyQueue below.)
 //
 // Data structure choice:
 //   - We use an array-based binary heap (1-based index).
@@ -20,12 +33,6 @@
 //     most critical case at the root (index 1).
 // ==========================================================================
 
-struct EmergencyCase {
-    char patient[50]; // Name of the patient
-    char type[40];    // Type of emergency (e.g., "Heart Attack")
-    int  priority;    // Priority level (higher = more critical)
-};
-
 struct EmergencyMaxHeap {
     // We use 1-based indexing for simpler parent/child calculations:
     //   parent(i) = i / 2
@@ -34,14 +41,84 @@ struct EmergencyMaxHeap {
     EmergencyCase data[MAX_EMERG + 1]; // 1-based index
     int sz = 0; // current number of elements in the heap
 
+    // Out-of-line storage for long strings (see strpool.hpp)
+    StringPool pool;
+    size_t compactAt = POOL_COMPACT_MIN;
+
+    // Name shown in the menu title (see EmergencyQueue below)
+    const char* engineName() const { return "Max Heap"; }
+
     // Check if the heap is full
     bool isFull()  const { return sz == MAX_EMERG; }
 
     // Check if the heap is empty
     bool isEmpty() const { return sz == 0; }
 
+    // Number of pending cases
+    int size() const { return sz; }
+
+    // Call f(case) for every pending case, in no particular order
+    template <class F>
+    void forEach(F f) const {
+        for (int i = 1; i <= sz; ++i) f(data[i]);
+    }
+
+    // Call f(case) for every case with priority >= minPrio. A child never
+    // outranks its parent, so subtrees below minPrio are skipped.
+    template <class F>
+    void forEachAtLeast(int minPrio, F f) const {
+        int stack[MAX_EMERG + 1];
+        int n = 0;
+        if (sz > 0) stack[n++] = 1;
+        while (n > 0) {
+            int i = stack[--n];
+            if (data[i].priority < minPrio) continue;
+            f(data[i]);
+            if (2 * i     <= sz) stack[n++] = 2 * i;
+            if (2 * i + 1 <= sz) stack[n++] = 2 * i + 1;
+        }
+    }
+
     // Reset heap to empty
-    void clear() { sz = 0; }
+    void clear() {
+        sz = 0;
+        pool.clear();
+        compactAt = POOL_COMPACT_MIN;
+    }
+
+    // Read one of a record's string fields as a C string
+    const char* str(const PoolStr& s) const { return pool.get(s); }
+
+    // Bytes held: the fixed array plus the string pool (see memory.hpp)
+    size_t memBytes() const { return sizeof(*this) + pool.buf.capacity(); }
+
+    // ----------------------------------------------------------------------
+    // make()
+    // ----------------------------------------------------------------------
+    // Purpose : Build an EmergencyCase whose strings are stored in this
+    //           heap's pool. The case is not pushed yet.
+    // ----------------------------------------------------------------------
+    EmergencyCase make(const string& patient, const string& type, int prio,
+                       const string& patientId = "", long long arrival = 0) {
+        if (pool.bytes() > compactAt) compact();
+        EmergencyCase e;
+        e.patient   = pool.intern(patient);
+        e.type      = pool.intern(type);
+        e.patientId = pool.intern(patientId);
+        e.priority  = prio;
+        set_arrival(e, arrival);
+        return e;
+    }
+
+    // Rebuild the pool from the cases still in the heap
+    void compact() {
+        StringPool fresh;
+        for (int i = 1; i <= sz; ++i) {
+            repool_case(data[i], fresh, pool);
+        }
+        pool.buf.swap(fresh.buf);
+        compactAt = max(POOL_COMPACT_MIN, 2 * pool.bytes());
+    }
 
     // Simple swap helper for EmergencyCase
     void swapCase(EmergencyCase& a, EmergencyCase& b) {
@@ -126,8 +203,11 @@ struct EmergencyMaxHeap {
         if (isEmpty()) return;
         data[1] = data[sz];
         sz--;
+        siftDown(1);
+    }
 
-        int i = 1;
+    // Move data[i] down until both children have lower or equal priority
+    void siftDown(int i) {
         while (true) {
             int left  = 2 * i;
             int right = 2 * i + 1;
@@ -144,6 +224,28 @@ struct EmergencyMaxHeap {
         }
     }
 
+    // ----------------------------------------------------------------------
+    // meld()
+    // ----------------------------------------------------------------------
+    // Purpose : Move every case of `other` into this heap (other is left
+    //           empty), e.g. the backlog of a diverting site.
+    // Method  : Append all cases, then rebuild the heap bottom-up (Floyd's
+    //           heapify). That is O(n + m) instead of m pushes of O(log n).
+    // Return  : false (nothing moved) if the result would exceed MAX_EMERG.
+    // ----------------------------------------------------------------------
+    bool meld(EmergencyMaxHeap& other) {
+        if (&other == this || other.isEmpty()) return true;
+        if (sz + other.sz > MAX_EMERG) return false;
+        for (int i = 1; i <= other.sz; ++i) {
+            EmergencyCase e = other.data[i];
+            repool_case(e, pool, other.pool);
+            data[++sz] = e;
+        }
+        for (int i = sz / 2; i >= 1; --i) siftDown(i);
+        other.clear();
+        return true;
+    }
+
     // ----------------------------------------------------------------------
     // print()
     // ----------------------------------------------------------------------
@@ -166,7 +268,8 @@ struct EmergencyMaxHeap {
              << "Priority" << "\n";
         line();
 
-        // Make a copy of the current heap
+        // Make a copy of the current heap (records only: their strings are
+        // still read from this heap's pool)
         EmergencyMaxHeap temp;
         temp.sz = sz;
         for (int i = 1; i <= sz; ++i) {
@@ -176,8 +279,8 @@ struct EmergencyMaxHeap {
         // Repeatedly extract the highest-priority case from the copy
         while (!temp.isEmpty()) {
             EmergencyCase e = temp.top();
-            cout << left << setw(22) << e.patient
-                 << setw(18) << e.type
+            cout << left << setw(22) << str(e.patient)
+                 << setw(18) << str(e.type)
                  << e.priority << "\n";
             temp.pop();
         }
@@ -193,7 +296,9 @@ struct EmergencyMaxHeap {
     // Format  : For each emergency case, 3 lines are written:
     //           line 1 -> patient name
     //           line 2 -> emergency type
-    //           line 3 -> priority (integer)
+    //           line 3 -> priority (integer), plus the patient ID for a
+    //                     case escalated from the patient queue
+    //           (see write_emergency_record() in emergency_case.hpp)
     // Note    : The order in the file is the current heap array order.
     // ----------------------------------------------------------------------
     void saveToFile(const char* filename) const {
@@ -204,9 +309,8 @@ struct EmergencyMaxHeap {
         }
         for (int i = 1; i <= sz; ++i) {
             const EmergencyCase& e = data[i];
-            out << e.patient  << '\n'
-                << e.type     << '\n'
-                << e.priority << '\n';
+            write_emergency_record(out, str(e.patient), str(e.type),
+                                   e.priority, str(e.patientId), e.arrival);
         }
     }
 
@@ -224,43 +328,190 @@ struct EmergencyMaxHeap {
     void loadFromFile(const char* filename) {
         ifstream in(filename);
         if (!in) {
-            cout << "[Info] " << filename
+            load_log() << "[Info] " << filename
                  << " not found. Starting with empty emergencies.\n";
             clear();
             return;
         }
         clear();
-        while (true) {
-            string spatient;
-            if (!getline(in, spatient)) break;
-            if (spatient.empty()) continue;
-
-            string stype;
-            if (!getline(in, stype)) break;
-
-            int prio;
-            if (!(in >> prio)) break;
-            in.ignore(numeric_limits<streamsize>::max(), '\n');
-
-            EmergencyCase e{};
-            strncpy(e.patient, spatient.c_str(), sizeof(e.patient) - 1);
-            strncpy(e.type,    stype.c_str(),    sizeof(e.type)    - 1);
-            e.priority = prio;
-
-            push(e); // uses heap push, keeps order correct
+        string spatient, stype, sid;
+        int prio;
+        long long arrival;
+        while (read_emergency_record(in, spatient, stype, prio, sid, arrival)) {
+            if (isFull()) break;
+            push(make(spatient, stype, prio, sid, arrival)); // heap push keeps order correct
         }
-        cout << "[OK] Loaded emergencies from " << filename
+        load_log() << "[OK] Loaded emergencies from " << filename
              << " (count=" << sz << ")\n";
     }
 };
 
 // --------------------------------------------------------------------------
-// Global emergency max-heap instance
+// Emergency queue engine selection
+// --------------------------------------------------------------------------
+// All engines offer the same operations (make/push/top/pop/print/...):
+//
+//   EmergencyMaxHeap        -> default, O(log n) push/pop, best for big queues
+//   EmergencyFlatQueue      -> O(1) push + SIMD O(n) scan pop, faster for
+//                              small queues (build with -DEMERG_ENGINE_FLAT)
+//   EmergencyPersistentHeap -> O(log n) push/pop plus O(1) snapshot() for
+//                              views/reports (-DEMERG_ENGINE_PERSISTENT)
+//   EmergencyPairingHeap    -> O(1) push and O(1) meld() of a whole backlog
+//                              (-DEMERG_ENGINE_PAIRING)
+//   EmergencyDeadlineQueue  -> earliest deadline first (response-time
+//                              targets), with late/at-risk counts
+//                              (-DEMERG_ENGINE_EDF)
+//
+// Run the benchmark program (bench.cpp) to find the crossover size for the
+// target machine.
+// --------------------------------------------------------------------------
+#if defined(EMERG_ENGINE_FLAT)
+typedef EmergencyFlatQueue      EmergencyQueue;
+#elif defined(EMERG_ENGINE_PERSISTENT)
+typedef EmergencyPersistentHeap EmergencyQueue;
+#elif defined(EMERG_ENGINE_PAIRING)
+typedef EmergencyPairingHeap    EmergencyQueue;
+#elif defined(EMERG_ENGINE_EDF)
+typedef EmergencyDeadlineQueue  EmergencyQueue;
+#else
+typedef EmergencyMaxHeap        EmergencyQueue;
+#endif
+
+// Change-stream image of a case of queue q (see cdc.hpp)
+template <class Q>
+string emergency_image(const Q& q, const EmergencyCase& e) {
+    return cdc_image({ q.str(e.patient), q.str(e.type), to_string(e.priority),
+                       q.str(e.patientId) });
+}
+
+// --------------------------------------------------------------------------
+// Global emergency priority queue instance
 // --------------------------------------------------------------------------
 // As with other roles, we use an inline global variable here (C++17 feature)
 // so all UI/menu functions operate on the same emergency priority queue.
 // --------------------------------------------------------------------------
-inline EmergencyMaxHeap gEmerg;
+inline EmergencyQueue gEmerg;
+
+// Memory accounting (memory.hpp): the engine and its string pool
+inline MemRegister gEmergMem(MEM_EMERGENCIES, "queue + string pool",
+                             [] { return gEmerg.memBytes(); });
+inline MemRegister gEmergCompact(MEM_EMERGENCIES, [] { gEmerg.compact(); });
+inline PlanRegister gEmergPlan(PLAN_EMERGENCIES, [] { return gEmerg.size(); });
+
+// ================= ESCALATION (ROLE 1 QUEUE -> ROLE 3 QUEUE) ===============
+// --------------------------------------------------------------------------
+// A waiting patient who deteriorates moves from the patient queue into the
+// emergency queue in ONE step:
+//   1) one line is appended to ESCALATION_LOG (the journal) and flushed,
+//   2) the patient is taken out of gPatients/gPatientsRoom2 (O(1) through
+//      gPatientIndex),
+//   3) a case linked to the patient ID is pushed into gEmerg (O(log n)).
+// PATIENT_FILE and EMERG_FILE are NOT rewritten per escalation. They are
+// written together by checkpoint_escalations() (when leaving a role menu,
+// or before EMERG_FILE is saved anyway), which then empties the journal.
+// If the program stops before that, recover_escalations() replays the
+// journal at start-up. Replaying is idempotent: the patient is removed
+// only if still waiting, and the case is pushed only if no case linked to
+// that patient ID is queued yet. If the case cannot be pushed (one is
+// linked already, or gEmerg is full) the patient is not removed either,
+// so nobody is lost from both queues.
+//
+// Journal line format (tab separated):
+//   <patient ID> TAB <patient name> TAB <emergency type> TAB <priority>
+// --------------------------------------------------------------------------
+
+// Escalations in the journal that are not in the data files yet
+inline int gEscalationsPending = 0;
+
+// true if gEmerg already holds a case escalated for this patient ID
+inline bool emergency_linked_to(const string& id) {
+    bool found = false;
+    gEmerg.forEach([&](const EmergencyCase& e) {
+        if (!found && id == gEmerg.str(e.patientId)) found = true;
+    });
+    return found;
+}
+
+// --------------------------------------------------------------------------
+// checkpoint_escalations()
+// --------------------------------------------------------------------------
+// Purpose : Write the patient and emergency files once for all pending
+//           escalations, then drop the journal.
+// --------------------------------------------------------------------------
+inline void checkpoint_escalations() {
+    if (gEscalationsPending == 0) return;
+    gPatients.saveToFile(PATIENT_FILE);
+    if (!gPatientsRoom2.isEmpty() || ifstream(PATIENT_ROOM2_FILE))
+        gPatientsRoom2.saveToFile(PATIENT_ROOM2_FILE);
+    gEmerg.saveToFile(EMERG_FILE);
+    remove(ESCALATION_LOG);
+    gEscalationsPending = 0;
+}
+
+// Save EMERG_FILE after an emergency change (with the patient files too
+// if escalations are pending, so the journal can be dropped)
+inline void save_emergencies() {
+    if (gEscalationsPending > 0) checkpoint_escalations();
+    else gEmerg.saveToFile(EMERG_FILE);
+}
+
+// --------------------------------------------------------------------------
+// apply_escalation()
+// --------------------------------------------------------------------------
+// Purpose : The in-memory part of one escalation (steps 2 and 3 above).
+//           Used both for a new escalation and for journal replay (events
+//           flagged EVF_REPLAY, so they are not counted as new arrivals).
+// Return  : false (nothing changed) if the linked case cannot be pushed.
+// --------------------------------------------------------------------------
+inline bool apply_escalation(const string& id, const string& name,
+                             const string& type, int priority, bool replay = false) {
+    if (emergency_linked_to(id) || gEmerg.isFull()) return false;
+    uint16_t flags = replay ? EVF_REPLAY : 0;
+    Patient p;
+    PatientQueue* from;
+    if (remove_waiting_patient(id, p, from)) {  // no-op if already gone
+        master_record(id, name, from->str(p.condition), "escalated");
+        publish_event(EV_PATIENTS, EV_REMOVE, id.c_str(), 0,   // room 0 = escalated
+                      patient_image(*from, p, from == &gPatientsRoom2 ? 2 : 1), "",
+                      flags | EVF_TRANSFER);
+    }
+    EmergencyCase e = gEmerg.make(name, type, priority, id);
+    gEmerg.push(e);
+    gNames.add(EV_EMERGENCIES, name);
+    publish_event(EV_EMERGENCIES, EV_INSERT, name.c_str(), priority, "",
+                  emergency_image(gEmerg, e), flags);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// recover_escalations()
+// --------------------------------------------------------------------------
+// Purpose : At start-up (after all files are loaded), replay a journal
+//           left by a run that ended before its checkpoint.
+// --------------------------------------------------------------------------
+inline void recover_escalations() {
+    ifstream in(ESCALATION_LOG);
+    if (!in) return;
+    string rec;
+    int n = 0, skipped = 0;
+    while (getline(in, rec)) {
+        if (!rec.empty() && rec.back() == '\r') rec.pop_back();
+        istringstream ss(rec);
+        string id, name, type, sprio;
+        if (!getline(ss, id, '\t') || !getline(ss, name, '\t') ||
+            !getline(ss, type, '\t') || !getline(ss, sprio)) continue;
+        if (apply_escalation(id, name, type, atoi(sprio.c_str()), true)) n++;
+        else skipped++;
+    }
+    in.close();
+    cout << "[OK] Replayed " << n << " escalation(s) from "
+         << ESCALATION_LOG << "\n";
+    if (skipped > 0)
+        cout << "[Warn] " << skipped << " escalation(s) skipped (case already linked or"
+             << " emergency list full); those patients stay waiting.\n";
+    gEscalationsPending = 1;               // force the checkpoint
+    checkpoint_escalations();
+}
 
 // ====================== UI FUNCTIONS FOR ROLE 3 ============================
 
@@ -280,16 +531,20 @@ inline void ui_log_emergency() {
         cout << "Emergency list full.\n";
         return;
     }
+    if (!mem_admit_or_report(MEM_EMERGENCIES)) return;
 
-    EmergencyCase e{};
+    string patient, type;
+    int priority = 0;
     cout << "Patient Name: ";
-    safe_getline(e.patient, 50);
+    safe_getline(patient);
+    warn_possible_duplicates(patient);   // see phonetic.hpp
 
     cout << "Type of Emergency: ";
-    safe_getline(e.type, 40);
+    safe_getline(type);
 
     cout << "Priority Level (1-10, higher is more critical): ";
-    while (!(cin >> e.priority)) {
+    while (!(cin >> priority)) {
+        if (cin.eof()) return;
         cin.clear();
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
         cout << "Enter a valid number for priority: ";
@@ -297,12 +552,16 @@ inline void ui_log_emergency() {
     cin.ignore(numeric_limits<streamsize>::max(), '\n');
 
     // Clamp priority to a safe range (0 to 100)
-    if (e.priority < 0)   e.priority = 0;
-    if (e.priority > 100) e.priority = 100;
+    if (priority < 0)   priority = 0;
+    if (priority > 100) priority = 100;
 
+    EmergencyCase e = gEmerg.make(patient, type, priority);
     gEmerg.push(e);
+    gNames.add(EV_EMERGENCIES, patient);
     cout << "Emergency logged.\n";
-    gEmerg.saveToFile(EMERG_FILE);
+    publish_event(EV_EMERGENCIES, EV_INSERT, patient.c_str(), priority, "",
+                  emergency_image(gEmerg, e));
+    save_emergencies();
 }
 
 // --------------------------------------------------------------------------
@@ -322,10 +581,145 @@ inline void ui_process_most_critical() {
     }
     EmergencyCase top = gEmerg.top();
     gEmerg.pop();
+    gNames.drop(EV_EMERGENCIES, gEmerg.str(top.patient));
     cout << "ATTEND MOST CRITICAL => "
-         << top.patient << " (" << top.type
-         << ") with priority " << top.priority << "\n";
-    gEmerg.saveToFile(EMERG_FILE);
+         << gEmerg.str(top.patient) << " (" << gEmerg.str(top.type)
+         << ") with priority " << top.priority;
+    if (*gEmerg.str(top.patientId))
+        cout << " [escalated patient " << gEmerg.str(top.patientId) << "]";
+    cout << "\n";
+    publish_event(EV_EMERGENCIES, EV_REMOVE, gEmerg.str(top.patient), top.priority,
+                  emergency_image(gEmerg, top), "");
+    save_emergencies();
+}
+
+// --------------------------------------------------------------------------
+// ui_import_backlog()
+// --------------------------------------------------------------------------
+// Purpose : Take over the whole backlog of a diverting site.
+// Steps   :
+//   1) Ask for the other instance's emergency snapshot file (same format
+//      as EMERG_FILE).
+//   2) Build a separate queue from it (same engine as gEmerg).
+//   3) Meld it into gEmerg in one step: O(1) with the pairing heap,
+//      O(n + m) with the array heap, instead of one push per case.
+//   4) Save to EMERG_FILE.
+// --------------------------------------------------------------------------
+inline void ui_import_backlog() {
+    if (!mem_admit_or_report(MEM_EMERGENCIES)) return;
+    string file;
+    cout << "Snapshot file of the diverting site: ";
+    safe_getline(file);
+
+    unique_ptr<EmergencyQueue> incoming(new EmergencyQueue);
+    incoming->loadFromFile(file.c_str());
+    int n = incoming->size();
+    if (n == 0) {
+        cout << "Nothing to import.\n";
+        return;
+    }
+
+    if (gEmerg.size() + n > MAX_EMERG) {
+        cout << "Not enough room: " << n << " incoming, "
+             << (MAX_EMERG - gEmerg.size()) << " free.\n";
+        return;
+    }
+    // Images and names first: meld() empties `incoming`
+    struct Added { string name, image; int priority; };
+    vector<Added> added;
+    incoming->forEach([&](const EmergencyCase& e) {
+        added.push_back(Added{ incoming->str(e.patient),
+                               emergency_image(*incoming, e), e.priority });
+    });
+
+    auto t0 = chrono::steady_clock::now();
+    bool ok = gEmerg.meld(*incoming);
+    auto us = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - t0).count();
+    if (!ok) {
+        cout << "Not enough room: " << n << " incoming, "
+             << (MAX_EMERG - gEmerg.size()) << " free.\n";
+        return;
+    }
+    cout << "Imported " << n << " cases (meld took " << us << " us).\n";
+    for (const Added& a : added) {         // a transfer, not arrivals
+        gNames.add(EV_EMERGENCIES, a.name);
+        publish_event(EV_EMERGENCIES, EV_INSERT, a.name.c_str(), a.priority, "",
+                      a.image, EVF_TRANSFER);
+    }
+    save_emergencies();
+}
+
+// --------------------------------------------------------------------------
+// ui_escalate_patient()
+// --------------------------------------------------------------------------
+// Purpose : Move a deteriorating patient from the patient queue (main or
+//           room 2) into the emergency queue, by patient ID.
+// Steps   :
+//   1) Ask for the patient ID and look it up in gPatientIndex.
+//   2) Ask for the type of emergency and the priority.
+//   3) Append the journal line, then remove the patient and push the
+//      linked case (see the ESCALATION section above). No file rewrite.
+// --------------------------------------------------------------------------
+inline void ui_escalate_patient() {
+    if (gEmerg.isFull()) {
+        cout << "Emergency list full.\n";
+        return;
+    }
+    if (!mem_admit_or_report(MEM_EMERGENCIES)) return;
+
+    string id;
+    cout << "Patient ID to escalate: ";
+    safe_getline(id);
+    auto it = gPatientIndex.find(id);
+    if (it == gPatientIndex.end()) {
+        cout << "No waiting patient with ID " << id << ".\n";
+        return;
+    }
+    if (emergency_linked_to(id)) {
+        cout << "Patient ID " << id << " already has an escalated case queued."
+             << " Patient not escalated.\n";
+        return;
+    }
+    const PatientQueue* q = it->second.chunk->owner;
+    string name = q->str(it->second.chunk->slot[it->second.slot].name);
+
+    string type;
+    int priority = 0;
+    cout << "Type of Emergency: ";
+    safe_getline(type);
+
+    cout << "Priority Level (1-10, higher is more critical): ";
+    while (!(cin >> priority)) {
+        if (cin.eof()) return;
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Enter a valid number for priority: ";
+    }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+    if (priority < 0)   priority = 0;
+    if (priority > 100) priority = 100;
+
+    // Journal first: once the line is on disk the escalation survives a
+    // crash, whichever files were saved after it
+    replace(name.begin(), name.end(), '\t', ' ');
+    replace(type.begin(), type.end(), '\t', ' ');
+    ofstream journal(ESCALATION_LOG, ios::app);
+    if (!(journal << id << '\t' << name << '\t' << type << '\t'
+                  << priority << '\n' << flush)) {
+        cout << "[Error] Cannot write " << ESCALATION_LOG
+             << ". Patient not escalated.\n";
+        return;
+    }
+    gEscalationsPending++;
+
+    if (!apply_escalation(id, name, type, priority)) {   // checked above; kept safe
+        cout << "[Error] Patient not escalated.\n";
+        return;
+    }
+    cout << "Escalated [" << id << "] " << name
+         << " to the emergency queue with priority " << priority << ".\n";
 }
 
 // --------------------------------------------------------------------------
@@ -337,20 +731,26 @@ inline void ui_process_most_critical() {
 //   1) Log Emergency Case (insert into heap)
 //   2) Process Most Critical Case (remove max)
 //   3) View Pending Emergency Cases
+//   4) Import Diverted Backlog (meld another site's snapshot file)
+//   5) Escalate Waiting Patient (patient queue -> emergency queue, by ID)
 //   0) Back (return to main menu)
 // --------------------------------------------------------------------------
 inline void menu_emergency() {
     while (true) {
         line('=');
-        cout << "EMERGENCY DEPT OFFICER (Priority Queue - Max Heap)\n";
+        cout << "EMERGENCY DEPT OFFICER (Priority Queue - "
+             << gEmerg.engineName() << ")\n";
         line('=');
         cout << "1) Log Emergency Case (push)\n";
         cout << "2) Process Most Critical Case (pop-max)\n";
         cout << "3) View Pending Emergency Cases\n";
+        cout << "4) Import Diverted Backlog (meld)\n";
+        cout << "5) Escalate Waiting Patient (by ID)\n";
         cout << "0) Back\n> ";
 
         int ch;
         if (!(cin >> ch)) {
+            if (cin.eof()) return;          // end of input
             cin.clear();
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
             continue;
@@ -361,6 +761,8 @@ inline void menu_emergency() {
         else if (ch == 1) ui_log_emergency();
         else if (ch == 2) ui_process_most_critical();
         else if (ch == 3) gEmerg.print();
+        else if (ch == 4) ui_import_backlog();
+        else if (ch == 5) ui_escalate_patient();
         else cout << "Invalid choice.\n";
     }
 }
@@ -373,6 +775,10 @@ inline void menu_emergency() {
 // --------------------------------------------------------------------------
 inline void load_emergencies_from_file() {
     gEmerg.loadFromFile(EMERG_FILE);
+    gNames.dropRole(EV_EMERGENCIES);
+    gEmerg.forEach([](const EmergencyCase& e) {
+        gNames.add(EV_EMERGENCIES, gEmerg.str(e.patient));
+    });
 }
 
 #endif
@@ -0,0 +1,115 @@
+#ifndef EMERGENCY_CASE_HPP
+#define EMERGENCY_CASE_HPP
+
+#include "utils.hpp"
+#include "strpool.hpp"
+#include <ctime>      // for time (arrival of a case)
+
+// ---------------------------------------------------------------------------
+// emergency_case.hpp
+// ---------------------------------------------------------------------------
+// The EmergencyCase record shared by every emergency queue engine
+// (EmergencyMaxHeap in emergency.hpp, EmergencyFlatQueue in
+// emergency_flat.hpp, ...). Its strings live in the pool of the engine that
+// created it, so always read them through that engine's str().
+// ---------------------------------------------------------------------------
+
+struct EmergencyCase {
+    PoolStr patient;   // Name of the patient (string pool reference)
+    PoolStr type;      // Type of emergency (e.g., "Heart Attack")
+    int     priority;  // Priority level (higher = more critical)
+    PoolStr patientId; // ID in the patient queue if the case was escalated
+                       // from there (see ui_escalate_patient), else empty
+    long long arrival;  // when the case was logged (seconds since the epoch)
+    long long deadline; // arrival + response target of its priority
+};
+
+// ---------------------------------------------------------------------------
+// Clinical response-time targets: how long a case of a given priority may
+// wait before its response is late (used by the EDF engine,
+// emergency_edf.hpp, and its breach counts).
+// ---------------------------------------------------------------------------
+inline long long response_target(int priority) {
+    static const int minutes[11] = {
+        1440, 720, 480, 240, 120,   // priority 0-4: same day .. 2 hours
+        60, 45, 30, 20, 15,         // priority 5-9: within the hour .. 15 min
+        8                           // priority 10 and above: minutes
+    };
+    if (priority < 0)  priority = 0;
+    if (priority > 10) priority = 10;
+    return minutes[priority] * 60LL;
+}
+
+inline long long emergency_now() { return (long long)time(nullptr); }
+
+// Set the arrival time (0 = now; never later than now) and the deadline
+// that follows from it
+inline void set_arrival(EmergencyCase& e, long long arrival) {
+    long long now = emergency_now();
+    e.arrival  = (arrival && arrival < now) ? arrival : now;
+    e.deadline = e.arrival + response_target(e.priority);
+}
+
+// Copy the strings of a case from pool `src` into pool `dst` (used by the
+// engines' compact() and meld())
+inline void repool_case(EmergencyCase& e, StringPool& dst, const StringPool& src) {
+    e.patient   = dst.copyFrom(src, e.patient);
+    e.type      = dst.copyFrom(src, e.type);
+    e.patientId = dst.copyFrom(src, e.patientId);
+}
+
+// ---------------------------------------------------------------------------
+// Emergency file format (EMERG_FILE and import snapshots), 3 lines per case:
+//   line 1 -> patient name
+//   line 2 -> emergency type
+//   line 3 -> priority, then " @<arrival>" (seconds since the epoch), then
+//             " <patient ID>" for an escalated case
+// Files written before escalation or arrival times existed simply have no
+// ID or arrival after the priority, so they still load (arrival = 0, which
+// make() turns into the load time).
+// ---------------------------------------------------------------------------
+inline void write_emergency_record(ostream& out, const char* patient,
+                                   const char* type, int priority,
+                                   const char* patientId, long long arrival) {
+    out << patient << '\n'
+        << type    << '\n'
+        << priority << " @" << arrival;
+    if (*patientId) out << ' ' << patientId;
+    out << '\n';
+}
+
+// Read the next case; false at end of file (or on a broken record)
+inline bool read_emergency_record(istream& in, string& patient, string& type,
+                                  int& priority, string& patientId,
+                                  long long& arrival) {
+    do {
+        if (!getline(in, patient)) return false;
+    } while (patient.empty());            // skip empty lines
+    if (!getline(in, type)) return false;
+
+    string rest;
+    if (!getline(in, rest)) return false;
+    const char* s = rest.c_str();
+    char* endp;
+    long v = strtol(s, &endp, 10);
+    if (endp == s) return false;
+    priority = (int)v;
+
+    // Optional arrival time
+    size_t b = endp - s;
+    while (b < rest.size() && rest[b] == ' ') b++;
+    arrival = 0;
+    if (b < rest.size() && rest[b] == '@') {
+        arrival = strtoll(s + b + 1, &endp, 10);
+        b = endp - s;
+        while (b < rest.size() && rest[b] == ' ') b++;
+    }
+
+    // Optional patient ID (trim spaces and a Windows '\r')
+    size_t e = rest.size();
+    while (e > b && (rest[e - 1] == ' ' || rest[e - 1] == '\r')) e--;
+    patientId = rest.substr(b, e - b);
+    return true;
+}
+
+#endif
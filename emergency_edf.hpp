@@ -0,0 +1,301 @@
+#ifndef EMERGENCY_EDF_HPP
+#define EMERGENCY_EDF_HPP
+
+#include "utils.hpp"
+#include "emergency_case.hpp"
+#include <algorithm>  // for sort (print/save order)
+#include <vector>
+
+// ==========================================================================
+// ROLE 3 ENGINE: EARLIEST DEADLINE FIRST (alternative to EmergencyMaxHeap)
+// --------------------------------------------------------------------------
+// Every priority has a response-time target (response_target() in
+// emergency_case.hpp), so every case has a deadline: arrival + target. A
+// low-priority case that has waited long can be closer to being late than
+// a high-priority case that just came in. This engine serves the case
+// whose deadline comes first.
+//
+// Data structure choice:
+//   - Binary MIN-heap on (deadline, -priority, arrival sequence number), in
+//     an array like EmergencyMaxHeap: O(log n) push/pop, O(1) top.
+//   - SlaTracker (below) counts the waiting cases by the minute of their
+//     deadline, so the number of cases already late and the number that
+//     will be late within EDF_RISK_MIN minutes are known at any time, at
+//     O(1) per push/pop.
+//
+// Build main with -DEMERG_ENGINE_EDF to use it.
+// ==========================================================================
+
+const int EDF_MINUTES  = 2048;   // deadline buckets (> the longest target)
+const int EDF_RISK_MIN = 5;      // "at risk": late within this many minutes
+
+// ---------------------------------------------------------------------------
+// SlaTracker
+// ---------------------------------------------------------------------------
+// count[m % EDF_MINUTES] = waiting cases whose deadline falls in minute m,
+// for minutes m >= minute (the current one). Cases with an earlier deadline
+// are only counted in `overdue`. When the clock moves on, each minute that
+// passes moves its bucket into `overdue`, and the bucket EDF_RISK_MIN
+// minutes ahead joins `atRisk`: O(1) per minute, whatever the queue size.
+// ---------------------------------------------------------------------------
+struct SlaTracker {
+    int count[EDF_MINUTES];
+    long long minute = -1;   // current minute (-1 = not started)
+    int overdue = 0;         // waiting, deadline passed
+    int atRisk  = 0;         // waiting, deadline within EDF_RISK_MIN minutes
+    long long servedLate = 0;  // popped after their deadline
+
+    SlaTracker() { clear(); }
+
+    void clear() {
+        for (int i = 0; i < EDF_MINUTES; ++i) count[i] = 0;
+        minute = -1;
+        overdue = atRisk = 0;
+        servedLate = 0;
+    }
+
+    // Move the clock to minute `now`
+    void advance(long long now) {
+        if (minute < 0) { minute = now; return; }
+        if (now <= minute) return;
+        if (now - minute >= EDF_MINUTES) {          // long idle: fold everything
+            for (int i = 0; i < EDF_MINUTES; ++i) { overdue += count[i]; count[i] = 0; }
+            atRisk = 0;
+            minute = now;
+            return;
+        }
+        while (minute < now) {
+            int& c = count[minute % EDF_MINUTES];
+            atRisk  -= c;                           // now late
+            overdue += c;
+            c = 0;
+            minute++;
+            atRisk += count[(minute + EDF_RISK_MIN - 1) % EDF_MINUTES];
+        }
+    }
+
+    // Count a case with this deadline in (d = +1) or out (d = -1)
+    void add(long long deadline, int d) {
+        long long m = deadline / 60;
+        if (m < minute) {
+            overdue += d;
+            return;
+        }
+        count[m % EDF_MINUTES] += d;
+        if (m < minute + EDF_RISK_MIN) atRisk += d;
+    }
+};
+
+struct EmergencyDeadlineQueue {
+    struct Slot {
+        EmergencyCase e;
+        unsigned long long seq;   // arrival number (tie-break)
+    };
+    Slot data[MAX_EMERG + 1];     // 1-based min-heap
+    int sz = 0;
+    unsigned long long nextSeq = 0;
+    SlaTracker sla;
+
+    // Out-of-line storage for long strings (see strpool.hpp)
+    StringPool pool;
+    size_t compactAt = POOL_COMPACT_MIN;
+
+    const char* engineName() const { return "Deadline (EDF)"; }
+
+    bool isFull()  const { return sz == MAX_EMERG; }
+    bool isEmpty() const { return sz == 0; }
+    int  size()    const { return sz; }
+
+    void clear() {
+        sz = 0;
+        nextSeq = 0;
+        sla.clear();
+        pool.clear();
+        compactAt = POOL_COMPACT_MIN;
+    }
+
+    const char* str(const PoolStr& s) const { return pool.get(s); }
+
+    // Bytes held: the fixed array plus the string pool (see memory.hpp)
+    size_t memBytes() const { return sizeof(*this) + pool.buf.capacity(); }
+
+    // Build a case whose strings are stored in this queue's pool
+    EmergencyCase make(const string& patient, const string& type, int prio,
+                       const string& patientId = "", long long arrival = 0) {
+        if (pool.bytes() > compactAt) compact();
+        EmergencyCase e;
+        e.patient   = pool.intern(patient);
+        e.type      = pool.intern(type);
+        e.patientId = pool.intern(patientId);
+        e.priority  = prio;
+        set_arrival(e, arrival);
+        return e;
+    }
+
+    void compact() {
+        StringPool fresh;
+        for (int i = 1; i <= sz; ++i) repool_case(data[i].e, fresh, pool);
+        pool.buf.swap(fresh.buf);
+        compactAt = max(POOL_COMPACT_MIN, 2 * pool.bytes());
+    }
+
+    // true if slot a must be served before slot b
+    static bool before(const Slot& a, const Slot& b) {
+        if (a.e.deadline != b.e.deadline) return a.e.deadline < b.e.deadline;
+        if (a.e.priority != b.e.priority) return a.e.priority > b.e.priority;
+        return a.seq < b.seq;
+    }
+
+    void siftUp(int i) {
+        Slot s = data[i];
+        while (i > 1 && before(s, data[i / 2])) {
+            data[i] = data[i / 2];
+            i /= 2;
+        }
+        data[i] = s;
+    }
+
+    void siftDown(int i) {
+        Slot s = data[i];
+        while (true) {
+            int c = 2 * i;
+            if (c > sz) break;
+            if (c + 1 <= sz && before(data[c + 1], data[c])) c++;
+            if (!before(data[c], s)) break;
+            data[i] = data[c];
+            i = c;
+        }
+        data[i] = s;
+    }
+
+    void push(const EmergencyCase& e) {
+        if (isFull()) {
+            cout << "Emergency queue is full.\n";
+            return;
+        }
+        sla.advance(emergency_now() / 60);
+        data[++sz] = Slot{ e, nextSeq++ };
+        siftUp(sz);
+        sla.add(e.deadline, +1);
+    }
+
+    // Case closest to its deadline (caller checks isEmpty() first)
+    EmergencyCase top() const { return data[1].e; }
+
+    void pop() {
+        if (isEmpty()) return;
+        long long now = emergency_now();
+        sla.advance(now / 60);
+        sla.add(data[1].e.deadline, -1);
+        if (now > data[1].e.deadline) sla.servedLate++;
+        data[1] = data[sz--];
+        if (sz > 0) siftDown(1);
+    }
+
+    // Append all of other's cases and rebuild the heap, O(n + m)
+    bool meld(EmergencyDeadlineQueue& other) {
+        if (&other == this || other.isEmpty()) return true;
+        if (sz + other.sz > MAX_EMERG) return false;
+        sla.advance(emergency_now() / 60);
+        for (int i = 1; i <= other.sz; ++i) {
+            EmergencyCase e = other.data[i].e;
+            repool_case(e, pool, other.pool);
+            data[++sz] = Slot{ e, nextSeq++ };
+            sla.add(e.deadline, +1);
+        }
+        for (int i = sz / 2; i >= 1; --i) siftDown(i);
+        other.clear();
+        return true;
+    }
+
+    template <class F>
+    void forEach(F f) const {
+        for (int i = 1; i <= sz; ++i) f(data[i].e);
+    }
+
+    // The heap is not ordered by priority, so this is a filtered scan
+    template <class F>
+    void forEachAtLeast(int minPrio, F f) const {
+        for (int i = 1; i <= sz; ++i)
+            if (data[i].e.priority >= minPrio) f(data[i].e);
+    }
+
+    // Slot indices in pop order, without modifying the heap
+    vector<int> sortedSlots() const {
+        vector<int> order;
+        for (int i = 1; i <= sz; ++i) order.push_back(i);
+        sort(order.begin(), order.end(),
+             [&](int a, int b) { return before(data[a], data[b]); });
+        return order;
+    }
+
+    // Late cases and cases late within EDF_RISK_MIN minutes, now
+    void slaStatus(int& overdue, int& atRisk) {
+        sla.advance(emergency_now() / 60);
+        overdue = sla.overdue;
+        atRisk  = sla.atRisk;
+    }
+
+    // Display all cases, most urgent deadline first
+    void print() const {
+        if (isEmpty()) {
+            cout << "No emergency cases pending.\n";
+            return;
+        }
+        cout << left << setw(22) << "Patient"
+             << setw(18) << "Emergency"
+             << setw(10) << "Priority" << "Due" << "\n";
+        line();
+        long long now = emergency_now();
+        for (int i : sortedSlots()) {
+            const EmergencyCase& e = data[i].e;
+            long long rem = e.deadline - now;
+            string due = rem >= 0 ? "in " + to_string(rem / 60) + " min"
+                                  : "LATE " + to_string((-rem + 59) / 60) + " min";
+            cout << left << setw(22) << str(e.patient)
+                 << setw(18) << str(e.type)
+                 << setw(10) << e.priority << due << "\n";
+        }
+        SlaTracker t = sla;
+        t.advance(now / 60);
+        cout << "(Shown by deadline. Late: " << t.overdue << ", late within "
+             << EDF_RISK_MIN << " min: " << t.atRisk << ", served late so far: "
+             << t.servedLate << ".)\n";
+    }
+
+    // Same file format as EmergencyMaxHeap, written in pop order
+    void saveToFile(const char* filename) const {
+        ofstream out(filename);
+        if (!out) {
+            cout << "[Error] Cannot open " << filename << " for writing.\n";
+            return;
+        }
+        for (int i : sortedSlots()) {
+            const EmergencyCase& e = data[i].e;
+            write_emergency_record(out, str(e.patient), str(e.type),
+                                   e.priority, str(e.patientId), e.arrival);
+        }
+    }
+
+    void loadFromFile(const char* filename) {
+        ifstream in(filename);
+        if (!in) {
+            load_log() << "[Info] " << filename
+                 << " not found. Starting with empty emergencies.\n";
+            clear();
+            return;
+        }
+        clear();
+        string spatient, stype, sid;
+        int prio;
+        long long arrival;
+        while (read_emergency_record(in, spatient, stype, prio, sid, arrival)) {
+            if (isFull()) break;
+            push(make(spatient, stype, prio, sid, arrival));
+        }
+        load_log() << "[OK] Loaded emergencies from " << filename
+             << " (count=" << sz << ")\n";
+    }
+};
+
+#endif
@@ -0,0 +1,361 @@
+#ifndef EMERGENCY_FLAT_HPP
+#define EMERGENCY_FLAT_HPP
+
+#include "utils.hpp"
+#include "emergency_case.hpp"
+#include <algorithm>  // for sort/stable_sort
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h> // x86 SIMD intrinsics
+#endif
+
+// ==========================================================================
+// ROLE 3 ENGINE: FLAT ARRAY + SIMD SCAN (alternative to EmergencyMaxHeap)
+// --------------------------------------------------------------------------
+// For small sites the backlog is short. There a plain scan can beat the
+// binary heap: every sift step is a data-dependent branch plus a swap of a
+// whole sizeof(EmergencyCase) record, while a scan over a contiguous int
+// array runs 4-8 lanes at a time and never mispredicts. bench.cpp measures where the heap takes over.
+//
+// Data structure choice:
+//   - data[] holds the records in any order, key[] holds one int per record
+//     in the same slot. push() appends in O(1).
+//   - top()/pop() find the largest key with an AVX2/SSE2 argmax, O(n) but
+//     with a tiny constant. pop() then moves the last slot into the hole.
+//   - The argmax result is cached until the next pop(), and push() keeps the
+//     cache valid in O(1), so a top() + pop() pair costs a single scan.
+//
+// Stable ties:
+//   key = (priority << 24) | (SEQ_MAX - arrival sequence number)
+//   so a higher priority always wins and, among equal priorities, the case
+//   that arrived first has the larger key. Keys are unique, so the argmax
+//   is exact and the swap-remove in pop() cannot break arrival order.
+// ==========================================================================
+
+// --------------------------------------------------------------------------
+// argmax_i32()
+// --------------------------------------------------------------------------
+// Purpose : Return the index of the largest value in a[0..n-1] (the first
+//           one if several are equal), or -1 if n == 0.
+// Method  : One pass over the array, 8 (AVX2) or 4 (SSE2) lanes at a time.
+//           Each lane keeps its best value and the index it came from; a
+//           strict '>' keeps the earliest index inside a lane, and the final
+//           lane reduction prefers the smaller index on equal values.
+// --------------------------------------------------------------------------
+inline int argmax_i32(const int* a, int n) {
+    if (n <= 0) return -1;
+    int i = 0;
+    int best = a[0];
+    int bestIdx = 0;
+
+#if defined(__AVX2__)
+    if (n >= 8) {
+        __m256i vmax = _mm256_loadu_si256((const __m256i*)a);
+        __m256i vidx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i cur  = vidx;
+        const __m256i step = _mm256_set1_epi32(8);
+        for (i = 8; i + 8 <= n; i += 8) {
+            cur = _mm256_add_epi32(cur, step);
+            __m256i v  = _mm256_loadu_si256((const __m256i*)(a + i));
+            __m256i gt = _mm256_cmpgt_epi32(v, vmax);
+            vmax = _mm256_blendv_epi8(vmax, v, gt);
+            vidx = _mm256_blendv_epi8(vidx, cur, gt);
+        }
+        alignas(32) int lv[8], li[8];
+        _mm256_store_si256((__m256i*)lv, vmax);
+        _mm256_store_si256((__m256i*)li, vidx);
+        best = lv[0];
+        bestIdx = li[0];
+        for (int k = 1; k < 8; ++k)
+            if (lv[k] > best || (lv[k] == best && li[k] < bestIdx)) {
+                best = lv[k];
+                bestIdx = li[k];
+            }
+    }
+#elif defined(__SSE2__)
+    if (n >= 4) {
+        __m128i vmax = _mm_loadu_si128((const __m128i*)a);
+        __m128i vidx = _mm_setr_epi32(0, 1, 2, 3);
+        __m128i cur  = vidx;
+        const __m128i step = _mm_set1_epi32(4);
+        for (i = 4; i + 4 <= n; i += 4) {
+            cur = _mm_add_epi32(cur, step);
+            __m128i v  = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i gt = _mm_cmpgt_epi32(v, vmax);
+            // SSE2 has no blend: select with and/andnot on the compare mask
+            vmax = _mm_or_si128(_mm_and_si128(gt, v),   _mm_andnot_si128(gt, vmax));
+            vidx = _mm_or_si128(_mm_and_si128(gt, cur), _mm_andnot_si128(gt, vidx));
+        }
+        alignas(16) int lv[4], li[4];
+        _mm_store_si128((__m128i*)lv, vmax);
+        _mm_store_si128((__m128i*)li, vidx);
+        best = lv[0];
+        bestIdx = li[0];
+        for (int k = 1; k < 4; ++k)
+            if (lv[k] > best || (lv[k] == best && li[k] < bestIdx)) {
+                best = lv[k];
+                bestIdx = li[k];
+            }
+    }
+#endif
+    for (int k = (i == 0 ? 1 : i); k < n; ++k)   // scalar tail
+        if (a[k] > best) {
+            best = a[k];
+            bestIdx = k;
+        }
+    return bestIdx;
+}
+
+struct EmergencyFlatQueue {
+    static const int SEQ_BITS = 24;
+    static const int SEQ_MAX  = (1 << SEQ_BITS) - 1;
+
+    EmergencyCase data[MAX_EMERG]; // records, 0-based, unordered
+    int key[MAX_EMERG];            // ordering key of data[i] (see above)
+    int sz = 0;                    // current number of cases
+    int nextSeq = 0;               // arrival number given to the next push
+    mutable int best = -1;         // cached argmax slot, -1 = unknown
+
+    // Out-of-line storage for long strings (see strpool.hpp)
+    StringPool pool;
+    size_t compactAt = POOL_COMPACT_MIN;
+
+    const char* engineName() const { return "Flat Array + SIMD"; }
+
+    bool isFull()  const { return sz == MAX_EMERG; }
+    bool isEmpty() const { return sz == 0; }
+    int  size()    const { return sz; }
+
+    // Call f(case) for every pending case, in no particular order
+    template <class F>
+    void forEach(F f) const {
+        for (int i = 0; i < sz; ++i) f(data[i]);
+    }
+
+    // Call f(case) for every case with priority >= minPrio (full scan:
+    // the array is unordered)
+    template <class F>
+    void forEachAtLeast(int minPrio, F f) const {
+        for (int i = 0; i < sz; ++i)
+            if (data[i].priority >= minPrio) f(data[i]);
+    }
+
+    void clear() {
+        sz = 0;
+        nextSeq = 0;
+        best = -1;
+        pool.clear();
+        compactAt = POOL_COMPACT_MIN;
+    }
+
+    // Read one of a record's string fields as a C string
+    const char* str(const PoolStr& s) const { return pool.get(s); }
+
+    // Bytes held: the fixed array plus the string pool (see memory.hpp)
+    size_t memBytes() const { return sizeof(*this) + pool.buf.capacity(); }
+
+    // Build a case whose strings are stored in this queue's pool
+    EmergencyCase make(const string& patient, const string& type, int prio,
+                       const string& patientId = "", long long arrival = 0) {
+        if (pool.bytes() > compactAt) compact();
+        EmergencyCase e;
+        e.patient   = pool.intern(patient);
+        e.type      = pool.intern(type);
+        e.patientId = pool.intern(patientId);
+        e.priority  = prio;
+        set_arrival(e, arrival);
+        return e;
+    }
+
+    // Rebuild the pool from the cases still queued
+    void compact() {
+        StringPool fresh;
+        for (int i = 0; i < sz; ++i) {
+            repool_case(data[i], fresh, pool);
+        }
+        pool.buf.swap(fresh.buf);
+        compactAt = max(POOL_COMPACT_MIN, 2 * pool.bytes());
+    }
+
+    // Priority part of the key. Priorities are clamped to 0..127 for
+    // ordering only; the record keeps its real value.
+    static int prioBits(int priority) {
+        if (priority < 0)   priority = 0;
+        if (priority > 127) priority = 127;
+        return priority << SEQ_BITS;
+    }
+
+    // ----------------------------------------------------------------------
+    // renumber()
+    // ----------------------------------------------------------------------
+    // Purpose : Called when the 24-bit arrival counter runs out. Gives the
+    //           queued cases new sequence numbers 0..sz-1 in their current
+    //           arrival order, so ties keep resolving the same way.
+    // ----------------------------------------------------------------------
+    void renumber() {
+        int order[MAX_EMERG];
+        for (int i = 0; i < sz; ++i) order[i] = i;
+        // Larger low bits = earlier arrival
+        stable_sort(order, order + sz, [&](int a, int b) {
+            return (key[a] & SEQ_MAX) > (key[b] & SEQ_MAX);
+        });
+        for (int r = 0; r < sz; ++r) {
+            int i = order[r];
+            key[i] = prioBits(data[i].priority) | (SEQ_MAX - r);
+        }
+        nextSeq = sz;
+        best = -1;
+    }
+
+    // ----------------------------------------------------------------------
+    // push()
+    // ----------------------------------------------------------------------
+    // Purpose : Append a case in O(1). No reordering is needed because the
+    //           order is decided by the scan in top()/pop().
+    // ----------------------------------------------------------------------
+    void push(const EmergencyCase& e) {
+        if (isFull()) {
+            cout << "Emergency queue is full.\n";
+            return;
+        }
+        if (nextSeq > SEQ_MAX) renumber();
+        data[sz] = e;
+        key[sz]  = prioBits(e.priority) | (SEQ_MAX - nextSeq);
+        if (best >= 0 && key[sz] > key[best]) best = sz;
+        nextSeq++;
+        sz++;
+    }
+
+    // Slot of the most critical case, scanning only if the cache is stale
+    int bestSlot() const {
+        if (best < 0) best = argmax_i32(key, sz);
+        return best;
+    }
+
+    // Most critical case (caller checks isEmpty() first)
+    EmergencyCase top() const {
+        return data[bestSlot()];
+    }
+
+    // ----------------------------------------------------------------------
+    // pop()
+    // ----------------------------------------------------------------------
+    // Purpose : Remove the most critical case: find it with the SIMD scan,
+    //           then fill its slot with the last record (swap-remove).
+    // ----------------------------------------------------------------------
+    void pop() {
+        if (isEmpty()) return;
+        int i = bestSlot();
+        sz--;
+        data[i] = data[sz];
+        key[i]  = key[sz];
+        best = -1;
+    }
+
+    // ----------------------------------------------------------------------
+    // print()
+    // ----------------------------------------------------------------------
+    // Purpose : Display all cases from highest to lowest priority (ties in
+    //           arrival order) without modifying the queue. Keys are unique,
+    //           so sorting slot numbers by key gives exactly the pop order.
+    // ----------------------------------------------------------------------
+    void print() const {
+        if (isEmpty()) {
+            cout << "No emergency cases pending.\n";
+            return;
+        }
+
+        cout << left << setw(22) << "Patient"
+             << setw(18) << "Emergency"
+             << "Priority" << "\n";
+        line();
+
+        int order[MAX_EMERG];
+        for (int i = 0; i < sz; ++i) order[i] = i;
+        sort(order, order + sz, [&](int a, int b) { return key[a] > key[b]; });
+
+        for (int r = 0; r < sz; ++r) {
+            const EmergencyCase& e = data[order[r]];
+            cout << left << setw(22) << str(e.patient)
+                 << setw(18) << str(e.type)
+                 << e.priority << "\n";
+        }
+
+        cout << "(Shown from highest to lowest priority.)\n";
+    }
+
+    // Slot numbers sorted by arrival (larger low key bits = earlier)
+    void arrivalOrder(int* order) const {
+        for (int i = 0; i < sz; ++i) order[i] = i;
+        sort(order, order + sz, [&](int a, int b) {
+            return (key[a] & SEQ_MAX) > (key[b] & SEQ_MAX);
+        });
+    }
+
+    // ----------------------------------------------------------------------
+    // meld()
+    // ----------------------------------------------------------------------
+    // Purpose : Move every case of `other` to the end of this queue (other
+    //           is left empty). Appending is O(1) per case; the incoming
+    //           cases keep their own arrival order among themselves.
+    // Return  : false (nothing moved) if the result would exceed MAX_EMERG.
+    // ----------------------------------------------------------------------
+    bool meld(EmergencyFlatQueue& other) {
+        if (&other == this || other.isEmpty()) return true;
+        if (sz + other.sz > MAX_EMERG) return false;
+        int order[MAX_EMERG];
+        other.arrivalOrder(order);
+        for (int r = 0; r < other.sz; ++r) {
+            EmergencyCase e = other.data[order[r]];
+            repool_case(e, pool, other.pool);
+            push(e);
+        }
+        other.clear();
+        return true;
+    }
+
+    // ----------------------------------------------------------------------
+    // saveToFile()
+    // ----------------------------------------------------------------------
+    // Format  : Same as EmergencyMaxHeap (patient, type, priority per case).
+    // Note    : Cases are written in arrival order, so reloading the file
+    //           restores the same tie order.
+    // ----------------------------------------------------------------------
+    void saveToFile(const char* filename) const {
+        ofstream out(filename);
+        if (!out) {
+            cout << "[Error] Cannot open " << filename << " for writing.\n";
+            return;
+        }
+        int order[MAX_EMERG];
+        arrivalOrder(order);
+        for (int r = 0; r < sz; ++r) {
+            const EmergencyCase& e = data[order[r]];
+            write_emergency_record(out, str(e.patient), str(e.type),
+                                   e.priority, str(e.patientId), e.arrival);
+        }
+    }
+
+    // Load cases from a file in the saveToFile() format
+    void loadFromFile(const char* filename) {
+        ifstream in(filename);
+        if (!in) {
+            load_log() << "[Info] " << filename
+                 << " not found. Starting with empty emergencies.\n";
+            clear();
+            return;
+        }
+        clear();
+        string spatient, stype, sid;
+        int prio;
+        long long arrival;
+        while (read_emergency_record(in, spatient, stype, prio, sid, arrival)) {
+            if (isFull()) break;
+            push(make(spatient, stype, prio, sid, arrival));
+        }
+        load_log() << "[OK] Loaded emergencies from " << filename
+             << " (count=" << sz << ")\n";
+    }
+};
+
+#endif
@@ -0,0 +1,323 @@
+#ifndef EMERGENCY_PAIRING_HPP
+#define EMERGENCY_PAIRING_HPP
+
+#include "utils.hpp"
+#include "emergency_case.hpp"
+#include <vector>     // node arena + pop() work list
+#include <algorithm>  // for sort (print/save order)
+
+// ==========================================================================
+// ROLE 3 ENGINE: PAIRING HEAP (meldable, alternative to EmergencyMaxHeap)
+// --------------------------------------------------------------------------
+// When a neighbouring ED diverts, we receive its whole backlog at once.
+// With the array heap that is one O(log n) push per case. A pairing heap
+// can MELD two whole queues in O(1): the root with the lower priority just
+// becomes a child of the other root.
+//
+// Data structure choice:
+//   - Each node has a first-child and a next-sibling link. The root is the
+//     most critical case.
+//   - push = meld with a one-node heap, O(1).
+//   - pop  = remove the root and pair up its children (two-pass pairing),
+//     O(log n) amortised.
+//   - All pairing heaps allocate their nodes (and long strings) from ONE
+//     shared arena, gPairingArena. That is what makes meld() O(1) between
+//     any two queues: no node or string has to be copied.
+//
+// Ties: nodes carry an arena-wide arrival number, so equal priorities are
+// popped in the order the cases were pushed (into whichever queue).
+// ==========================================================================
+
+struct PairingArena {
+    struct Node {
+        EmergencyCase e;
+        unsigned long long seq; // arrival number (tie-break)
+        int child;              // first child, -1 = none
+        int sibling;            // next sibling, -1 = none
+        bool used;              // false while on the free list
+    };
+
+    vector<Node> nodes;
+    vector<int>  freeList;
+    unsigned long long nextSeq = 0;
+
+    // Long strings of every pairing heap (see strpool.hpp)
+    StringPool pool;
+    size_t compactAt = POOL_COMPACT_MIN;
+
+    int alloc(const EmergencyCase& e) {
+        int i;
+        if (!freeList.empty()) {
+            i = freeList.back();
+            freeList.pop_back();
+        } else {
+            i = (int)nodes.size();
+            nodes.push_back(Node());
+        }
+        Node& n = nodes[i];
+        n.e       = e;
+        n.seq     = nextSeq++;
+        n.child   = -1;
+        n.sibling = -1;
+        n.used    = true;
+        return i;
+    }
+
+    void release(int i) {
+        nodes[i].used = false;
+        freeList.push_back(i);
+    }
+
+    // Rebuild the shared pool from every node still in use by any heap
+    void compact() {
+        StringPool fresh;
+        for (Node& n : nodes) {
+            if (!n.used) continue;
+            repool_case(n.e, fresh, pool);
+        }
+        pool.buf.swap(fresh.buf);
+        compactAt = max(POOL_COMPACT_MIN, 2 * pool.bytes());
+    }
+};
+
+// One arena shared by all pairing heaps (C++17 inline variable)
+inline PairingArena gPairingArena;
+
+struct EmergencyPairingHeap {
+    PairingArena& arena = gPairingArena;
+    int root = -1;   // most critical case, -1 = empty
+    int sz   = 0;
+    vector<int> work;   // scratch list for pop(), kept to avoid reallocating
+
+    EmergencyPairingHeap() {}
+    EmergencyPairingHeap(const EmergencyPairingHeap&) = delete;   // owns nodes
+    EmergencyPairingHeap& operator=(const EmergencyPairingHeap&) = delete;
+    ~EmergencyPairingHeap() { clear(); }
+
+    const char* engineName() const { return "Pairing Heap"; }
+
+    bool isFull()  const { return sz == MAX_EMERG; }
+    bool isEmpty() const { return sz == 0; }
+    int  size()    const { return sz; }
+
+    // Return every node of this heap to the arena, O(n)
+    void clear() {
+        if (root >= 0) {
+            collect(work);
+            for (int i : work) arena.release(i);
+        }
+        root = -1;
+        sz = 0;
+    }
+
+    // Read one of a record's string fields as a C string
+    const char* str(const PoolStr& s) const { return arena.pool.get(s); }
+
+    // Bytes held, including the whole shared arena (see memory.hpp)
+    size_t memBytes() const {
+        return sizeof(*this) + work.capacity() * sizeof(int)
+             + arena.nodes.capacity() * sizeof(PairingArena::Node)
+             + arena.freeList.capacity() * sizeof(int) + arena.pool.buf.capacity();
+    }
+
+    // Rebuild the arena's string pool (shared with other pairing heaps)
+    void compact() { arena.compact(); }
+
+    // Build a case whose strings are stored in the shared arena pool
+    EmergencyCase make(const string& patient, const string& type, int prio,
+                       const string& patientId = "", long long arrival = 0) {
+        if (arena.pool.bytes() > arena.compactAt) arena.compact();
+        EmergencyCase e;
+        e.patient   = arena.pool.intern(patient);
+        e.type      = arena.pool.intern(type);
+        e.patientId = arena.pool.intern(patientId);
+        e.priority  = prio;
+        set_arrival(e, arrival);
+        return e;
+    }
+
+    // true if node a must be served before node b
+    bool before(int a, int b) const {
+        const PairingArena::Node& x = arena.nodes[a];
+        const PairingArena::Node& y = arena.nodes[b];
+        if (x.e.priority != y.e.priority) return x.e.priority > y.e.priority;
+        return x.seq < y.seq;
+    }
+
+    // Make the less critical of two roots the first child of the other
+    int link(int a, int b) {
+        if (a < 0) return b;
+        if (b < 0) return a;
+        if (before(b, a)) swap(a, b);
+        arena.nodes[b].sibling = arena.nodes[a].child;
+        arena.nodes[a].child   = b;
+        return a;
+    }
+
+    // Insert a case in O(1)
+    void push(const EmergencyCase& e) {
+        if (isFull()) {
+            cout << "Emergency queue is full.\n";
+            return;
+        }
+        root = link(root, arena.alloc(e));
+        sz++;
+    }
+
+    // Most critical case (caller checks isEmpty() first)
+    EmergencyCase top() const { return arena.nodes[root].e; }
+
+    // ----------------------------------------------------------------------
+    // pop()
+    // ----------------------------------------------------------------------
+    // Purpose : Remove the most critical case.
+    // Method  : Two-pass pairing of the root's children: link them in pairs
+    //           from left to right, then link the pairs from right to left.
+    //           This keeps the amortised cost at O(log n).
+    // ----------------------------------------------------------------------
+    void pop() {
+        if (isEmpty()) return;
+        work.clear();
+        for (int c = arena.nodes[root].child; c >= 0; ) {
+            int next = arena.nodes[c].sibling;
+            arena.nodes[c].sibling = -1;
+            work.push_back(c);
+            c = next;
+        }
+        arena.release(root);
+
+        size_t pairs = 0;
+        for (size_t i = 0; i < work.size(); i += 2) {
+            int a = work[i];
+            int b = (i + 1 < work.size()) ? work[i + 1] : -1;
+            work[pairs++] = link(a, b);
+        }
+        int r = -1;
+        for (size_t i = pairs; i-- > 0; ) r = link(work[i], r);
+
+        root = r;
+        sz--;
+    }
+
+    // ----------------------------------------------------------------------
+    // meld()
+    // ----------------------------------------------------------------------
+    // Purpose : Move every case of `other` into this queue in O(1). `other`
+    //           is left empty.
+    // Return  : false (nothing moved) if the result would exceed MAX_EMERG.
+    // ----------------------------------------------------------------------
+    bool meld(EmergencyPairingHeap& other) {
+        if (&other == this || other.isEmpty()) return true;
+        if (sz + other.sz > MAX_EMERG) return false;
+        root = link(root, other.root);
+        sz  += other.sz;
+        other.root = -1;
+        other.sz   = 0;
+        return true;
+    }
+
+    // All node indices of this heap (in no particular order)
+    void collect(vector<int>& out) const {
+        out.clear();
+        if (root < 0) return;
+        out.push_back(root);
+        for (size_t k = 0; k < out.size(); ++k) {
+            const PairingArena::Node& n = arena.nodes[out[k]];
+            if (n.child   >= 0) out.push_back(n.child);
+            if (n.sibling >= 0 && out[k] != root) out.push_back(n.sibling);
+        }
+    }
+
+    // Call f(case) for every pending case, in no particular order
+    template <class F>
+    void forEach(F f) const {
+        vector<int> all;
+        collect(all);
+        for (int i : all) f(arena.nodes[i].e);
+    }
+
+    // Call f(case) for every case with priority >= minPrio. Children never
+    // outrank their parent, so the children of a lower node are skipped
+    // (its siblings are not: they hang off the same parent).
+    template <class F>
+    void forEachAtLeast(int minPrio, F f) const {
+        vector<int> stack;
+        if (root >= 0) stack.push_back(root);
+        while (!stack.empty()) {
+            const PairingArena::Node& n = arena.nodes[stack.back()];
+            stack.pop_back();
+            if (n.sibling >= 0) stack.push_back(n.sibling);
+            if (n.e.priority < minPrio) continue;
+            f(n.e);
+            if (n.child >= 0) stack.push_back(n.child);
+        }
+    }
+
+    // Node indices in pop order, without modifying the heap
+    vector<int> sortedNodes() const {
+        vector<int> order;
+        collect(order);
+        sort(order.begin(), order.end(),
+             [&](int a, int b) { return before(a, b); });
+        return order;
+    }
+
+    // Display all cases from highest to lowest priority
+    void print() const {
+        if (isEmpty()) {
+            cout << "No emergency cases pending.\n";
+            return;
+        }
+
+        cout << left << setw(22) << "Patient"
+             << setw(18) << "Emergency"
+             << "Priority" << "\n";
+        line();
+
+        for (int i : sortedNodes()) {
+            const EmergencyCase& e = arena.nodes[i].e;
+            cout << left << setw(22) << str(e.patient)
+                 << setw(18) << str(e.type)
+                 << e.priority << "\n";
+        }
+
+        cout << "(Shown from highest to lowest priority.)\n";
+    }
+
+    // Same file format as EmergencyMaxHeap, written in pop order
+    void saveToFile(const char* filename) const {
+        ofstream out(filename);
+        if (!out) {
+            cout << "[Error] Cannot open " << filename << " for writing.\n";
+            return;
+        }
+        for (int i : sortedNodes()) {
+            const EmergencyCase& e = arena.nodes[i].e;
+            write_emergency_record(out, str(e.patient), str(e.type),
+                                   e.priority, str(e.patientId), e.arrival);
+        }
+    }
+
+    // Load cases from a file in the saveToFile() format
+    void loadFromFile(const char* filename) {
+        ifstream in(filename);
+        if (!in) {
+            load_log() << "[Info] " << filename
+                 << " not found. Starting with empty emergencies.\n";
+            clear();
+            return;
+        }
+        clear();
+        string spatient, stype, sid;
+        int prio;
+        long long arrival;
+        while (read_emergency_record(in, spatient, stype, prio, sid, arrival)) {
+            if (isFull()) break;
+            push(make(spatient, stype, prio, sid, arrival));
+        }
+        load_log() << "[OK] Loaded emergencies from " << filename
+             << " (count=" << sz << ")\n";
+    }
+};
+
+#endif
@@ -0,0 +1,415 @@
+#ifndef EMERGENCY_PERSISTENT_HPP
+#define EMERGENCY_PERSISTENT_HPP
+
+#include "utils.hpp"
+#include "emergency_case.hpp"
+#include <vector>     // node pool + free list
+
+// ==========================================================================
+// ROLE 3 ENGINE: PERSISTENT LEFTIST HEAP (alternative to EmergencyMaxHeap)
+// --------------------------------------------------------------------------
+// Views, reports and replication need a consistent copy of the emergency
+// queue. With the array heap that means copying every case (print() used
+// to copy the whole array). This engine makes such a copy O(1).
+//
+// Data structure choice:
+//   - A LEFTIST max-heap: every node's left subtree has a right spine at
+//     least as long as its right subtree, so right spines have O(log n)
+//     nodes and merge() walks only those.
+//   - push/pop are merges and never modify an existing node. Instead the
+//     nodes on the merge path are copied ("path copying") and the rest of
+//     the tree is shared between the old and the new version.
+//   - A version is just a root index, so snapshot() costs O(1).
+//   - Nodes live in one pool (vector + free list) and carry a reference
+//     count: a node is recycled once no version points to it any more.
+//
+// Ties: each node stores its arrival number, so cases with equal priority
+// are popped in arrival order.
+// ==========================================================================
+
+struct EmergencyPersistentHeap;
+
+// --------------------------------------------------------------------------
+// EmergencySnapshot
+// --------------------------------------------------------------------------
+// A read-only version of the queue taken with snapshot(). It stays the same
+// no matter what happens to the live queue afterwards, and holds a
+// reference on its root so the shared nodes are not recycled under it.
+// Popping from a snapshot only advances the snapshot itself.
+// --------------------------------------------------------------------------
+struct EmergencySnapshot {
+    EmergencyPersistentHeap* owner = nullptr;
+    int root = -1;   // root node index, -1 = empty
+    int sz   = 0;
+
+    EmergencySnapshot() {}
+    EmergencySnapshot(EmergencyPersistentHeap* o, int r, int n);
+    EmergencySnapshot(const EmergencySnapshot& o);
+    EmergencySnapshot& operator=(const EmergencySnapshot& o);
+    ~EmergencySnapshot();
+
+    bool isEmpty() const { return root < 0; }
+    int  size()    const { return sz; }
+    EmergencyCase top() const;
+    void pop();
+};
+
+struct EmergencyPersistentHeap {
+    struct Node {
+        EmergencyCase e;
+        unsigned seq;    // arrival number (tie-break)
+        int left;        // child indices, -1 = none
+        int right;
+        int rank;        // length of the right spine (leftist property)
+        int refs;        // versions/parents pointing here, 0 = free
+    };
+
+    vector<Node> nodes;     // node pool
+    vector<int>  freeList;  // recycled node indices
+    int root = -1;          // current version of the live queue
+    int sz   = 0;
+    unsigned nextSeq = 0;
+
+    // Out-of-line storage for long strings (see strpool.hpp). Shared by
+    // all versions, since they share nodes.
+    StringPool pool;
+    size_t compactAt = POOL_COMPACT_MIN;
+
+    const char* engineName() const { return "Persistent Leftist Heap"; }
+
+    bool isFull()  const { return sz == MAX_EMERG; }
+    bool isEmpty() const { return sz == 0; }
+    int  size()    const { return sz; }
+
+    // Reset to empty. Outstanding snapshots must be destroyed first.
+    void clear() {
+        release(root);
+        root = -1;
+        sz = 0;
+        nextSeq = 0;
+        if (liveNodes() == 0) {
+            nodes.clear();
+            freeList.clear();
+            pool.clear();
+            compactAt = POOL_COMPACT_MIN;
+        }
+    }
+
+    // Read one of a record's string fields as a C string
+    const char* str(const PoolStr& s) const { return pool.get(s); }
+
+    // Bytes held: node pool, free list and string pool (see memory.hpp)
+    size_t memBytes() const {
+        return sizeof(*this) + nodes.capacity() * sizeof(Node)
+             + freeList.capacity() * sizeof(int) + pool.buf.capacity();
+    }
+
+    // Build a case whose strings are stored in this heap's pool
+    EmergencyCase make(const string& patient, const string& type, int prio,
+                       const string& patientId = "", long long arrival = 0) {
+        if (pool.bytes() > compactAt) compact();
+        EmergencyCase e;
+        e.patient   = pool.intern(patient);
+        e.type      = pool.intern(type);
+        e.patientId = pool.intern(patientId);
+        e.priority  = prio;
+        set_arrival(e, arrival);
+        return e;
+    }
+
+    // ----------------------------------------------------------------------
+    // compact()
+    // ----------------------------------------------------------------------
+    // Purpose : Rebuild the string pool from every node that is still in
+    //           use by ANY version (live queue or snapshot). Nodes are
+    //           updated in place, so all versions stay readable.
+    // ----------------------------------------------------------------------
+    void compact() {
+        StringPool fresh;
+        for (Node& n : nodes) {
+            if (n.refs == 0) continue;
+            repool_case(n.e, fresh, pool);
+        }
+        pool.buf.swap(fresh.buf);
+        compactAt = max(POOL_COMPACT_MIN, 2 * pool.bytes());
+    }
+
+    int liveNodes() const { return (int)(nodes.size() - freeList.size()); }
+
+    // Call f(case) for every case of the live version, in no particular
+    // order (depth-first walk, no path copies)
+    template <class F>
+    void forEach(F f) const {
+        vector<int> stack;
+        if (root >= 0) stack.push_back(root);
+        while (!stack.empty()) {
+            const Node& n = nodes[stack.back()];
+            stack.pop_back();
+            f(n.e);
+            if (n.left  >= 0) stack.push_back(n.left);
+            if (n.right >= 0) stack.push_back(n.right);
+        }
+    }
+
+    // Same, but only cases with priority >= minPrio: children never
+    // outrank their parent, so lower subtrees are skipped
+    template <class F>
+    void forEachAtLeast(int minPrio, F f) const {
+        vector<int> stack;
+        if (root >= 0) stack.push_back(root);
+        while (!stack.empty()) {
+            const Node& n = nodes[stack.back()];
+            stack.pop_back();
+            if (n.e.priority < minPrio) continue;
+            f(n.e);
+            if (n.left  >= 0) stack.push_back(n.left);
+            if (n.right >= 0) stack.push_back(n.right);
+        }
+    }
+
+    // ---------------------------- node pool -------------------------------
+
+    int rankOf(int i) const { return i < 0 ? 0 : nodes[i].rank; }
+
+    void retain(int i) { if (i >= 0) nodes[i].refs++; }
+
+    // Drop one reference; recycle the node (and, in turn, its children)
+    // when nothing points to it any more. Iterative, so a long left spine
+    // cannot overflow the call stack.
+    void release(int i) {
+        if (i < 0 || --nodes[i].refs > 0) return;   // fast path: still shared
+        vector<int> todo;
+        if (nodes[i].left  >= 0) todo.push_back(nodes[i].left);
+        if (nodes[i].right >= 0) todo.push_back(nodes[i].right);
+        freeList.push_back(i);
+        while (!todo.empty()) {
+            int k = todo.back();
+            todo.pop_back();
+            if (--nodes[k].refs > 0) continue;
+            if (nodes[k].left  >= 0) todo.push_back(nodes[k].left);
+            if (nodes[k].right >= 0) todo.push_back(nodes[k].right);
+            freeList.push_back(k);
+        }
+    }
+
+    int alloc(const EmergencyCase& e, unsigned seq, int left, int right) {
+        int i;
+        if (!freeList.empty()) {
+            i = freeList.back();
+            freeList.pop_back();
+        } else {
+            i = (int)nodes.size();
+            nodes.push_back(Node());
+        }
+        Node& n = nodes[i];
+        n.e = e;
+        n.seq = seq;
+        // Keep the leftist property: the deeper spine goes left
+        if (rankOf(left) < rankOf(right)) swap(left, right);
+        n.left  = left;
+        n.right = right;
+        n.rank  = rankOf(right) + 1;
+        n.refs  = 1;
+        return i;
+    }
+
+    // true if node a must be served before node b
+    bool before(int a, int b) const {
+        const Node& x = nodes[a];
+        const Node& y = nodes[b];
+        if (x.e.priority != y.e.priority) return x.e.priority > y.e.priority;
+        return x.seq < y.seq;
+    }
+
+    // ----------------------------------------------------------------------
+    // merge()
+    // ----------------------------------------------------------------------
+    // Purpose : Return a NEW version containing the cases of versions a and
+    //           b, without changing either of them. The result is an owned
+    //           reference (refs already counted for the caller).
+    // Cost    : O(log n) new nodes, one per step along the right spines.
+    // ----------------------------------------------------------------------
+    int merge(int a, int b) {
+        if (a < 0) { retain(b); return b; }
+        if (b < 0) { retain(a); return a; }
+        if (before(b, a)) swap(a, b);           // a now has the root case
+
+        int right = merge(nodes[a].right, b);   // owned by the new node
+        int left  = nodes[a].left;
+        retain(left);                           // shared with version a
+        EmergencyCase e = nodes[a].e;           // copy: alloc may move nodes
+        unsigned seq    = nodes[a].seq;
+        return alloc(e, seq, left, right);
+    }
+
+    // ------------------------------ queue ---------------------------------
+
+    // Insert a case: merge the live version with a one-node heap, O(log n)
+    void push(const EmergencyCase& e) {
+        if (isFull()) {
+            cout << "Emergency queue is full.\n";
+            return;
+        }
+        int single  = alloc(e, nextSeq++, -1, -1);
+        int newRoot = merge(root, single);
+        release(single);
+        release(root);
+        root = newRoot;
+        sz++;
+    }
+
+    // Most critical case (caller checks isEmpty() first)
+    EmergencyCase top() const { return nodes[root].e; }
+
+    // Remove the most critical case: the new version is the merge of the
+    // root's two subtrees, O(log n)
+    void pop() {
+        if (isEmpty()) return;
+        int newRoot = merge(nodes[root].left, nodes[root].right);
+        release(root);
+        root = newRoot;
+        sz--;
+    }
+
+    // ----------------------------------------------------------------------
+    // meld()
+    // ----------------------------------------------------------------------
+    // Purpose : Move every case of `other` into this queue (other is left
+    //           empty). Two persistent heaps could be merged in O(log n) if
+    //           they shared a node pool, but each instance has its own, so
+    //           the cases are copied over one push at a time.
+    // Return  : false (nothing moved) if the result would exceed MAX_EMERG.
+    // ----------------------------------------------------------------------
+    bool meld(EmergencyPersistentHeap& other) {
+        if (&other == this || other.isEmpty()) return true;
+        if (sz + other.sz > MAX_EMERG) return false;
+        for (EmergencySnapshot snap = other.snapshot(); !snap.isEmpty(); snap.pop()) {
+            EmergencyCase e = snap.top();
+            repool_case(e, pool, other.pool);
+            push(e);
+        }
+        other.clear();
+        return true;
+    }
+
+    // O(1) consistent copy of the current queue
+    EmergencySnapshot snapshot() { return EmergencySnapshot(this, root, sz); }
+
+    // ----------------------------------------------------------------------
+    // print()
+    // ----------------------------------------------------------------------
+    // Purpose : Display all cases from highest to lowest priority. Works on
+    //           a snapshot, so nothing is copied up front and the live queue
+    //           is untouched.
+    // ----------------------------------------------------------------------
+    void print() const {
+        if (isEmpty()) {
+            cout << "No emergency cases pending.\n";
+            return;
+        }
+
+        cout << left << setw(22) << "Patient"
+             << setw(18) << "Emergency"
+             << "Priority" << "\n";
+        line();
+
+        // Popping a snapshot allocates path copies in the shared pool, so
+        // it needs a non-const owner even though the queue does not change.
+        EmergencySnapshot snap =
+            const_cast<EmergencyPersistentHeap*>(this)->snapshot();
+        while (!snap.isEmpty()) {
+            EmergencyCase e = snap.top();
+            cout << left << setw(22) << str(e.patient)
+                 << setw(18) << str(e.type)
+                 << e.priority << "\n";
+            snap.pop();
+        }
+
+        cout << "(Shown from highest to lowest priority.)\n";
+    }
+
+    // ----------------------------------------------------------------------
+    // saveToFile()
+    // ----------------------------------------------------------------------
+    // Format  : Same as EmergencyMaxHeap (patient, type, priority per case).
+    // Note    : Written in pop order, so reloading keeps the tie order.
+    // ----------------------------------------------------------------------
+    void saveToFile(const char* filename) const {
+        ofstream out(filename);
+        if (!out) {
+            cout << "[Error] Cannot open " << filename << " for writing.\n";
+            return;
+        }
+        EmergencySnapshot snap =
+            const_cast<EmergencyPersistentHeap*>(this)->snapshot();
+        while (!snap.isEmpty()) {
+            EmergencyCase e = snap.top();
+            write_emergency_record(out, str(e.patient), str(e.type),
+                                   e.priority, str(e.patientId), e.arrival);
+            snap.pop();
+        }
+    }
+
+    // Load cases from a file in the saveToFile() format
+    void loadFromFile(const char* filename) {
+        ifstream in(filename);
+        if (!in) {
+            load_log() << "[Info] " << filename
+                 << " not found. Starting with empty emergencies.\n";
+            clear();
+            return;
+        }
+        clear();
+        string spatient, stype, sid;
+        int prio;
+        long long arrival;
+        while (read_emergency_record(in, spatient, stype, prio, sid, arrival)) {
+            if (isFull()) break;
+            push(make(spatient, stype, prio, sid, arrival));
+        }
+        load_log() << "[OK] Loaded emergencies from " << filename
+             << " (count=" << sz << ")\n";
+    }
+};
+
+// ------------------------ EmergencySnapshot methods ------------------------
+
+inline EmergencySnapshot::EmergencySnapshot(EmergencyPersistentHeap* o, int r, int n)
+    : owner(o), root(r), sz(n) {
+    owner->retain(root);
+}
+
+inline EmergencySnapshot::EmergencySnapshot(const EmergencySnapshot& o)
+    : owner(o.owner), root(o.root), sz(o.sz) {
+    if (owner) owner->retain(root);
+}
+
+inline EmergencySnapshot& EmergencySnapshot::operator=(const EmergencySnapshot& o) {
+    if (this == &o) return *this;
+    if (o.owner) o.owner->retain(o.root);
+    if (owner)   owner->release(root);
+    owner = o.owner;
+    root  = o.root;
+    sz    = o.sz;
+    return *this;
+}
+
+inline EmergencySnapshot::~EmergencySnapshot() {
+    if (owner) owner->release(root);
+}
+
+inline EmergencyCase EmergencySnapshot::top() const {
+    return owner->nodes[root].e;
+}
+
+inline void EmergencySnapshot::pop() {
+    if (isEmpty()) return;
+    int l = owner->nodes[root].left;
+    int r = owner->nodes[root].right;
+    int newRoot = owner->merge(l, r);
+    owner->release(root);
+    root = newRoot;
+    sz--;
+}
+
+#endif
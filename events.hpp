@@ -0,0 +1,302 @@
+#ifndef EVENTS_HPP
+#define EVENTS_HPP
+
+#include "utils.hpp"
+#include "memory.hpp"   // accounting
+#include <atomic>     // lock-free ring positions and slot versions
+#include <chrono>     // for steady_clock (event time)
+#include <cstdint>
+#ifdef __linux__
+#include <time.h>     // clock_gettime(CLOCK_MONOTONIC_COARSE)
+#endif
+
+// ---------------------------------------------------------------------------
+// events.hpp
+// ---------------------------------------------------------------------------
+// In-process change notifications. Every UI function that changes one of
+// the four role containers publishes a small typed Event on gEvents.
+// Two kinds of consumers:
+//   - Listeners (change stream, arrival counters, capacity planner, status
+//     board) register a function with EventListen and are called by
+//     publish_event() on the menu thread, in registration order, once the
+//     change is done. They also get the record's before/after images (the
+//     change-stream format, cdc.hpp), which do not fit in the ring.
+//   - Subscribers (dashboards, replication, audit) read the ring at their
+//     own pace, possibly from another thread.
+// A mutation site therefore makes ONE call, publish_event(), per record
+// changed; bulk operations (room moves, rotations, imports, dispatch)
+// publish one event per record.
+//
+// Data structure choice:
+//   - A ring buffer of EVENT_RING slots with ONE writer (the menu thread)
+//     and any number of readers. Nothing is locked: the writer never waits
+//     for readers, so publish() stays at a few tens of nanoseconds.
+//   - Each subscriber keeps its own cursor (next event number to read).
+//   - Each slot carries a version number (seqlock style). A reader that
+//     falls more than EVENT_RING events behind finds its slots overwritten:
+//     it skips ahead to the oldest event still in the ring and counts the
+//     events it missed in `lost`. Such slow subscribers are reported by
+//     print_event_bus().
+//
+// Usage:
+//   inline EventListen gXxxListen(on_change);   // at namespace scope
+//
+//   EventSubscriber sub("dashboard");
+//   gEvents.subscribe(sub);          // at start-up, before other threads
+//   Event ev;
+//   while (sub.poll(ev)) { ... }
+// ---------------------------------------------------------------------------
+
+enum EventRole : uint8_t { EV_PATIENTS, EV_SUPPLIES, EV_EMERGENCIES, EV_AMBULANCES };
+enum EventKind : uint8_t { EV_INSERT, EV_REMOVE, EV_UPDATE };
+
+// Event::flags
+enum EventFlag : uint16_t {
+    EVF_TRANSFER = 1,   // moved in or out (backlog import, escalated patient):
+                        // neither an arrival nor a service
+    EVF_REPLAY   = 2    // re-applied from a journal at start-up
+};
+
+const int EVENT_KEY_LEN = 24;
+
+struct Event {
+    uint64_t seq;      // position in the stream (set by publish)
+    int64_t  timeNs;   // event_clock_ns() time of the change
+    uint8_t  role;     // EventRole
+    uint8_t  kind;     // EventKind
+    uint16_t flags;    // EventFlag bits
+    int32_t  value;    // role-specific: room, quantity, priority, count
+    char     key[EVENT_KEY_LEN]; // patient ID, supply type, patient name,
+                                 // plate or operation (may be truncated)
+};
+
+const int EVENT_WORDS = sizeof(Event) / sizeof(uint64_t);
+static_assert(sizeof(Event) % sizeof(uint64_t) == 0, "Event must be whole words");
+
+const int EVENT_RING = 1024;                 // must be a power of two
+const int MAX_EVENT_SUBSCRIBERS = 8;
+
+inline const char* event_role_name(int r) {
+    static const char* names[] = { "patients", "supplies", "emergencies", "ambulances" };
+    return (r >= 0 && r < 4) ? names[r] : "?";
+}
+
+inline const char* event_kind_name(int k) {
+    static const char* names[] = { "insert", "remove", "update" };
+    return (k >= 0 && k < 3) ? names[k] : "?";
+}
+
+// ---------------------------------------------------------------------------
+// event_clock_ns()
+// ---------------------------------------------------------------------------
+// Time stamp for events, in nanoseconds. Consumers bucket events by second
+// or minute, so millisecond resolution is enough. On Linux the coarse
+// monotonic clock costs ~10 ns instead of ~50 ns for steady_clock, which
+// is most of the publish() budget.
+// ---------------------------------------------------------------------------
+inline int64_t event_clock_ns() {
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct EventBus;
+
+// ---------------------------------------------------------------------------
+// EventSubscriber
+// ---------------------------------------------------------------------------
+// One reader of the bus. Only the thread that owns it calls poll(); lag()
+// may be called from any thread, so the cursor is atomic too.
+// ---------------------------------------------------------------------------
+struct EventSubscriber {
+    const char* name;
+    EventBus* bus = nullptr;
+    atomic<uint64_t> cursor{0};         // next event number to read
+    atomic<uint64_t> lost{0};           // events overwritten before read
+
+    explicit EventSubscriber(const char* n) : name(n) {}
+
+    bool poll(Event& out);              // next event, false if none yet
+    uint64_t lag() const;               // events published but not read
+};
+
+// Called by publish_event() on the menu thread; before/after are the
+// record's change-stream images ("" if none). Must not publish.
+typedef void (*EventListener)(const Event& ev, const string& before,
+                              const string& after);
+
+const int MAX_EVENT_LISTENERS = 8;
+
+struct EventBus {
+    struct alignas(64) Slot {           // one cache line per slot
+        atomic<uint64_t> version{0};    // 2*seq+1 while writing, 2*seq+2 done
+        atomic<uint64_t> word[EVENT_WORDS];
+    };
+
+    Slot ring[EVENT_RING];
+    atomic<uint64_t> head{0};           // number of events published
+    EventSubscriber* subs[MAX_EVENT_SUBSCRIBERS];
+    int nsubs = 0;
+    EventListener listeners[MAX_EVENT_LISTENERS];
+    int nlisteners = 0;
+
+    // Register a reader; it sees events published from now on
+    bool subscribe(EventSubscriber& s) {
+        if (nsubs == MAX_EVENT_SUBSCRIBERS) return false;
+        s.bus = this;
+        s.cursor.store(head.load(memory_order_acquire), memory_order_release);
+        subs[nsubs++] = &s;
+        return true;
+    }
+
+    // Register a listener (at start-up, see EventListen)
+    bool listen(EventListener f) {
+        if (nlisteners == MAX_EVENT_LISTENERS) return false;
+        listeners[nlisteners++] = f;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------
+    // publish()
+    // ----------------------------------------------------------------------
+    // Purpose : Append one event to the ring (listeners are called by
+    //           publish_event()). Single writer only (the menu thread).
+    // Method  : Mark the slot odd (being written), store the words, mark it
+    //           even with the event's number, then advance head. Readers
+    //           check the version before and after copying the words.
+    // Return  : the event as stored.
+    // ----------------------------------------------------------------------
+    Event publish(EventRole role, EventKind kind, const char* key, int value,
+                  uint16_t flags = 0) {
+        uint64_t s = head.load(memory_order_relaxed);
+        Event ev;
+        ev.seq      = s;
+        ev.timeNs   = event_clock_ns();
+        ev.role     = role;
+        ev.kind     = kind;
+        ev.flags    = flags;
+        ev.value    = value;
+        int i = 0;
+        for (; i < EVENT_KEY_LEN - 1 && key[i]; ++i) ev.key[i] = key[i];
+        for (; i < EVENT_KEY_LEN; ++i) ev.key[i] = '\0';
+
+        uint64_t w[EVENT_WORDS];
+        memcpy(w, &ev, sizeof ev);
+        Slot& sl = ring[s & (EVENT_RING - 1)];
+        sl.version.store(2 * s + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        for (int k = 0; k < EVENT_WORDS; ++k)
+            sl.word[k].store(w[k], memory_order_relaxed);
+        sl.version.store(2 * s + 2, memory_order_release);
+        head.store(s + 1, memory_order_release);
+        return ev;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// EventSubscriber::poll()
+// ---------------------------------------------------------------------------
+// Purpose : Copy the next unread event into `out`.
+// Return  : false if the subscriber has read everything published so far.
+// Note    : If the writer has lapped this reader, the overwritten events are
+//           skipped and added to `lost`.
+// ---------------------------------------------------------------------------
+inline bool EventSubscriber::poll(Event& out) {
+    uint64_t c = cursor.load(memory_order_relaxed);   // only we write it
+    while (true) {
+        uint64_t h = bus->head.load(memory_order_acquire);
+        if (c == h) return false;
+        if (h - c > (uint64_t)EVENT_RING) {             // lapped
+            lost.fetch_add(h - EVENT_RING - c, memory_order_relaxed);
+            c = h - EVENT_RING;
+        }
+
+        EventBus::Slot& sl = bus->ring[c & (EVENT_RING - 1)];
+        uint64_t want = 2 * c + 2;
+        uint64_t w[EVENT_WORDS];
+        if (sl.version.load(memory_order_acquire) == want) {
+            for (int k = 0; k < EVENT_WORDS; ++k)
+                w[k] = sl.word[k].load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+            if (sl.version.load(memory_order_relaxed) == want) {
+                memcpy(&out, w, sizeof out);
+                cursor.store(c + 1, memory_order_release);
+                return true;
+            }
+        }
+        // Slot reused while we were reading it: that event is gone
+        lost.fetch_add(1, memory_order_relaxed);
+        cursor.store(++c, memory_order_release);
+    }
+}
+
+inline uint64_t EventSubscriber::lag() const {
+    if (!bus) return 0;
+    uint64_t c = cursor.load(memory_order_acquire);
+    uint64_t h = bus->head.load(memory_order_acquire);
+    return h > c ? h - c : 0;    // head read second: never behind the cursor
+}
+
+// The bus all role modules publish to (C++17 inline variable)
+inline EventBus gEvents;
+
+inline MemRegister gEventsMem(MEM_SHARED, "event bus ring",
+                              [] { return sizeof(gEvents); });
+
+// Registers a listener at start-up, e.g.
+//   inline EventListen gCdcListen(cdc_on_event);
+struct EventListen {
+    explicit EventListen(EventListener f) { gEvents.listen(f); }
+};
+
+// ---------------------------------------------------------------------------
+// publish_event()
+// ---------------------------------------------------------------------------
+// Purpose : Called at the mutation sites of the role modules, once per
+//           record changed and after the change: append the event to the
+//           ring, then call every listener with it and the record's
+//           before/after images.
+// ---------------------------------------------------------------------------
+inline void publish_event(EventRole role, EventKind kind, const char* key, int value,
+                          const string& before = string(),
+                          const string& after = string(), uint16_t flags = 0) {
+    Event ev = gEvents.publish(role, kind, key, value, flags);
+    for (int i = 0; i < gEvents.nlisteners; ++i)
+        gEvents.listeners[i](ev, before, after);
+}
+
+// ---------------------------------------------------------------------------
+// print_event_bus()
+// ---------------------------------------------------------------------------
+// Purpose : Show how many events were published and, per subscriber, how
+//           far behind it is. A subscriber that lost events, or is more than
+//           3/4 of the ring behind, is flagged SLOW.
+// ---------------------------------------------------------------------------
+inline void print_event_bus() {
+    cout << "Events published: " << gEvents.head.load() << "\n";
+    cout << "Listeners on the menu thread: " << gEvents.nlisteners << "\n";
+    if (gEvents.nsubs == 0) {
+        cout << "No subscribers.\n";
+        return;
+    }
+    cout << left << setw(16) << "Subscriber"
+         << setw(10) << "Lag"
+         << setw(10) << "Lost" << "\n";
+    line();
+    for (int i = 0; i < gEvents.nsubs; ++i) {
+        EventSubscriber* s = gEvents.subs[i];
+        uint64_t lag  = s->lag();
+        uint64_t lost = s->lost.load();
+        cout << left << setw(16) << s->name
+             << setw(10) << lag
+             << setw(10) << lost
+             << ((lost > 0 || lag > EVENT_RING * 3 / 4) ? "SLOW" : "") << "\n";
+    }
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef LOADER_HPP
+#define LOADER_HPP
+
+#include "utils.hpp"
+#include "patient.hpp"
+#include "supply.hpp"
+#include "emergency.hpp"
+#include "ambulance.hpp"
+#include "memory.hpp"   // accounting
+#include <chrono>     // for steady_clock (load timings)
+#include <mutex>      // for call_once / once_flag, mutex
+#include <sstream>    // for ostringstream (messages of a load)
+#include <thread>     // background prefetch
+
+// ---------------------------------------------------------------------------
+// loader.hpp
+// ---------------------------------------------------------------------------
+// Lazy per-role loading. Instead of reading all four role files before the
+// first menu, each role is loaded the first time it is opened, so the time
+// to the first prompt does not depend on the size of the data.
+//
+//   - ensure_loaded(role) loads a role exactly once (std::call_once), from
+//     whichever thread gets there first; a caller that arrives while
+//     another thread is loading the same role waits for it.
+//   - After the menu is shown, a background thread prefetches the roles
+//     not opened yet (HOSPITAL_PREFETCH=0 at build time turns it off).
+//   - Loads never run at the same time (one mutex): the patient and
+//     emergency loads both fill the shared name index (phonetic.hpp).
+//   - The messages of a load are collected (see load_log() in utils.hpp)
+//     and printed, with the time the load took, when the role is first
+//     opened on the menu thread.
+//
+// The clerk and emergency roles share data (escalation by patient ID, the
+// duplicate name check), so opening either loads both. If escalations.log
+// exists at start-up (a run was interrupted, see emergency.hpp), both are
+// loaded and the journal replayed before the menu, as replaying changes
+// the files and the change stream, which only the menu thread may do.
+// ---------------------------------------------------------------------------
+
+#ifndef HOSPITAL_PREFETCH
+#define HOSPITAL_PREFETCH 1
+#endif
+
+enum LoadRole { LOAD_PATIENTS, LOAD_SUPPLIES, LOAD_EMERGENCIES, LOAD_AMBULANCES,
+                LOAD_ROLES };
+
+struct RoleLoad {
+    const char* name;
+    void (*load)();
+    once_flag once;
+    long long us = 0;          // time the load took
+    bool background = false;   // loaded by the prefetch thread
+    string log;                // messages of the load
+    bool shown = false;        // log printed (menu thread only)
+    atomic<bool> done{false};  // loaded (any thread may ask)
+
+    RoleLoad(const char* n, void (*f)()) : name(n), load(f) {}
+};
+
+struct Loader {
+    RoleLoad roles[LOAD_ROLES] = {
+        { "patients",    load_patient_role },
+        { "supplies",    load_supplies_from_file },
+        { "emergencies", load_emergencies_from_file },
+        { "ambulances",  load_ambulances_from_file },
+    };
+    mutex busy;                // one load at a time
+    thread prefetch;
+    atomic<bool> stop{false};  // ask the prefetch thread to finish early
+};
+
+inline Loader gLoader;
+
+// Messages of each load, kept until the role is opened
+inline MemRegister gLoaderMem(MEM_SHARED, "load messages", [] {
+    size_t b = 0;
+    for (const RoleLoad& r : gLoader.roles) b += mem_string(r.log);
+    return b;
+});
+
+// Load role r once; `background` only labels the timing report
+inline void load_once(LoadRole r, bool background) {
+    RoleLoad& role = gLoader.roles[r];
+    call_once(role.once, [&] {
+        lock_guard<mutex> lock(gLoader.busy);
+        ostringstream log;
+        ostream* saved = tLoadLog;
+        tLoadLog = &log;
+        auto t0 = chrono::steady_clock::now();
+        role.load();
+        role.us = chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - t0).count();
+        tLoadLog = saved;
+        role.log = log.str();
+        role.background = background;
+        role.done.store(true, memory_order_release);
+    });
+}
+
+// ---------------------------------------------------------------------------
+// ensure_loaded()
+// ---------------------------------------------------------------------------
+// Purpose : Called by the menu before it opens a role: load the role (and
+//           its partner, see above) if that has not happened yet, then show
+//           the load messages and timing once.
+// ---------------------------------------------------------------------------
+inline void ensure_loaded(LoadRole r) {
+    LoadRole need[2] = { r, r };
+    int n = 1;
+    if (r == LOAD_PATIENTS || r == LOAD_EMERGENCIES) {
+        need[0] = LOAD_PATIENTS;
+        need[1] = LOAD_EMERGENCIES;
+        n = 2;
+    }
+    for (int k = 0; k < n; ++k) load_once(need[k], false);
+    for (int k = 0; k < n; ++k) {
+        RoleLoad& role = gLoader.roles[need[k]];
+        if (role.shown) continue;
+        cout << role.log << "[Load] " << role.name << ": " << fixed << setprecision(1)
+             << role.us / 1000.0 << " ms" << (role.background ? " (prefetched)" : "")
+             << "\n";
+        cout.unsetf(ios::floatfield);
+        role.shown = true;
+    }
+}
+
+inline void ensure_all_loaded() {
+    for (int r = 0; r < LOAD_ROLES; ++r) ensure_loaded((LoadRole)r);
+}
+
+// ---------------------------------------------------------------------------
+// loader_start()
+// ---------------------------------------------------------------------------
+// Purpose : Called by main() before the first menu: replay an escalation
+//           journal if there is one, then start the prefetch thread.
+// ---------------------------------------------------------------------------
+inline void loader_start() {
+    if (ifstream(ESCALATION_LOG)) {
+        ensure_loaded(LOAD_PATIENTS);
+        recover_escalations();   // escalations.log left by an interrupted run
+    }
+#if HOSPITAL_PREFETCH
+    gLoader.prefetch = thread([] {
+        for (int r = 0; r < LOAD_ROLES && !gLoader.stop.load(); ++r)
+            load_once((LoadRole)r, true);
+    });
+#endif
+}
+
+// Called by main() before it returns: stop prefetching and wait for it
+inline void loader_finish() {
+    gLoader.stop.store(true);
+    if (gLoader.prefetch.joinable()) gLoader.prefetch.join();
+}
+
+#endif
@@ -11,18 +11,59 @@
 //   Role 3: Emergency Dept Officer       -> uses PriorityQ  (emergency.hpp)
 //   Role 4: Ambulance Dispatcher         -> uses CircQueue  (ambulance.hpp)
 //
-// Data for each role is loaded from text files when the program starts, and
-// the role modules are responsible for saving updated data back to the files.
+// Data for each role is loaded from its text file when the role is first
+// opened (or earlier by a background prefetch, see loader.hpp), and the role
+// modules are responsible for saving updated data back to the files.
+//
+// Command-line options (see session.hpp):
+//   --record FILE           save every input line with its timing, and
+//                           the data files in FILE.snapshot
+//   --replay FILE [--paced] replay a recorded session as the input, on a
+//                           scratch copy of FILE.snapshot
+//   --cdc-read NAME         print the changes consumer NAME has not read
+//                           yet and advance its offset (see cdc.hpp)
+//   --query "TEXT"          run one query and exit (see query.hpp)
+//   --batch FILE            run one query per line of FILE ("-" = stdin)
+//   --dedupe FILE           group the names of an archive (one per line)
+//                           that sound alike (see phonetic.hpp)
+//   --report [DAYS]         discharge, supply, emergency and dispatch
+//                           reports from the change stream (see report.hpp)
+//   --status                print the status board of the running instance
+//                           (see status.hpp)
 // ---------------------------------------------------------------------------
 
 #include "patient.hpp"    // Patient queue functions + load_patients_from_file()
 #include "supply.hpp"     // Supply stack functions + load_supplies_from_file()
 #include "emergency.hpp"  // Emergency priority queue + load_emergencies_from_file()
 #include "ambulance.hpp"  // Ambulance circular queue + load_ambulances_from_file()
+#include "session.hpp"    // --record / --replay of interactive sessions
+#include "query.hpp"      // ad-hoc queries over all four roles
+#include "dispatch.hpp"   // batch assignment of cases to ambulances
+#include "loader.hpp"     // lazy per-role loading + background prefetch
+#include "memory.hpp"     // bytes per container, per-role memory limits
+#include "planner.hpp"    // predicted waits by staffing level (Erlang C)
+#include "report.hpp"     // parallel reports over the change stream
+#include "status.hpp"     // shared-memory status board for external readers
+
+int main(int argc, char** argv) {
+    if (argc == 3 && string(argv[1]) == "--cdc-read")
+        return cdc_read_cli(argv[2]);   // change stream consumer, no menus
+    if (argc == 3 && (string(argv[1]) == "--query" || string(argv[1]) == "--batch"))
+        return query_cli(argv[1], argv[2]);
+    if (argc == 3 && string(argv[1]) == "--dedupe")
+        return dedupe_cli(argv[2]);     // batch duplicate search, no menus
+    if ((argc == 2 || argc == 3) && string(argv[1]) == "--report")
+        return report_cli(argc == 3 ? argv[2] : nullptr);
+    if (argc == 2 && string(argv[1]) == "--status")
+        return status_cli();            // read another instance's board
+
+    // -----------------------------------------------------------------------
+    // STEP 0: Optional session recording/replay (redirects cin).
+    // -----------------------------------------------------------------------
+    if (!session_start(argc, argv)) return 1;
 
-int main() {
     // -----------------------------------------------------------------------
-    // STEP 1: Load existing data from text files (if the files exist).
+    // STEP 1: Existing data is loaded from text files (if the files exist).
     // Each role has its own text file and its own load_..._from_file() function:
     //
     //   patients.txt     -> patient queue
@@ -31,11 +72,14 @@ int main() {
     //   ambulances.txt   -> ambulance circular queue
     //
     // If the files do not exist, the roles will start with empty structures.
+    // A role is loaded when it is first opened (ensure_loaded() below), and
+    // a background thread prefetches the others meanwhile. Escalations
+    // journaled but not yet written to the files (escalations.log) are
+    // replayed here, see the ESCALATION section of emergency.hpp.
     // -----------------------------------------------------------------------
-    load_patients_from_file();
-    load_supplies_from_file();
-    load_emergencies_from_file();
-    load_ambulances_from_file();
+    loader_start();
+    staging_start();   // staging points are computed in the background
+    status_start();    // status board, refreshed after every change
 
     // -----------------------------------------------------------------------
     // STEP 2: Main loop for the whole system.
@@ -50,6 +94,12 @@ int main() {
         cout << "2) Medical Supply Manager (Stack)\n";
         cout << "3) Emergency Dept Officer (Priority Queue)\n";
         cout << "4) Ambulance Dispatcher (Circular Queue)\n";
+        cout << "5) Query (ad-hoc lookup)\n";
+        cout << "6) Arrival Rates & Surge Alerts\n";
+        cout << "7) Batch Dispatch (cases -> ambulances)\n";
+        cout << "8) Memory Usage & Limits\n";
+        cout << "9) Capacity Planner (waits by staffing)\n";
+        cout << "10) Operation Reports (change history)\n";
         cout << "0) Exit\n> ";
 
         int ch;
@@ -60,6 +110,7 @@ int main() {
         // error flags and ignore the bad input, then ask again.
         // -------------------------------------------------------------------
         if (!(cin >> ch)) {
+            if (cin.eof()) break;   // end of input (e.g. replay finished)
             cin.clear();   // clear error state
             cin.ignore(numeric_limits<streamsize>::max(), '\n'); // discard line
             continue;      // back to the top of the while loop
@@ -81,6 +132,7 @@ int main() {
             case 1:
                 // Role 1: Patient Admission Clerk (Queue)
                 // Handles admitting, discharging, and viewing patient queue.
+                ensure_loaded(LOAD_PATIENTS);
                 menu_patients();
                 break;
 
@@ -88,6 +140,7 @@ int main() {
                 // Role 2: Medical Supply Manager (Stack)
                 // Handles adding supplies and using supplies by type
                 // (using the most recently added batch for that type).
+                ensure_loaded(LOAD_SUPPLIES);
                 menu_supplies();
                 break;
 
@@ -95,6 +148,7 @@ int main() {
                 // Role 3: Emergency Department Officer (Priority Queue)
                 // Handles logging emergency cases and processing the most
                 // critical case first based on priority level.
+                ensure_loaded(LOAD_EMERGENCIES);
                 menu_emergency();
                 break;
 
@@ -102,16 +156,67 @@ int main() {
                 // Role 4: Ambulance Dispatcher (Circular Queue)
                 // Handles registering ambulances, rotating the shift, and
                 // displaying the current rotation order.
+                ensure_loaded(LOAD_AMBULANCES);
                 menu_ambulance();
                 break;
 
+            case 5:
+                // Ad-hoc lookups over all roles, e.g.
+                // emergencies where priority >= 8 limit 5
+                ensure_all_loaded();
+                ui_query();
+                break;
+
+            case 6:
+                // Per-minute counters of admissions, emergencies and
+                // supply use (metrics.hpp)
+                print_metrics();
+                break;
+
+            case 7:
+                // Most critical cases (role 3) assigned to the staffed
+                // ambulances (role 4) in one step (dispatch.hpp)
+                ensure_loaded(LOAD_EMERGENCIES);
+                ensure_loaded(LOAD_AMBULANCES);
+                ui_batch_dispatch();
+                break;
+
+            case 8:
+                // Bytes held by every container, index and buffer, and
+                // the per-role limits and what happens at them (memory.hpp)
+                ensure_all_loaded();
+                menu_memory();
+                break;
+
+            case 9:
+                // Erlang-C waits of the patient and emergency queues for
+                // more or fewer staff, from the observed rates (planner.hpp)
+                menu_planner();
+                break;
+
+            case 10:
+                // Discharges, supply use, emergencies and dispatches
+                // over the change stream segments (report.hpp)
+                ui_reports();
+                break;
+
             default:
                 // Any other number is invalid
                 cout << "Invalid choice.\n";
                 break;
         }
+
+        // Escalations are only journaled; write their files once here
+        checkpoint_escalations();
+        status_publish();  // roles loaded in the background meanwhile
     }
+    checkpoint_escalations();
+    loader_finish();   // wait for a prefetch still running
+    staging_finish();  // and for a staging refresh
+    master_finish();   // and for a patient master index flush
+    status_finish();   // board shows the instance as stopped
 
     // Program ends here. All data saving is handled by each role's functions.
+    session_finish();
     return 0;
 }
@@ -0,0 +1,878 @@
+#ifndef MASTER_INDEX_HPP
+#define MASTER_INDEX_HPP
+
+#include "utils.hpp"
+#include "cdc.hpp"       // records are stored as change stream images
+#include "memory.hpp"    // accounting
+#include <vector>
+#include <map>           // memtable (sorted by patient ID)
+#include <deque>         // frozen memtables waiting to be written
+#include <memory>        // for shared_ptr (memtables, runs)
+#include <mutex>
+#include <condition_variable>  // wakes the flush/merge thread
+#include <thread>
+#include <chrono>        // for steady_clock (lookup and merge timing)
+#include <cstdio>        // for fopen/fgets/fread (run files)
+#include <cstdint>
+#include <cstdlib>       // for strtoll/strtoull
+#include <ctime>         // for localtime (last change of a record)
+#include <algorithm>     // for upper_bound (sparse index)
+#include <filesystem>    // leftover WAL and run files
+
+// ==========================================================================
+// PATIENT MASTER INDEX (part of ROLE 1)
+// --------------------------------------------------------------------------
+// Every patient ID ever seen, with the latest name, condition and status
+// ("waiting", "discharged", "escalated"), updated on each admission,
+// discharge and escalation. The waiting queue only knows who is waiting
+// now; this index keeps everybody, so it has to hold tens of millions of
+// entries without holding them in memory.
+//
+// Log-structured merge (LSM) store:
+//   - memtable : the latest changes, a sorted map in memory. Every change
+//                is first appended to the memtable's write-ahead log
+//                (master_wal_<n>.log), so it survives a restart.
+//   - runs     : when the memtable reaches MASTER_MEMTABLE entries it is
+//                frozen and a new one starts at once; a background thread
+//                writes the frozen one as an immutable run sorted by ID
+//                (master_run_<n>.dat) and then drops its log. Runs are
+//                listed in master_manifest.txt, oldest first.
+//   - merging  : when MASTER_FANOUT runs of the same size tier have piled
+//                up at the new end, the same thread merges them into one
+//                (newest record of an ID wins), so the number of runs
+//                grows with log(entries), not with the number of flushes.
+//   - lookup   : memtable, frozen memtables, then the runs newest first.
+//                Every run keeps two small things in memory
+//                (master_run_<n>.idx on disk): a Bloom filter of its IDs,
+//                so a run without the ID is skipped without reading it,
+//                and a sparse index (the first ID of every MASTER_BLOCK
+//                records with its file offset), so a run that has it costs
+//                one read of one block. A lookup is well under a
+//                millisecond whatever the number of entries.
+//
+// Admissions never wait for disk work: the menu thread only appends one
+// log line and updates the memtable under a mutex that the background
+// thread holds for pointer swaps only. While a long merge runs, further
+// frozen memtables wait in memory (and in their logs) and stay searchable.
+// ==========================================================================
+
+#ifndef HOSPITAL_MASTER_MEMTABLE
+#define HOSPITAL_MASTER_MEMTABLE 65536
+#endif
+
+const size_t MASTER_MEMTABLE     = HOSPITAL_MASTER_MEMTABLE;  // entries per flush
+const int    MASTER_FANOUT       = 4;    // runs of one tier merged together
+const int    MASTER_BLOCK        = 64;   // records per sparse index entry
+const int    MASTER_BLOOM_BITS   = 10;   // filter bits per ID (about 1% false hits)
+const int    MASTER_BLOOM_HASHES = 7;
+
+#define MASTER_MANIFEST "master_manifest.txt"
+
+struct MasterRecord {
+    string name, condition, status;
+    long long updated = 0;       // time of the last change (seconds)
+};
+
+// One stored line: id|name|condition|status|updated (cdc_image() escaping)
+inline string master_line(const string& id, const MasterRecord& r) {
+    return cdc_image({ id, r.name, r.condition, r.status, to_string(r.updated) }) + '\n';
+}
+
+// Parse a stored line (without '\n'); returns false if it is not one
+inline bool master_parse(const char* p, const char* end, vector<string>& f,
+                         string& id, MasterRecord& r) {
+    if (cdc_fields(p, end, f) < 5) return false;
+    id = f[0];
+    r.name = f[1];
+    r.condition = f[2];
+    r.status = f[3];
+    r.updated = atoll(f[4].c_str());
+    return true;
+}
+
+// One line of a FILE* (large ones too), without '\n'
+inline bool master_getline(FILE* f, string& s) {
+    s.clear();
+    char buf[4096];
+    while (fgets(buf, sizeof buf, f)) {
+        s += buf;
+        if (s.back() == '\n') {
+            s.pop_back();
+            return true;
+        }
+    }
+    return !s.empty();
+}
+
+inline int master_seek(FILE* f, long long off) {
+#ifdef _WIN32
+    return _fseeki64(f, off, SEEK_SET);
+#else
+    return fseeko(f, (off_t)off, SEEK_SET);
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// MasterBloom
+// ---------------------------------------------------------------------------
+// MASTER_BLOOM_HASHES bit positions per ID from one 64-bit hash (FNV-1a,
+// mixed), by double hashing: h1 + i * h2.
+// ---------------------------------------------------------------------------
+struct MasterBloom {
+    vector<uint64_t> words;
+
+    void init(size_t keys) {
+        size_t bits = max<size_t>(64, keys * MASTER_BLOOM_BITS);
+        words.assign((bits + 63) / 64, 0);
+    }
+
+    static uint64_t hash(const string& key) {
+        uint64_t h = 1469598103934665603ull;
+        for (unsigned char c : key) h = (h ^ c) * 1099511628211ull;
+        h ^= h >> 33;                        // spread the low bits upwards
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    void add(const string& key) {
+        uint64_t h = hash(key), h2 = (h >> 32) | 1, m = words.size() * 64;
+        for (int i = 0; i < MASTER_BLOOM_HASHES; ++i, h += h2)
+            words[(h % m) >> 6] |= 1ull << ((h % m) & 63);
+    }
+
+    bool mayContain(const string& key) const {
+        uint64_t h = hash(key), h2 = (h >> 32) | 1, m = words.size() * 64;
+        for (int i = 0; i < MASTER_BLOOM_HASHES; ++i, h += h2)
+            if (!(words[(h % m) >> 6] & (1ull << ((h % m) & 63)))) return false;
+        return true;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// MasterRun
+// ---------------------------------------------------------------------------
+// One immutable sorted run: the .dat file (one line per ID, sorted), and in
+// memory its filter and sparse index, also saved in the .idx file:
+//   MASTERIDX <entries> <data bytes> <filter words>
+//   <filter words, raw>
+//   <offset> TAB <escaped first ID of the block>     (one line per block)
+// A run replaced by a merge is marked obsolete and its files are deleted
+// when the last lookup still using it lets go of it.
+// ---------------------------------------------------------------------------
+enum MasterProbe { MASTER_FILTERED, MASTER_ABSENT, MASTER_FOUND };
+
+struct MasterRun {
+    unsigned long long id = 0;
+    size_t entries = 0;
+    long long dataBytes = 0;
+    MasterBloom bloom;
+    vector<string> keys;       // first ID of every block
+    vector<long long> offs;    // and the block's offset in the .dat file
+    string dataPath, idxPath;
+    FILE* f = nullptr;         // .dat, for lookups (under m)
+    mutex m;
+    bool obsolete = false;
+
+    ~MasterRun() {
+        if (f) fclose(f);
+        if (obsolete) {
+            remove(dataPath.c_str());
+            remove(idxPath.c_str());
+        }
+    }
+
+    size_t memBytes() const {
+        size_t b = sizeof(*this) + mem_vector(bloom.words) + mem_vector(offs) + mem_vector(keys);
+        for (const string& k : keys) b += mem_string(k);
+        return b;
+    }
+
+    bool openData() {
+        f = fopen(dataPath.c_str(), "rb");
+        return f != nullptr;
+    }
+
+    // Read the filter and the sparse index from the .idx file
+    bool load() {
+        FILE* in = fopen(idxPath.c_str(), "rb");
+        if (!in) return false;
+        string s;
+        size_t words = 0;
+        bool ok = master_getline(in, s) &&
+                  sscanf(s.c_str(), "MASTERIDX %zu %lld %zu", &entries, &dataBytes, &words) == 3;
+        if (ok) {
+            bloom.words.resize(words);
+            ok = fread(bloom.words.data(), sizeof(uint64_t), words, in) == words && words > 0;
+        }
+        vector<string> fld;
+        while (ok && master_getline(in, s)) {
+            const char* tab = strchr(s.c_str(), '\t');
+            if (!tab) { ok = false; break; }
+            offs.push_back(strtoll(s.c_str(), nullptr, 10));
+            size_t n = cdc_fields(tab + 1, s.c_str() + s.size(), fld);
+            keys.push_back(n ? fld[0] : string());
+        }
+        fclose(in);
+        return ok && openData();
+    }
+
+    // ----------------------------------------------------------------------
+    // find()
+    // ----------------------------------------------------------------------
+    // Purpose : Look up one ID: the filter first, then the one block that
+    //           can hold it (binary search of the sparse index, one read).
+    // ----------------------------------------------------------------------
+    MasterProbe find(const string& key, MasterRecord& out) {
+        if (!bloom.mayContain(key)) return MASTER_FILTERED;
+        size_t b = upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+        if (b == 0) return MASTER_ABSENT;            // before the first ID
+        b--;
+        long long from = offs[b], to = b + 1 < offs.size() ? offs[b + 1] : dataBytes;
+        vector<char> buf((size_t)(to - from));
+        {
+            lock_guard<mutex> lock(m);
+            if (master_seek(f, from) != 0 ||
+                fread(buf.data(), 1, buf.size(), f) != buf.size()) return MASTER_ABSENT;
+        }
+        vector<string> fld;
+        string id;
+        const char* p = buf.data();
+        const char* end = p + buf.size();
+        while (p < end) {
+            const char* eol = (const char*)memchr(p, '\n', end - p);
+            if (!eol) eol = end;
+            MasterRecord r;
+            if (master_parse(p, eol, fld, id, r)) {
+                if (id == key) {
+                    out = r;
+                    return MASTER_FOUND;
+                }
+                if (key < id) break;                  // sorted: not here
+            }
+            p = eol + 1;
+        }
+        return MASTER_ABSENT;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// MasterRunWriter
+// ---------------------------------------------------------------------------
+// Writes a run from IDs given in ascending order (flush or merge) and
+// builds its filter and sparse index on the way.
+// ---------------------------------------------------------------------------
+struct MasterRunWriter {
+    shared_ptr<MasterRun> run = make_shared<MasterRun>();
+    FILE* out = nullptr;
+
+    bool open(unsigned long long id, const string& dataPath, const string& idxPath,
+              size_t expected) {
+        run->id = id;
+        run->dataPath = dataPath;
+        run->idxPath = idxPath;
+        run->bloom.init(expected);
+        out = fopen(dataPath.c_str(), "wb");
+        return out != nullptr;
+    }
+
+    void add(const string& key, const string& line) {
+        if (run->entries % MASTER_BLOCK == 0) {
+            run->keys.push_back(key);
+            run->offs.push_back(run->dataBytes);
+        }
+        run->bloom.add(key);
+        fwrite(line.data(), 1, line.size(), out);
+        run->dataBytes += (long long)line.size();
+        run->entries++;
+    }
+
+    // Close the .dat file and write the .idx file; nullptr on error
+    shared_ptr<MasterRun> finish() {
+        bool ok = fflush(out) == 0 && !ferror(out);
+        fclose(out);
+        out = nullptr;
+        FILE* idx = ok ? fopen(run->idxPath.c_str(), "wb") : nullptr;
+        if (idx) {
+            fprintf(idx, "MASTERIDX %zu %lld %zu\n", run->entries, run->dataBytes,
+                    run->bloom.words.size());
+            fwrite(run->bloom.words.data(), sizeof(uint64_t), run->bloom.words.size(), idx);
+            string line;
+            for (size_t i = 0; i < run->keys.size(); ++i) {
+                line = to_string(run->offs[i]) + '\t';
+                cdc_escape(line, run->keys[i]);
+                line += '\n';
+                fwrite(line.data(), 1, line.size(), idx);
+            }
+            ok = fflush(idx) == 0 && !ferror(idx);
+            fclose(idx);
+        }
+        if (!idx || !ok || !run->openData()) {
+            abandon();
+            return nullptr;
+        }
+        return run;
+    }
+
+    void abandon() {
+        if (out) fclose(out);
+        out = nullptr;
+        remove(run->dataPath.c_str());
+        remove(run->idxPath.c_str());
+    }
+};
+
+// The memtable: changes since the last flush, and the logs that hold them
+struct MasterMemtable {
+    map<string, MasterRecord> rows;
+    size_t bytes = sizeof(MasterMemtable);   // approximate, for accounting
+    vector<string> wals;
+
+    void put(const string& id, const MasterRecord& r) {
+        auto ins = rows.insert(make_pair(id, r));
+        if (ins.second) {
+            bytes += 64 + mem_string(ins.first->first);   // map node
+        } else {
+            const MasterRecord& o = ins.first->second;
+            bytes -= mem_string(o.name) + mem_string(o.condition) + mem_string(o.status);
+            ins.first->second = r;
+        }
+        bytes += mem_string(r.name) + mem_string(r.condition) + mem_string(r.status);
+    }
+};
+
+// What a lookup found and what it cost
+struct MasterLookup {
+    bool found = false;
+    const char* where = "";    // "memtable", "frozen memtable" or "run"
+    unsigned long long run = 0;
+    int runsRead = 0;          // runs whose block was read
+    int runsFiltered = 0;      // runs skipped by their filter
+    double us = 0;
+};
+
+// ---------------------------------------------------------------------------
+// MasterIndex
+// ---------------------------------------------------------------------------
+// Shared under m: active, frozen, runs and the counters. The WAL file is
+// only written by the thread calling put() (the menu thread); the run files
+// are only written and merged by the worker.
+// ---------------------------------------------------------------------------
+struct MasterIndex {
+    string dir;                                  // "" = working directory
+    mutex m;
+    condition_variable wake;
+    shared_ptr<MasterMemtable> active;
+    deque<shared_ptr<MasterMemtable> > frozen;   // oldest first
+    vector<shared_ptr<MasterRun> > runs;         // oldest first
+    bool opened = false;
+    bool stop   = false;
+    bool busy   = false;                         // flush or merge running
+    size_t stuck = 0;                            // frozen tables a failed flush left
+    string error;                                // last flush/merge error
+    long long flushes = 0, merges = 0, mergedRecords = 0;
+    double mergeMs = 0;
+    unsigned long long nextFile = 1;             // number of the next WAL / run
+    FILE* wal = nullptr;
+    thread worker;
+    // Worker only: files the saved manifest may still need, removed once a
+    // manifest without them is saved (see commitManifest())
+    vector<string> unsavedWals;                  // logs of flushed memtables
+    vector<shared_ptr<MasterRun> > unsavedInputs;   // runs replaced by merges
+
+    ~MasterIndex() { close(); }
+
+    string path(const char* kind, unsigned long long n, const char* ext) const {
+        char buf[64];
+        snprintf(buf, sizeof buf, "master_%s_%012llu.%s", kind, n, ext);
+        return (filesystem::path(dir) / buf).string();
+    }
+
+    unsigned long long newFileNumber() {
+        lock_guard<mutex> lock(m);
+        return nextFile++;
+    }
+
+    // Start a new WAL file; the caller adds it to its memtable
+    bool openWal(string& name) {
+        name = path("wal", newFileNumber(), "log");
+        FILE* w = fopen(name.c_str(), "ab");
+        if (!w) return false;
+        if (wal) fclose(wal);
+        wal = w;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------
+    // open()
+    // ----------------------------------------------------------------------
+    // Purpose : Load the runs of the manifest, replay the logs of memtables
+    //           that were not written yet (they become one frozen memtable,
+    //           written by the worker), and start the worker.
+    // Note    : Run files missing from the manifest are left over from an
+    //           interrupted flush or merge and are deleted.
+    // ----------------------------------------------------------------------
+    bool open(const string& directory = "") {
+        if (opened) return true;
+        dir = directory;
+        stop = false;
+        error.clear();
+        vector<unsigned long long> listed;
+        {
+            ifstream man((filesystem::path(dir) / MASTER_MANIFEST).string());
+            unsigned long long n;
+            while (man >> n) listed.push_back(n);
+        }
+        vector<pair<unsigned long long, string> > wals;
+        error_code ec;
+        for (const auto& e : filesystem::directory_iterator(dir.empty() ? "." : dir, ec)) {
+            string name = e.path().filename().string();
+            unsigned long long n;
+            char ext[8];
+            if (sscanf(name.c_str(), "master_wal_%llu.%3s", &n, ext) == 2) {
+                wals.push_back(make_pair(n, e.path().string()));
+            } else if (sscanf(name.c_str(), "master_run_%llu.%3s", &n, ext) == 2) {
+                if (find(listed.begin(), listed.end(), n) == listed.end())
+                    filesystem::remove(e.path(), ec);
+            } else {
+                continue;
+            }
+            nextFile = max(nextFile, n + 1);
+        }
+        for (unsigned long long n : listed) {
+            auto r = make_shared<MasterRun>();
+            r->id = n;
+            r->dataPath = path("run", n, "dat");
+            r->idxPath = path("run", n, "idx");
+            if (!r->load()) {
+                load_log() << "[Error] Cannot read patient master index run "
+                           << r->dataPath << ". Its records are not available.\n";
+                continue;
+            }
+            runs.push_back(r);
+            nextFile = max(nextFile, n + 1);
+        }
+
+        sort(wals.begin(), wals.end());
+        auto replay = make_shared<MasterMemtable>();
+        vector<string> fld;
+        string line, id;
+        long long replayed = 0;
+        for (const auto& w : wals) {
+            FILE* in = fopen(w.second.c_str(), "rb");
+            if (!in) continue;
+            MasterRecord r;
+            while (master_getline(in, line))
+                if (master_parse(line.c_str(), line.c_str() + line.size(), fld, id, r)) {
+                    replay->put(id, r);
+                    replayed++;
+                }
+            fclose(in);
+            replay->wals.push_back(w.second);
+        }
+        if (!replay->rows.empty()) frozen.push_back(replay);
+        else for (const string& w : replay->wals) remove(w.c_str());
+
+        active = make_shared<MasterMemtable>();
+        string name;
+        if (!openWal(name)) {
+            load_log() << "[Error] Cannot create " << name
+                       << ". Patient master index changes will not be kept.\n";
+        } else {
+            active->wals.push_back(name);
+        }
+        opened = true;
+        worker = thread([this] { run(); });
+        size_t total = replay->rows.size();
+        for (const auto& r : runs) total += r->entries;
+        load_log() << "[OK] Patient master index: " << runs.size() << " run(s), about "
+                   << total << " record(s)";
+        if (replayed > 0) load_log() << ", " << replayed << " change(s) replayed from the log";
+        load_log() << "\n";
+        return true;
+    }
+
+    // Stop the worker (a merge in progress is abandoned; a flush finishes)
+    void close() {
+        if (!opened) return;
+        {
+            lock_guard<mutex> lock(m);
+            stop = true;
+        }
+        wake.notify_one();
+        if (worker.joinable()) worker.join();
+        if (wal) fclose(wal);
+        wal = nullptr;
+        active.reset();
+        frozen.clear();
+        runs.clear();
+        unsavedWals.clear();        // still listed by the saved manifest:
+        unsavedInputs.clear();      // kept on disk
+        opened = false;
+    }
+
+    // ----------------------------------------------------------------------
+    // put()
+    // ----------------------------------------------------------------------
+    // Purpose : Record the latest state of one patient: one log line, then
+    //           the memtable. A full memtable is handed to the worker and a
+    //           new one (with a new log) starts; nothing waits for a flush.
+    // ----------------------------------------------------------------------
+    void put(const string& id, const MasterRecord& r) {
+        if (!opened) return;
+        if (wal) {
+            string line = master_line(id, r);
+            if (fwrite(line.data(), 1, line.size(), wal) != line.size() || fflush(wal) != 0)
+                cout << "[Error] Cannot write the patient master index log.\n";
+        }
+        bool full;
+        {
+            lock_guard<mutex> lock(m);
+            active->put(id, r);
+            full = active->rows.size() >= MASTER_MEMTABLE;
+        }
+        if (!full) return;
+        string name;
+        bool logged = openWal(name);   // new log first, then switch tables
+        auto next = make_shared<MasterMemtable>();
+        if (logged) next->wals.push_back(name);
+        {
+            lock_guard<mutex> lock(m);
+            frozen.push_back(active);
+            active = next;
+        }
+        wake.notify_one();
+    }
+
+    // ----------------------------------------------------------------------
+    // get()
+    // ----------------------------------------------------------------------
+    // Purpose : Latest record of an ID: memtables newest first, then the
+    //           runs newest first (filter, then one block read).
+    // ----------------------------------------------------------------------
+    bool get(const string& id, MasterRecord& out, MasterLookup* info = nullptr) {
+        auto t0 = chrono::steady_clock::now();
+        MasterLookup l;
+        vector<shared_ptr<MasterRun> > snap;
+        {
+            lock_guard<mutex> lock(m);
+            if (active) {
+                auto it = active->rows.find(id);
+                if (it != active->rows.end()) {
+                    out = it->second;
+                    l.found = true;
+                    l.where = "memtable";
+                }
+            }
+            for (size_t i = frozen.size(); !l.found && i-- > 0;) {
+                auto it = frozen[i]->rows.find(id);
+                if (it != frozen[i]->rows.end()) {
+                    out = it->second;
+                    l.found = true;
+                    l.where = "frozen memtable";
+                }
+            }
+            if (!l.found) snap = runs;
+        }
+        for (size_t i = snap.size(); !l.found && i-- > 0;) {
+            MasterProbe p = snap[i]->find(id, out);
+            if (p == MASTER_FILTERED) { l.runsFiltered++; continue; }
+            l.runsRead++;
+            if (p == MASTER_FOUND) {
+                l.found = true;
+                l.where = "run";
+                l.run = snap[i]->id;
+            }
+        }
+        l.us = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+        if (info) *info = l;
+        return l.found;
+    }
+
+    // Wait until every frozen memtable is written and no merge is due
+    void waitIdle() {
+        while (true) {
+            {
+                lock_guard<mutex> lock(m);
+                if (!opened || (frozen.size() <= stuck && !busy)) return;
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+
+    // Manifest: the run numbers, oldest first (replaced as a whole)
+    bool saveManifest() {
+        vector<unsigned long long> ids;
+        {
+            lock_guard<mutex> lock(m);
+            for (const auto& r : runs) ids.push_back(r->id);
+        }
+        string final = (filesystem::path(dir) / MASTER_MANIFEST).string();
+        string tmp = final + ".tmp";
+        {
+            ofstream out(tmp, ios::trunc);
+            for (unsigned long long n : ids) out << n << '\n';
+            out.close();
+            if (!out) return false;
+        }
+        error_code ec;
+        filesystem::rename(tmp, final, ec);
+        return !ec;
+    }
+
+    // ----------------------------------------------------------------------
+    // commitManifest()
+    // ----------------------------------------------------------------------
+    // Purpose : Save the manifest, then remove what it no longer needs: the
+    //           logs of flushed memtables and the runs replaced by merges.
+    // Note    : If the save fails they are all kept, since the manifest on
+    //           disk still lists the old runs (and not the new one, which
+    //           the next open() deletes, replaying the logs instead). They
+    //           are removed after the next save that succeeds.
+    // ----------------------------------------------------------------------
+    bool commitManifest() {
+        if (!saveManifest()) {
+            setError("Cannot save " MASTER_MANIFEST " (logs and replaced runs are kept).");
+            return false;
+        }
+        for (const string& w : unsavedWals) remove(w.c_str());
+        for (auto& r : unsavedInputs) r->obsolete = true;   // files go with the last user
+        unsavedWals.clear();
+        unsavedInputs.clear();
+        return true;
+    }
+
+    // Write one frozen memtable as a new run
+    shared_ptr<MasterRun> flush(const MasterMemtable& t) {
+        unsigned long long n = newFileNumber();
+        MasterRunWriter w;
+        if (!w.open(n, path("run", n, "dat"), path("run", n, "idx"), t.rows.size())) {
+            w.abandon();
+            return nullptr;
+        }
+        for (const auto& kv : t.rows) w.add(kv.first, master_line(kv.first, kv.second));
+        return w.finish();
+    }
+
+    // Size tier of a run: 0 up to MASTER_FANOUT memtables, then x FANOUT
+    static int tier(size_t entries) {
+        int t = 0;
+        for (size_t cap = MASTER_MEMTABLE * MASTER_FANOUT; entries >= cap; cap *= MASTER_FANOUT) t++;
+        return t;
+    }
+
+    // Runs at the new end of tier <= the newest one's; merged when FANOUT
+    size_t mergeCandidates() {
+        lock_guard<mutex> lock(m);
+        if (runs.empty()) return 0;
+        int t = tier(runs.back()->entries);
+        size_t k = 0;
+        while (k < runs.size() && tier(runs[runs.size() - 1 - k]->entries) <= t) k++;
+        return k >= (size_t)MASTER_FANOUT ? k : 0;
+    }
+
+    // ----------------------------------------------------------------------
+    // merge()
+    // ----------------------------------------------------------------------
+    // Purpose : Merge the newest k runs into one, streaming their files in
+    //           ID order; for an ID in several runs the newest line wins.
+    //           The result replaces the k runs at the same place in the
+    //           list (only the worker changes the list, so it is intact).
+    // ----------------------------------------------------------------------
+    bool merge(size_t k) {
+        vector<shared_ptr<MasterRun> > in;
+        {
+            lock_guard<mutex> lock(m);
+            in.assign(runs.end() - k, runs.end());
+        }
+        auto t0 = chrono::steady_clock::now();
+        struct Reader {
+            FILE* f = nullptr;
+            string line, id;
+            vector<string> fld;
+            bool more = false;
+            void next() {
+                more = f && master_getline(f, line);
+                if (more) id = cdc_fields(line.c_str(), line.c_str() + line.size(), fld)
+                               ? fld[0] : string();
+            }
+        };
+        vector<Reader> rd(k);
+        size_t expected = 0;
+        bool readable = true;
+        for (size_t i = 0; i < k; ++i) {
+            rd[i].f = fopen(in[i]->dataPath.c_str(), "rb");
+            readable = readable && rd[i].f;
+            rd[i].next();
+            expected += in[i]->entries;
+        }
+        unsigned long long n = newFileNumber();
+        MasterRunWriter w;
+        bool ok = readable &&
+                  w.open(n, path("run", n, "dat"), path("run", n, "idx"), expected);
+        if (!ok) setError("Cannot merge patient master index runs.");
+        long long count = 0;
+        while (ok) {
+            int win = -1;                          // smallest ID; newest on ties
+            for (size_t i = 0; i < k; ++i)
+                if (rd[i].more && (win < 0 || rd[i].id <= rd[win].id)) win = (int)i;
+            if (win < 0) break;
+            string id = rd[win].id;
+            w.add(id, rd[win].line + '\n');
+            for (size_t i = 0; i < k; ++i)
+                while (rd[i].more && rd[i].id == id) rd[i].next();
+            if (++count % 4096 == 0) {
+                lock_guard<mutex> lock(m);
+                if (stop) ok = false;              // shutting down: give up
+            }
+        }
+        for (Reader& r : rd) if (r.f) fclose(r.f);
+        shared_ptr<MasterRun> out = ok ? w.finish() : nullptr;
+        if (!out) {
+            if (ok) setError("Cannot write a merged patient master index run.");
+            else w.abandon();                      // finish() cleans up itself
+            return false;
+        }
+        {
+            lock_guard<mutex> lock(m);
+            runs.erase(runs.end() - k, runs.end());
+            runs.push_back(out);
+            merges++;
+            mergedRecords += count;
+            mergeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        }
+        unsavedInputs.insert(unsavedInputs.end(), in.begin(), in.end());
+        commitManifest();
+        return true;
+    }
+
+    void setError(const string& e) {
+        lock_guard<mutex> lock(m);
+        error = e;
+    }
+
+    // The worker: write frozen memtables, oldest first, then merge
+    void run() {
+        unique_lock<mutex> lock(m);
+        while (true) {
+            wake.wait(lock, [&] { return stop || frozen.size() > stuck; });
+            if (stop) break;
+            shared_ptr<MasterMemtable> t = frozen.front();
+            busy = true;
+            lock.unlock();
+            shared_ptr<MasterRun> r = flush(*t);
+            lock.lock();
+            if (!r) {
+                stuck = frozen.size();             // retry at the next freeze
+                error = "Cannot write a patient master index run (changes stay in the log).";
+                busy = false;
+                continue;
+            }
+            runs.push_back(r);
+            frozen.pop_front();
+            stuck = 0;
+            flushes++;
+            lock.unlock();
+            unsavedWals.insert(unsavedWals.end(), t->wals.begin(), t->wals.end());
+            commitManifest();                      // then the logs go (now in the run)
+            size_t k;
+            while ((k = mergeCandidates()) > 0) {
+                {
+                    lock_guard<mutex> g(m);
+                    if (stop || !frozen.empty()) break;   // flushes go first
+                }
+                if (!merge(k)) break;
+            }
+            lock.lock();
+            busy = false;
+        }
+    }
+};
+
+// The index of this process (C++17 inline variable)
+inline MasterIndex gMaster;
+
+inline MemRegister gMasterMem(MEM_PATIENTS, "master index (memtables, filters)", [] {
+    lock_guard<mutex> lock(gMaster.m);
+    size_t b = sizeof(gMaster);
+    if (gMaster.active) b += gMaster.active->bytes;
+    for (const auto& t : gMaster.frozen) b += t->bytes;
+    for (const auto& r : gMaster.runs) b += r->memBytes();
+    return b;
+});
+
+// Called at the admission, discharge and escalation sites (patient.hpp,
+// emergency.hpp)
+inline void master_record(const string& id, const string& name,
+                          const string& cond, const char* status) {
+    MasterRecord r;
+    r.name = name;
+    r.condition = cond;
+    r.status = status;
+    r.updated = (long long)time(nullptr);
+    gMaster.put(id, r);
+}
+
+// ---------------------------------------------------------------------------
+// ui_master_lookup()
+// ---------------------------------------------------------------------------
+// Purpose : Look up any patient ID ever seen and show where the record was
+//           found and how long the lookup took.
+// ---------------------------------------------------------------------------
+inline void ui_master_lookup() {
+    string id;
+    cout << "Patient ID to look up: ";
+    safe_getline(id);
+    MasterRecord r;
+    MasterLookup l;
+    if (!gMaster.get(id, r, &l)) {
+        cout << "No patient with ID " << id << " has been seen.\n";
+    } else {
+        time_t t = (time_t)r.updated;
+        char when[32] = "?";
+        if (tm* lt = localtime(&t)) strftime(when, sizeof when, "%Y-%m-%d %H:%M", lt);
+        cout << "[" << id << "] " << r.name << " (" << r.condition << "), "
+             << r.status << " since " << when << "\n";
+    }
+    cout << fixed << setprecision(1) << "(" << l.us << " us; ";
+    if (l.found) {
+        cout << "found in the " << l.where;
+        if (l.run) cout << " " << l.run;
+        cout << "; ";
+    }
+    cout << l.runsRead << " run(s) read, " << l.runsFiltered
+         << " skipped by their filter)\n";
+    cout.unsetf(ios::floatfield);
+}
+
+// Memtables, runs and the background work so far
+inline void print_master() {
+    lock_guard<mutex> lock(gMaster.m);
+    line('=');
+    cout << "PATIENT MASTER INDEX\n";
+    line('=');
+    cout << "Memtable        : " << (gMaster.active ? gMaster.active->rows.size() : 0)
+         << " of " << MASTER_MEMTABLE << " record(s)\n";
+    cout << "Waiting to write: " << gMaster.frozen.size() << " frozen memtable(s)\n";
+    cout << left << setw(14) << "Run" << setw(14) << "Records"
+         << setw(14) << "Data KB" << "Memory KB (filter + index)\n";
+    line();
+    for (const auto& r : gMaster.runs)
+        cout << left << setw(14) << r->id << setw(14) << r->entries
+             << setw(14) << r->dataBytes / 1024 << r->memBytes() / 1024 << "\n";
+    if (gMaster.runs.empty()) cout << "(no runs yet)\n";
+    line();
+    cout << "Flushes: " << gMaster.flushes << ", merges: " << gMaster.merges
+         << " (" << gMaster.mergedRecords << " record(s) written";
+    if (gMaster.merges) cout << ", last " << fixed << setprecision(0) << gMaster.mergeMs << " ms";
+    cout << ")\n";
+    cout.unsetf(ios::floatfield);
+    if (!gMaster.error.empty()) cout << "[Error] " << gMaster.error << "\n";
+}
+
+// Opened with the clerk role of the interactive program (load_patient_role()
+// in patient.hpp) and stopped before exit
+inline void master_open()   { gMaster.open(); }
+inline void master_finish() { gMaster.close(); }
+
+#endif
@@ -0,0 +1,362 @@
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+#include "utils.hpp"
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// memory.hpp
+// ---------------------------------------------------------------------------
+// Memory accounting and per-role memory limits.
+//
+// Every container registers what it holds as one or more components (a
+// name and a function returning its bytes), next to its global instance.
+// The bytes are what the container has allocated: its fixed arrays, the
+// capacity of its vectors and string pools, and the buckets and nodes of
+// its hash maps and lists (node layouts as in libstdc++, see mem_hash()).
+// Heap blocks are counted at their requested size, without the malloc
+// header, so the process RSS is somewhat higher.
+//
+// Limits apply to the four roles. They are kept in MEM_LIMITS_FILE, one
+//   <role> <bytes> <reject|compact|spill>
+// line per limited role, and set from the main menu. When a role is at or
+// above its limit, a NEW record is handled by the role's policy:
+//   reject  : refused with an error message, nothing changes.
+//   compact : the role's compaction hooks run first (string pools rebuilt,
+//             free lists and caches released); refused if still at the limit.
+//   spill   : as compact, then the record waits in a file instead of in
+//             memory. Only the patient queue can spill (see patient.hpp):
+//             it is FIFO, so its newest arrivals can wait on disk and are
+//             read back in order as patients leave.
+// Records read from the role files at start-up are never dropped, so a role
+// can start above its limit; it then takes no new records until it is back
+// under it.
+//
+// Checking a limit does not add up the components on every new record
+// (some of them walk their container, O(n)). The role's total is counted
+// once and then estimated as that count plus the records let in since,
+// each at the average growth per record seen at the last count. The exact
+// count is taken again once the estimate has used half of the room that
+// was left below the limit at the last count, and after compaction: few
+// counts while the role is far from its limit, one per record right at
+// it, so a record is only refused or spilled on an exact count.
+// ---------------------------------------------------------------------------
+
+#define MEM_LIMITS_FILE "memlimits.txt"
+
+enum MemRole { MEM_PATIENTS, MEM_SUPPLIES, MEM_EMERGENCIES, MEM_AMBULANCES,
+               MEM_SHARED,          // indexes, logs and buffers of several roles
+               MEM_ROLES };
+const int MEM_LIMITED = MEM_SHARED; // roles [0, MEM_LIMITED) take a limit
+
+enum MemPolicy { MEM_REJECT, MEM_COMPACT, MEM_SPILL, MEM_POLICIES };
+
+const int MEM_RATE_SAMPLE    = 16;   // records counted before a growth rate is known
+const int MEM_RECORD_MIN_EST = 64;   // bytes per record, at least
+
+// Result of mem_admit()
+enum MemAdmit { MEM_ADMIT, MEM_ADMIT_SPILL, MEM_ADMIT_REJECT };
+
+inline const char* mem_role_name(int r) {
+    static const char* names[] = { "patients", "supplies", "emergencies",
+                                   "ambulances", "shared" };
+    return (r >= 0 && r < MEM_ROLES) ? names[r] : "?";
+}
+
+inline const char* mem_policy_name(int p) {
+    static const char* names[] = { "reject", "compact", "spill" };
+    return (p >= 0 && p < MEM_POLICIES) ? names[p] : "?";
+}
+
+// Only the patient queue has somewhere to spill to (see the top of file)
+inline bool mem_can_spill(int r) { return r == MEM_PATIENTS; }
+
+// ---------------------------------------------------------------------------
+// Bytes of standard library containers
+// ---------------------------------------------------------------------------
+// Heap bytes of a string (short strings are stored inside the object)
+inline size_t mem_string(const string& s) {
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
+template <class T>
+size_t mem_vector(const vector<T>& v) { return v.capacity() * sizeof(T); }
+
+// Bucket array plus one node per element (next pointer, the element, the
+// cached hash). Heap bytes owned by the elements are not included.
+template <class M>
+size_t mem_hash(const M& m) {
+    return m.bucket_count() * sizeof(void*)
+         + m.size() * (sizeof(void*) + sizeof(typename M::value_type) + sizeof(size_t));
+}
+
+// One node per element of a std::list (two pointers and the element)
+template <class L>
+size_t mem_list(const L& l) {
+    return l.size() * (2 * sizeof(void*) + sizeof(typename L::value_type));
+}
+
+// ---------------------------------------------------------------------------
+// Registry
+// ---------------------------------------------------------------------------
+struct MemComponent {
+    MemRole role;
+    const char* name;
+    size_t (*bytes)();
+};
+
+struct MemAccounts {
+    vector<MemComponent> parts;
+    vector<void (*)()> compact[MEM_ROLES];   // compaction hooks per role
+    long long limit[MEM_ROLES] = {};         // bytes, 0 = no limit
+    MemPolicy policy[MEM_ROLES] = {};
+    bool limitsRead = false;
+    long long compactions[MEM_ROLES] = {};   // since start-up
+    long long rejected[MEM_ROLES] = {};
+    long long spilled[MEM_ROLES] = {};       // counted by the role's spill code
+    // Cached totals for the limit checks (see the top of this file)
+    long long counted[MEM_ROLES] = {};       // bytes at the last exact count
+    long long perRecord[MEM_ROLES] = {};     // estimated growth per record, 0 = not known yet
+    int       sinceCount[MEM_ROLES] = {};    // records let in since then
+    bool      hasCount[MEM_ROLES] = {};
+};
+
+// All accounts of this process (C++17 inline variable). Defined before the
+// containers' headers register with it, so it is constructed first.
+inline MemAccounts gMem;
+
+// Registers a component (or a compaction hook) when its global is built:
+//   inline MemRegister gXxxMem(MEM_ROLE, "name", [] { return ...; });
+//   inline MemRegister gXxxCompact(MEM_ROLE, [] { ... });
+struct MemRegister {
+    MemRegister(MemRole r, const char* name, size_t (*bytes)()) {
+        gMem.parts.push_back(MemComponent{ r, name, bytes });
+    }
+    MemRegister(MemRole r, void (*hook)()) { gMem.compact[r].push_back(hook); }
+};
+
+inline size_t mem_role_bytes(int r) {
+    size_t total = 0;
+    for (const MemComponent& c : gMem.parts)
+        if (c.role == r) total += c.bytes();
+    return total;
+}
+
+inline void mem_load_limits() {
+    gMem.limitsRead = true;
+    ifstream in(MEM_LIMITS_FILE);
+    string role, policy;
+    long long bytes;
+    while (in >> role >> bytes >> policy) {
+        int r = 0, p = 0;
+        while (r < MEM_LIMITED && role != mem_role_name(r)) ++r;
+        while (p < MEM_POLICIES && policy != mem_policy_name(p)) ++p;
+        if (r == MEM_LIMITED || p == MEM_POLICIES || bytes < 0) {
+            cout << "[Error] " << MEM_LIMITS_FILE << ": bad line \"" << role
+                 << ' ' << bytes << ' ' << policy << "\", ignored.\n";
+            continue;
+        }
+        if (p == MEM_SPILL && !mem_can_spill(r)) p = MEM_COMPACT;
+        gMem.limit[r]  = bytes;
+        gMem.policy[r] = (MemPolicy)p;
+    }
+}
+
+inline void mem_save_limits() {
+    ofstream out(MEM_LIMITS_FILE);
+    if (!out) {
+        cout << "[Error] Cannot open " << MEM_LIMITS_FILE << " for writing.\n";
+        return;
+    }
+    for (int r = 0; r < MEM_LIMITED; ++r)
+        if (gMem.limit[r] > 0)
+            out << mem_role_name(r) << ' ' << gMem.limit[r] << ' '
+                << mem_policy_name(gMem.policy[r]) << '\n';
+}
+
+// Exact count of role r; learns the growth per record since the last one
+inline long long mem_recount(MemRole r) {
+    long long now = (long long)mem_role_bytes(r);
+    if (gMem.hasCount[r] && gMem.sinceCount[r] > 0)
+        gMem.perRecord[r] = max<long long>(MEM_RECORD_MIN_EST,
+                                           (now - gMem.counted[r]) / gMem.sinceCount[r]);
+    gMem.counted[r]    = now;
+    gMem.sinceCount[r] = 0;
+    gMem.hasCount[r]   = true;
+    return now;
+}
+
+// ---------------------------------------------------------------------------
+// mem_under_limit()
+// ---------------------------------------------------------------------------
+// Purpose : true if role r has room for one more record (or no limit). The
+//           caller is taken to add that record when it returns true.
+// Method  : O(1) from the cached total until the estimated growth since the
+//           last exact count reaches half the room that was left then (the
+//           first MEM_RATE_SAMPLE records measure the growth per record).
+// ---------------------------------------------------------------------------
+inline bool mem_under_limit(MemRole r) {
+    if (!gMem.limitsRead) mem_load_limits();
+    if (gMem.limit[r] <= 0) return true;
+    long long per = gMem.perRecord[r] > 0 ? gMem.perRecord[r] : MEM_RECORD_MIN_EST;
+    long long est = gMem.counted[r];
+    if (!gMem.hasCount[r] || est >= gMem.limit[r] ||
+        (gMem.perRecord[r] == 0 && gMem.sinceCount[r] >= MEM_RATE_SAMPLE) ||
+        (gMem.sinceCount[r] + 1LL) * per > (gMem.limit[r] - est) / 2)
+        est = mem_recount(r);
+    if (est >= gMem.limit[r]) return false;
+    gMem.sinceCount[r]++;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// mem_admit()
+// ---------------------------------------------------------------------------
+// Purpose : Called before a new record of role r is built: apply the role's
+//           policy if the role is at its limit.
+// Return  : MEM_ADMIT (keep it in memory), MEM_ADMIT_SPILL (only for roles
+//           that can spill) or MEM_ADMIT_REJECT.
+// Note    : Compaction invalidates records obtained from the container
+//           earlier, so the caller must not hold any.
+// ---------------------------------------------------------------------------
+inline MemAdmit mem_admit(MemRole r) {
+    if (mem_under_limit(r)) return MEM_ADMIT;
+    if (gMem.policy[r] != MEM_REJECT) {
+        for (void (*hook)() : gMem.compact[r]) hook();
+        gMem.compactions[r]++;
+        gMem.hasCount[r] = false;             // count again after compaction
+        if (mem_under_limit(r)) return MEM_ADMIT;
+    }
+    if (gMem.policy[r] == MEM_SPILL && mem_can_spill(r)) return MEM_ADMIT_SPILL;
+    gMem.rejected[r]++;
+    return MEM_ADMIT_REJECT;
+}
+
+// mem_admit() for roles that cannot spill: print why a record is refused
+inline bool mem_admit_or_report(MemRole r) {
+    if (mem_admit(r) == MEM_ADMIT) return true;
+    cout << "[Error] Memory limit of " << mem_role_name(r) << " reached ("
+         << mem_role_bytes(r) << " of " << gMem.limit[r] << " bytes). Not added.\n";
+    return false;
+}
+
+// ====================== UI FUNCTIONS ======================================
+
+// --------------------------------------------------------------------------
+// print_memory()
+// --------------------------------------------------------------------------
+// Purpose : Show the bytes of every component, the total per role with its
+//           limit and policy, and what the policies did since start-up.
+// --------------------------------------------------------------------------
+inline void print_memory() {
+    if (!gMem.limitsRead) mem_load_limits();
+    size_t all = 0;
+    line();
+    cout << left << setw(34) << "Role / component" << right << setw(12) << "Bytes"
+         << "  Limit\n";
+    line();
+    for (int r = 0; r < MEM_ROLES; ++r) {
+        size_t total = mem_role_bytes(r);
+        all += total;
+        cout << left << setw(34) << mem_role_name(r) << right << setw(12) << total;
+        if (r < MEM_LIMITED && gMem.limit[r] > 0) {
+            cout << "  " << gMem.limit[r] << " (" << mem_policy_name(gMem.policy[r])
+                 << ", " << fixed << setprecision(0)
+                 << 100.0 * total / gMem.limit[r] << "% used)";
+            cout.unsetf(ios::floatfield);
+        } else if (r < MEM_LIMITED) {
+            cout << "  none";
+        }
+        cout << "\n";
+        for (const MemComponent& c : gMem.parts)
+            if (c.role == r)
+                cout << "  " << left << setw(32) << c.name << right << setw(12)
+                     << c.bytes() << "\n";
+        if (gMem.compactions[r] || gMem.rejected[r] || gMem.spilled[r])
+            cout << "  (at limit: compacted " << gMem.compactions[r] << "x, rejected "
+                 << gMem.rejected[r] << ", spilled " << gMem.spilled[r] << ")\n";
+    }
+    line();
+    cout << left << setw(34) << "total" << right << setw(12) << all << "\n";
+    cout << left;
+}
+
+// --------------------------------------------------------------------------
+// ui_set_memory_limit()
+// --------------------------------------------------------------------------
+// Purpose : Ask for a role, a limit in bytes and a policy, and save the
+//           limits to MEM_LIMITS_FILE.
+// --------------------------------------------------------------------------
+inline void ui_set_memory_limit() {
+    if (!gMem.limitsRead) mem_load_limits();
+    int r, p = 0;
+    long long bytes;
+    cout << "Role (1 patients, 2 supplies, 3 emergencies, 4 ambulances): ";
+    if (!(cin >> r) || r < 1 || r > MEM_LIMITED) {
+        if (!cin.eof()) cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Invalid role.\n";
+        return;
+    }
+    cout << "Limit in bytes (0 = no limit): ";
+    if (!(cin >> bytes) || bytes < 0) {
+        if (!cin.eof()) cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Invalid limit.\n";
+        return;
+    }
+    r--;
+    if (bytes > 0) {
+        cout << "At the limit (1 reject, 2 compact"
+             << (mem_can_spill(r) ? ", 3 spill to disk" : "") << "): ";
+        if (!(cin >> p) || p < 1 || p > (mem_can_spill(r) ? 3 : 2)) {
+            if (!cin.eof()) cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "Invalid policy.\n";
+            return;
+        }
+        p--;
+    }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    gMem.limit[r]  = bytes;
+    gMem.policy[r] = (MemPolicy)p;
+    mem_save_limits();
+    cout << "Limit of " << mem_role_name(r) << ": ";
+    if (bytes > 0) cout << bytes << " bytes (" << mem_policy_name(p) << ").\n";
+    else           cout << "none.\n";
+}
+
+// --------------------------------------------------------------------------
+// menu_memory()
+// --------------------------------------------------------------------------
+// Options :
+//   1) View Memory Usage
+//   2) Set Role Limit
+//   0) Back
+// --------------------------------------------------------------------------
+inline void menu_memory() {
+    while (true) {
+        line('=');
+        cout << "MEMORY USAGE & LIMITS\n";
+        line('=');
+        cout << "1) View Memory Usage\n";
+        cout << "2) Set Role Limit\n";
+        cout << "0) Back\n> ";
+
+        int ch;
+        if (!(cin >> ch)) {
+            if (cin.eof()) return;
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            continue;
+        }
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+        if (ch == 0) break;
+        else if (ch == 1) print_memory();
+        else if (ch == 2) ui_set_memory_limit();
+        else cout << "Invalid choice.\n";
+    }
+}
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "utils.hpp"
+#include "events.hpp"   // event_clock_ns() (coarse monotonic clock)
+#include "memory.hpp"   // accounting
+#include <atomic>
+#include <cmath>        // for sqrt (EWMA deviation)
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// metrics.hpp
+// ---------------------------------------------------------------------------
+// Arrival rates per minute and surge alerts.
+//
+// Each series below counts events per minute in a ring of METRIC_MINUTES
+// atomic counters (one slot per minute, the slot of minute m is
+// m % METRIC_MINUTES). Counting is one atomic add on the current slot, done
+// by an event bus listener (events.hpp) when a change is published; the
+// containers are never scanned.
+//
+// Surge detection (EWMA deviation), per series:
+//   - when a minute is over, its count updates an exponentially weighted
+//     mean and variance (weight METRIC_ALPHA per minute; idle minutes count
+//     as 0);
+//   - from that, the alarm level for the NEXT minute is fixed:
+//       mean + METRIC_SIGMAS * deviation, but at least METRIC_MIN_SURGE
+//   - each count compares the running count of the current minute with the
+//     alarm level, so a surge is flagged by the event that crosses it,
+//     within the minute it starts in, not after the minute is over.
+// An alert is printed by report_surges() as soon as the change that raised
+// it is published (on the menu thread, from the bus listener below), and
+// the statistics view shows the last METRIC_SHOW minutes of every series.
+//
+// Single writer (the menu thread); the counters may be read from any thread.
+// ---------------------------------------------------------------------------
+
+const int    METRIC_MINUTES   = 64;    // minutes kept per series
+const int    METRIC_SHOW      = 10;    // minutes shown by print_metrics()
+const double METRIC_ALPHA     = 0.2;   // EWMA weight of the newest minute
+const double METRIC_SIGMAS    = 3.0;   // deviations above mean = surge
+const int    METRIC_MIN_SURGE = 5;     // never alert below this count/minute
+const int    METRIC_WARMUP    = 3;     // minutes of history before alerting
+const int    MAX_SURGE_ALERTS = 16;
+
+enum MetricId {
+    M_ADMISSIONS,       // patients admitted
+    M_EMERG_LOW,        // emergency cases, priority 0-3
+    M_EMERG_MID,        //                  priority 4-6
+    M_EMERG_HIGH,       //                  priority 7 and above
+    M_SUPPLY_USED,      // supply units used
+    METRIC_COUNT
+};
+
+inline const char* metric_name(int m) {
+    static const char* names[] = { "admissions", "emergencies P0-3",
+                                   "emergencies P4-6", "emergencies P7+",
+                                   "supply units used" };
+    return (m >= 0 && m < METRIC_COUNT) ? names[m] : "?";
+}
+
+// Current minute on the monotonic clock
+inline int64_t metric_minute() {
+    return event_clock_ns() / 60000000000LL;
+}
+
+// ---------------------------------------------------------------------------
+// MetricSeries
+// ---------------------------------------------------------------------------
+struct MetricSeries {
+    atomic<uint32_t> count[METRIC_MINUTES];
+    atomic<int64_t>  minuteOf[METRIC_MINUTES];   // minute the slot counts
+    int64_t current = -1;     // minute being counted (-1 = none yet)
+    int64_t first   = -1;     // first minute seen
+    double  mean = 0, var = 0;
+    uint32_t alarm = 0;       // surge level for the current minute
+    bool    alerted = false;  // alert already raised this minute
+
+    MetricSeries() {
+        for (int i = 0; i < METRIC_MINUTES; ++i) {
+            count[i].store(0, memory_order_relaxed);
+            minuteOf[i].store(-1, memory_order_relaxed);
+        }
+    }
+
+    // Fold the finished minutes up to (not including) `now` into the EWMA
+    // and start counting minute `now`
+    void roll(int64_t now) {
+        if (current >= 0) {
+            int64_t gap = now - current;
+            if (gap > METRIC_MINUTES) gap = METRIC_MINUTES;  // long idle
+            for (int64_t k = 0; k < gap; ++k) {
+                double x = (k == 0) ? count[current % METRIC_MINUTES].load(memory_order_relaxed) : 0;
+                double d = x - mean;
+                mean += METRIC_ALPHA * d;
+                var   = (1 - METRIC_ALPHA) * (var + METRIC_ALPHA * d * d);
+            }
+        } else {
+            first = now;
+        }
+        int s = (int)(now % METRIC_MINUTES);
+        count[s].store(0, memory_order_relaxed);
+        minuteOf[s].store(now, memory_order_release);
+        current = now;
+        alerted = false;
+        double level = mean + METRIC_SIGMAS * sqrt(var);
+        alarm = (uint32_t)max(ceil(level), (double)METRIC_MIN_SURGE);
+    }
+
+    // Count n events at minute `now`. Return true if this crosses the
+    // surge level of the minute (at most once per minute).
+    bool add(uint32_t n, int64_t now) {
+        if (now != current) roll(now);
+        uint32_t c = count[now % METRIC_MINUTES].fetch_add(n, memory_order_relaxed) + n;
+        if (c < alarm || alerted || now - first < METRIC_WARMUP) return false;
+        alerted = true;
+        return true;
+    }
+
+    // Count of minute m, 0 if it is not in the ring any more
+    uint32_t at(int64_t m) const {
+        int s = (int)(m % METRIC_MINUTES);
+        if (minuteOf[s].load(memory_order_acquire) != m) return 0;
+        return count[s].load(memory_order_relaxed);
+    }
+};
+
+struct SurgeAlert {
+    int64_t minute;
+    int metric;
+    uint32_t count;    // count when the alert was raised
+    double normal;     // EWMA mean per minute before the surge
+};
+
+struct Metrics {
+    MetricSeries series[METRIC_COUNT];
+    SurgeAlert alerts[MAX_SURGE_ALERTS];
+    int nalerts = 0;          // waiting to be printed
+    long long dropped = 0;    // alerts lost because the list was full
+};
+
+// All counters of this process (C++17 inline variable)
+inline Metrics gMetrics;
+
+inline MemRegister gMetricsMem(MEM_SHARED, "arrival counters",
+                               [] { return sizeof(gMetrics); });
+
+// ---------------------------------------------------------------------------
+// metric_count()
+// ---------------------------------------------------------------------------
+// Purpose : Count n events of metric m in the current minute and queue a
+//           surge alert if needed (called by the bus listener below).
+// ---------------------------------------------------------------------------
+inline void metric_count(MetricId m, uint32_t n = 1, int64_t now = metric_minute()) {
+    MetricSeries& s = gMetrics.series[m];
+    if (!s.add(n, now)) return;
+    if (gMetrics.nalerts == MAX_SURGE_ALERTS) {
+        gMetrics.dropped++;
+        return;
+    }
+    gMetrics.alerts[gMetrics.nalerts++] =
+        SurgeAlert{ now, m, s.at(now), s.mean };
+}
+
+// Emergency pushes are counted per priority band
+inline void metric_emergency(int priority) {
+    metric_count(priority >= 7 ? M_EMERG_HIGH :
+                 priority >= 4 ? M_EMERG_MID  : M_EMERG_LOW);
+}
+
+// ---------------------------------------------------------------------------
+// report_surges()
+// ---------------------------------------------------------------------------
+// Purpose : Print and clear the alerts raised since the last call.
+// ---------------------------------------------------------------------------
+inline void report_surges() {
+    for (int i = 0; i < gMetrics.nalerts; ++i) {
+        const SurgeAlert& a = gMetrics.alerts[i];
+        cout << "[Alert] Surge in " << metric_name(a.metric) << ": "
+             << a.count << " this minute (normal ~" << fixed
+             << setprecision(1) << a.normal << "/min)\n";
+        cout.unsetf(ios::floatfield);
+    }
+    if (gMetrics.dropped)
+        cout << "[Alert] " << gMetrics.dropped << " more surge alert(s) not shown.\n";
+    gMetrics.nalerts = 0;
+    gMetrics.dropped = 0;
+}
+
+// Admissions, new emergencies (value = priority) and supply use (value =
+// quantity). Transfers and journal replays are not new arrivals. A surge
+// is printed right away, under the output of the change that raised it.
+inline EventListen gMetricsListen([](const Event& ev, const string&, const string&) {
+    if (ev.flags & (EVF_TRANSFER | EVF_REPLAY)) return;
+    if (ev.role == EV_PATIENTS && ev.kind == EV_INSERT)
+        metric_count(M_ADMISSIONS);
+    else if (ev.role == EV_EMERGENCIES && ev.kind == EV_INSERT)
+        metric_emergency(ev.value);
+    else if (ev.role == EV_SUPPLIES && ev.kind == EV_REMOVE && ev.value > 0)
+        metric_count(M_SUPPLY_USED, (uint32_t)ev.value);
+    report_surges();
+});
+
+// ---------------------------------------------------------------------------
+// print_metrics()
+// ---------------------------------------------------------------------------
+// Purpose : Statistics view: per series, the counts of the last METRIC_SHOW
+//           minutes (newest first), the EWMA mean and the current alarm
+//           level.
+// ---------------------------------------------------------------------------
+inline void print_metrics() {
+    line('=');
+    cout << "ARRIVAL RATES (per minute, newest first)\n";
+    line('=');
+    int64_t now = metric_minute();
+    cout << left << setw(20) << "Series";
+    for (int k = 0; k < METRIC_SHOW; ++k)
+        cout << right << setw(5) << (k == 0 ? string("now") : "-" + to_string(k));
+    cout << right << setw(8) << "mean" << setw(7) << "alarm" << "\n";
+    line();
+    for (int m = 0; m < METRIC_COUNT; ++m) {
+        const MetricSeries& s = gMetrics.series[m];
+        cout << left << setw(20) << metric_name(m);
+        for (int k = 0; k < METRIC_SHOW; ++k) cout << right << setw(5) << s.at(now - k);
+        cout << right << setw(8) << fixed << setprecision(1) << s.mean << setw(7);
+        if (s.current < 0) cout << "-" << "\n";   // nothing counted yet
+        else               cout << s.alarm << "\n";
+        cout.unsetf(ios::floatfield);
+    }
+    cout << left;
+    report_surges();
+}
+
+#endif
@@ -2,38 +2,135 @@
 #define PATIENT_HPP
 
 #include "utils.hpp"
+#include "strpool.hpp"
+#include "events.hpp"   // change notifications
+#include "cdc.hpp"      // change-data-capture stream
+#include "phonetic.hpp" // same-sounding names (duplicate check)
+#include "metrics.hpp"  // arrival rates per minute
+#include "memory.hpp"   // accounting and the role's memory limit
+#include "planner.hpp"  // arrivals and services for the capacity planner
+#include "master_index.hpp" // every patient ever seen (LSM store)
+#include <memory>     // for shared_ptr (string pool shared between rooms)
+#include <cstdio>     // for remove() (room 2 and spill files)
+#include <unordered_map> // patient ID index
+#include <unordered_set> // IDs of spilled patients
 
 #define PATIENT_FILE "patients.txt"
+#define PATIENT_ROOM2_FILE "patients_room2.txt"   // only while room 2 is open
+#define PATIENT_SPILL_FILE "patients_spill.txt"   // admitted over the memory limit
 
 // ==========================================================================
 // ROLE 1: PATIENT ADMISSION CLERK (QUEUE)
 // --------------------------------------------------------------------------
 // This module manages the registration and discharge of patients using a
-// FIRST-IN-FIRST-OUT (FIFO) queue implemented with a circular array.
+// FIRST-IN-FIRST-OUT (FIFO) queue implemented as a SEGMENTED queue: a
+// linked list of fixed-size chunks (arrays of PATIENT_CHUNK records).
 //
 // Data structure choice:
-//   - We use an array-based circular queue (head, tail, count).
-//   - This gives O(1) time complexity for enqueue and dequeue.
+//   - Each chunk is a small array with its own begin/end index, so
+//     enqueue (at the tail chunk) and dequeue (at the head chunk) are O(1).
+//   - Records are still stored contiguously inside a chunk, so printing and
+//     saving scan memory almost like the old circular array.
+//   - When a clinic opens a second room, splitAt() hands the back part of
+//     the queue to another PatientQueue by relinking chunks: O(chunks)
+//     instead of copying every patient. append() is O(1), and
+//     mergeByArrival() restores arrival order in one linear pass.
+//   - An ID index (hash map ID -> chunk + slot) finds a waiting patient in
+//     O(1), so one patient can leave from the middle of the queue (e.g.
+//     escalated to the emergency department) without a scan.
 //   - It is suitable because patients must be treated in order of arrival.
 // ==========================================================================
 
 struct Patient {
-    // Patient ID is stored as text so we can use IDs like "P0028"
-    char id[16];        // was int, now text ID like P0028
-    char name[50];      // patient name
-    char condition[30]; // condition description (e.g., "Flu", "Checkup")
+    // All fields are compact references into the queue's string pool
+    // (see strpool.hpp), so a record is 52 bytes instead of 96 and long
+    // names are kept in full. Read them with PatientQueue::str().
+    PoolStr id;         // text ID like P0028
+    PoolStr name;       // patient name
+    PoolStr condition;  // condition description (e.g., "Flu", "Checkup")
+    unsigned arrival;   // admission order, used to merge queues back
 };
 
+// Arrival number given to the next admitted patient (all queues share it,
+// so patients from different rooms can be compared)
+inline unsigned gNextPatientArrival = 0;
+
+// --------------------------------------------------------------------------
+// PatientChunk
+// --------------------------------------------------------------------------
+// One segment of a PatientQueue. Valid records are slot[begin..end-1].
+// Empty chunks are kept on a free list (gPatientChunkFree) for reuse.
+// --------------------------------------------------------------------------
+const int PATIENT_CHUNK = 32;
+
+struct PatientQueue;
+
+struct PatientChunk {
+    Patient slot[PATIENT_CHUNK];
+    int begin = 0;
+    int end   = 0;
+    PatientChunk* next  = nullptr;
+    PatientQueue* owner = nullptr;   // queue this chunk currently belongs to
+
+    int size() const { return end - begin; }
+};
+
+inline PatientChunk* gPatientChunkFree = nullptr;
+
+inline PatientChunk* alloc_patient_chunk() {
+    PatientChunk* c = gPatientChunkFree;
+    if (c) gPatientChunkFree = c->next;
+    else   c = new PatientChunk;
+    c->begin = c->end = 0;
+    c->next  = nullptr;
+    c->owner = nullptr;
+    return c;
+}
+
+inline void free_patient_chunk(PatientChunk* c) {
+    c->next = gPatientChunkFree;
+    gPatientChunkFree = c;
+}
+
+// --------------------------------------------------------------------------
+// Patient ID index
+// --------------------------------------------------------------------------
+// Where a waiting patient's record is: chunk + slot. The chunk's owner
+// tells which queue (main or room 2) the patient is waiting in. Queues
+// that share one index keep it up to date on every change; a queue without
+// an index (index == nullptr) skips all of this.
+// --------------------------------------------------------------------------
+struct PatientRef {
+    PatientChunk* chunk;
+    int slot;
+};
+
+typedef unordered_map<string, PatientRef> PatientIndex;
+
 struct PatientQueue {
-    // Fixed-size array storing patient records
-    Patient data[MAX_PATIENTS];
+    // head : first chunk (holds the earliest patient)
+    // tail : last chunk (new patients are added here)
+    // count: current number of patients in the queue
+    PatientChunk* head = nullptr;
+    PatientChunk* tail = nullptr;
+    int count = 0;
+
+    // Out-of-line storage for long strings of the records. Shared with the
+    // queue created by splitAt(), so moving chunks never copies strings.
+    shared_ptr<StringPool> pool = make_shared<StringPool>();
+    size_t compactAt = POOL_COMPACT_MIN; // pool size that triggers compact()
 
-    // head : index of the front element
-    // tail : index where the next element will be inserted
-    // count: current number of elements in the queue
-    int head = 0;
-    int tail = 0;
-    int count = 0; // circular queue
+    // ID index shared by the queues of this clinic (may be nullptr), and
+    // the phonetic name index kept in step with it (see phonetic.hpp)
+    PatientIndex* index = nullptr;
+    PhoneticIndex* names = nullptr;
+
+    PatientQueue() {}
+    explicit PatientQueue(PatientIndex* idx, PhoneticIndex* nm = nullptr)
+        : index(idx), names(nm) {}
+    PatientQueue(const PatientQueue&) = delete;            // owns its chunks
+    PatientQueue& operator=(const PatientQueue&) = delete;
+    ~PatientQueue() { releaseChunks(); }
 
     // Check if the queue is full
     bool isFull()  const { return count == MAX_PATIENTS; }
@@ -41,8 +138,96 @@ struct PatientQueue {
     // Check if the queue is empty
     bool isEmpty() const { return count == 0; }
 
-    // Reset the queue to empty state
-    void clear() { head = tail = count = 0; }
+    // Record that slot i of chunk c holds its patient now
+    void indexSlot(PatientChunk* c, int i) {
+        if (!index) return;
+        auto r = index->insert_or_assign(str(c->slot[i].id), PatientRef{ c, i });
+        if (r.second && names) names->add(EV_PATIENTS, str(c->slot[i].name));
+    }
+
+    // Forget slot i of chunk c (only if the index still points there)
+    void unindexSlot(PatientChunk* c, int i) {
+        if (!index) return;
+        auto it = index->find(str(c->slot[i].id));
+        if (it != index->end() && it->second.chunk == c && it->second.slot == i) {
+            index->erase(it);
+            if (names) names->drop(EV_PATIENTS, str(c->slot[i].name));
+        }
+    }
+
+    // Give every chunk back to the free list
+    void releaseChunks() {
+        while (head) {
+            PatientChunk* next = head->next;
+            for (int i = head->begin; i < head->end; ++i) unindexSlot(head, i);
+            free_patient_chunk(head);
+            head = next;
+        }
+        tail = nullptr;
+        count = 0;
+    }
+
+    // Reset the queue to empty state (with a pool of its own again)
+    void clear() {
+        releaseChunks();
+        pool = make_shared<StringPool>();
+        compactAt = POOL_COMPACT_MIN;
+    }
+
+    // Read one of a record's string fields as a C string
+    const char* str(const PoolStr& s) const { return pool->get(s); }
+
+    // ----------------------------------------------------------------------
+    // make()
+    // ----------------------------------------------------------------------
+    // Purpose : Build a Patient whose strings are stored in this queue's
+    //           pool and give it the next arrival number. The record is not
+    //           enqueued yet.
+    // ----------------------------------------------------------------------
+    Patient make(const string& id, const string& name, const string& cond) {
+        if (pool->bytes() > compactAt) compact();
+        Patient p;
+        p.id        = pool->intern(id);
+        p.name      = pool->intern(name);
+        p.condition = pool->intern(cond);
+        p.arrival   = gNextPatientArrival++;
+        return p;
+    }
+
+    // ----------------------------------------------------------------------
+    // compact()
+    // ----------------------------------------------------------------------
+    // Purpose : Drop pool bytes of patients that have already left the
+    //           queue, by re-interning the strings of the waiting patients.
+    // Note    : Records obtained earlier from dequeue() are invalid after
+    //           this, so it is only called before adding a new patient.
+    //           Skipped while the pool is shared with another room's queue
+    //           (that queue's records point into it as well).
+    // ----------------------------------------------------------------------
+    void compact() {
+        if (pool.use_count() > 1) return;
+        StringPool fresh;
+        for (PatientChunk* c = head; c; c = c->next) {
+            for (int i = c->begin; i < c->end; ++i) {
+                Patient& p = c->slot[i];
+                p.id        = fresh.copyFrom(*pool, p.id);
+                p.name      = fresh.copyFrom(*pool, p.name);
+                p.condition = fresh.copyFrom(*pool, p.condition);
+            }
+        }
+        pool->buf.swap(fresh.buf);
+        compactAt = max(POOL_COMPACT_MIN, 2 * pool->bytes());
+    }
+
+    // Copy a record that belongs to queue `from` so its strings live in
+    // this queue's pool (no-op when both queues share one pool)
+    Patient adopt(const PatientQueue& from, Patient p) {
+        if (from.pool == pool) return p;
+        p.id        = pool->copyFrom(*from.pool, p.id);
+        p.name      = pool->copyFrom(*from.pool, p.name);
+        p.condition = pool->copyFrom(*from.pool, p.condition);
+        return p;
+    }
 
     // ----------------------------------------------------------------------
     // enqueue()
@@ -53,12 +238,22 @@ struct PatientQueue {
     // ----------------------------------------------------------------------
     bool enqueue(const Patient& p) {
         if (isFull()) return false;
-        data[tail] = p;
-        tail = (tail + 1) % MAX_PATIENTS; // move tail circularly
+        if (!tail || tail->end == PATIENT_CHUNK) {   // start a new chunk
+            PatientChunk* c = alloc_patient_chunk();
+            c->owner = this;
+            if (tail) tail->next = c;
+            else      head = c;
+            tail = c;
+        }
+        tail->slot[tail->end++] = p;
+        indexSlot(tail, tail->end - 1);
         count++;
         return true;
     }
 
+    // Earliest patient (caller checks isEmpty() first)
+    const Patient& front() const { return head->slot[head->begin]; }
+
     // ----------------------------------------------------------------------
     // dequeue()
     // ----------------------------------------------------------------------
@@ -68,9 +263,190 @@ struct PatientQueue {
     // ----------------------------------------------------------------------
     bool dequeue(Patient& out) {
         if (isEmpty()) return false;
-        out = data[head];
-        head = (head + 1) % MAX_PATIENTS; // move head circularly
+        unindexSlot(head, head->begin);
+        out = head->slot[head->begin++];
+        count--;
+        if (head->begin == head->end) {              // chunk used up
+            PatientChunk* next = head->next;
+            free_patient_chunk(head);
+            head = next;
+            if (!head) tail = nullptr;
+        }
+        return true;
+    }
+
+    // ----------------------------------------------------------------------
+    // removeAt()
+    // ----------------------------------------------------------------------
+    // Purpose : Take the patient in slot i of chunk c (found through the ID
+    //           index) out of the queue, keeping everyone else in order.
+    // Output  : out - the removed patient.
+    // Cost    : Only the records in front of it in the same chunk move one
+    //           slot back, so at most PATIENT_CHUNK record moves. If the
+    //           chunk becomes empty it is unlinked (O(chunks) to find the
+    //           previous one).
+    // ----------------------------------------------------------------------
+    void removeAt(PatientChunk* c, int i, Patient& out) {
+        unindexSlot(c, i);
+        out = c->slot[i];
+        for (int j = i; j > c->begin; --j) {
+            c->slot[j] = c->slot[j - 1];
+            indexSlot(c, j);
+        }
+        c->begin++;
         count--;
+        if (c->begin == c->end) {                    // unlink empty chunk
+            PatientChunk* prev = nullptr;
+            for (PatientChunk* k = head; k != c; k = k->next) prev = k;
+            if (prev) prev->next = c->next;
+            else      head = c->next;
+            if (tail == c) tail = prev;
+            free_patient_chunk(c);
+        }
+    }
+
+    // Mark every chunk of this queue as owned by it (after relinking)
+    void claimChunks() {
+        for (PatientChunk* c = head; c; c = c->next) c->owner = this;
+    }
+
+    // ----------------------------------------------------------------------
+    // splitAt()
+    // ----------------------------------------------------------------------
+    // Purpose : Keep the first `pos` patients here and move all later ones
+    //           (in order) into `out`, which is cleared first.
+    // Cost    : O(chunks) to find the split chunk. Whole chunks are relinked;
+    //           only a chunk cut in the middle copies up to PATIENT_CHUNK
+    //           records. The string pool is shared, not copied.
+    // ----------------------------------------------------------------------
+    void splitAt(int pos, PatientQueue& out) {
+        out.clear();
+        out.pool  = pool;
+        out.index = index;
+        out.names = names;
+        if (pos < 0) pos = 0;
+        if (pos >= count) return;
+
+        if (pos == 0) {                              // everything moves
+            out.head = head;
+            out.tail = tail;
+            out.count = count;
+            head = tail = nullptr;
+            count = 0;
+            out.claimChunks();
+            return;
+        }
+
+        PatientChunk* prev = nullptr;
+        PatientChunk* c = head;
+        int skip = pos;
+        while (skip >= c->size()) {                  // find the split chunk
+            skip -= c->size();
+            prev = c;
+            c = c->next;
+        }
+
+        if (skip == 0) {                             // split on a boundary
+            prev->next = nullptr;
+            out.head = c;
+            out.tail = tail;
+            tail = prev;
+        } else {                                     // cut chunk c in two
+            int k = c->begin + skip;
+            PatientChunk* n = alloc_patient_chunk();
+            for (int i = k; i < c->end; ++i) {
+                n->slot[n->end++] = c->slot[i];
+                indexSlot(n, n->end - 1);
+            }
+            n->next = c->next;
+            c->end  = k;
+            c->next = nullptr;
+            out.head = n;
+            out.tail = (tail == c) ? n : tail;
+            tail = c;
+        }
+        out.count = count - pos;
+        count = pos;
+        out.claimChunks();
+    }
+
+    // ----------------------------------------------------------------------
+    // append()
+    // ----------------------------------------------------------------------
+    // Purpose : Put all patients of `other` behind the patients of this
+    //           queue (other is left empty). O(chunks) when both queues
+    //           share a string pool and ID index (the chunks just change
+    //           owner), otherwise every record is copied/re-indexed.
+    // Return  : false (nothing moved) if the result would exceed MAX_PATIENTS.
+    // ----------------------------------------------------------------------
+    bool append(PatientQueue& other) {
+        if (&other == this || other.isEmpty()) return true;
+        if (count + other.count > MAX_PATIENTS) return false;
+        bool copyStrings = other.pool != pool;
+        bool moveIndex   = other.index != index;
+        if (copyStrings || moveIndex) {
+            for (PatientChunk* c = other.head; c; c = c->next)
+                for (int i = c->begin; i < c->end; ++i) {
+                    if (moveIndex)   other.unindexSlot(c, i);
+                    if (copyStrings) c->slot[i] = adopt(other, c->slot[i]);
+                    if (moveIndex)   indexSlot(c, i);
+                }
+        }
+        for (PatientChunk* c = other.head; c; c = c->next) c->owner = this;
+        if (tail) tail->next = other.head;
+        else      head = other.head;
+        tail = other.tail;
+        count += other.count;
+        other.head = other.tail = nullptr;
+        other.clear();
+        return true;
+    }
+
+    // ----------------------------------------------------------------------
+    // mergeByArrival()
+    // ----------------------------------------------------------------------
+    // Purpose : Combine `other` into this queue so that all patients are in
+    //           order of arrival again (other is left empty). Used when a
+    //           second room closes and its patients go back to this queue.
+    // Method  : Classic two-way merge of two arrival-ordered queues, one
+    //           linear pass. Chunks emptied by the merge are reused for the
+    //           result, so the memory use stays the same.
+    // Return  : false (nothing moved) if the result would exceed MAX_PATIENTS.
+    // ----------------------------------------------------------------------
+    bool mergeByArrival(PatientQueue& other) {
+        if (&other == this || other.isEmpty()) return true;
+        if (count + other.count > MAX_PATIENTS) return false;
+
+        // Fast path: other's patients all arrived later -> O(1) relink
+        if (isEmpty() || tail->slot[tail->end - 1].arrival <= other.front().arrival)
+            return append(other);
+
+        PatientChunk* mHead = nullptr;
+        PatientChunk* mTail = nullptr;
+        int total = count + other.count;
+        Patient p;
+        while (!isEmpty() || !other.isEmpty()) {
+            bool mine = other.isEmpty() ||
+                        (!isEmpty() && front().arrival <= other.front().arrival);
+            if (mine) dequeue(p);
+            else {
+                other.dequeue(p);
+                p = adopt(other, p);
+            }
+            if (!mTail || mTail->end == PATIENT_CHUNK) {
+                PatientChunk* c = alloc_patient_chunk();
+                c->owner = this;
+                if (mTail) mTail->next = c;
+                else       mHead = c;
+                mTail = c;
+            }
+            mTail->slot[mTail->end++] = p;
+            indexSlot(mTail, mTail->end - 1);
+        }
+        head  = mHead;
+        tail  = mTail;
+        count = total;
+        other.clear();
         return true;
     }
 
@@ -89,11 +465,13 @@ struct PatientQueue {
              << setw(22) << "Name"
              << "Condition" << "\n";
         line();
-        for (int i = 0; i < count; ++i) {
-            int idx = (head + i) % MAX_PATIENTS;
-            cout << left << setw(12) << data[idx].id
-                 << setw(22) << data[idx].name
-                 << data[idx].condition << "\n";
+        for (PatientChunk* c = head; c; c = c->next) {
+            for (int i = c->begin; i < c->end; ++i) {
+                const Patient& p = c->slot[i];
+                cout << left << setw(12) << str(p.id)
+                     << setw(22) << str(p.name)
+                     << str(p.condition) << "\n";
+            }
         }
     }
 
@@ -112,12 +490,13 @@ struct PatientQueue {
             cout << "[Error] Cannot open " << filename << " for writing.\n";
             return;
         }
-        for (int i = 0; i < count; ++i) {
-            int idx = (head + i) % MAX_PATIENTS;
-            const Patient& p = data[idx];
-            out << p.id        << '\n'
-                << p.name      << '\n'
-                << p.condition << '\n';
+        for (PatientChunk* c = head; c; c = c->next) {
+            for (int i = c->begin; i < c->end; ++i) {
+                const Patient& p = c->slot[i];
+                out << str(p.id)        << '\n'
+                    << str(p.name)      << '\n'
+                    << str(p.condition) << '\n';
+            }
         }
     }
 
@@ -134,7 +513,7 @@ struct PatientQueue {
     void loadFromFile(const char* filename) {
         ifstream in(filename);
         if (!in) {
-            cout << "[Info] " << filename
+            load_log() << "[Info] " << filename
                  << " not found. Starting with empty patient queue.\n";
             clear();
             return;
@@ -149,14 +528,10 @@ struct PatientQueue {
             if (!getline(in, sname)) break;
             if (!getline(in, scond)) break;
 
-            Patient p{};
-            strncpy(p.id,        sid.c_str(),   sizeof(p.id)        - 1);
-            strncpy(p.name,      sname.c_str(), sizeof(p.name)      - 1);
-            strncpy(p.condition, scond.c_str(), sizeof(p.condition) - 1);
-
-            if (!enqueue(p)) break;            // stop if queue full
+            if (isFull()) break;               // stop if queue full
+            enqueue(make(sid, sname, scond));
         }
-        cout << "[OK] Loaded patients from " << filename
+        load_log() << "[OK] Loaded patients from " << filename
              << " (count=" << count << ")\n";
     }
 };
@@ -170,7 +545,179 @@ struct PatientQueue {
 // In this version, we use an inline global variable (C++17 feature) so only
 // one instance of gPatients exists across translation units.
 // --------------------------------------------------------------------------
-inline PatientQueue gPatients;
+// Both rooms share one ID index, so a patient is found wherever they wait
+inline PatientIndex gPatientIndex;
+
+inline PatientQueue gPatients(&gPatientIndex, &gNames);
+
+// Queue of the second consultation room. Empty unless the clerk opened it
+// with "Open Second Room"; saved to PATIENT_ROOM2_FILE while it is open.
+inline PatientQueue gPatientsRoom2(&gPatientIndex, &gNames);
+
+// --------------------------------------------------------------------------
+// Memory accounting (memory.hpp)
+// --------------------------------------------------------------------------
+// Chunks are counted by walking the lists (a few dozen at MAX_PATIENTS).
+// Compaction rebuilds the string pools, frees the spare chunks and shrinks
+// the ID index to its size.
+// --------------------------------------------------------------------------
+inline size_t patient_chunks_bytes(const PatientChunk* c) {
+    size_t b = 0;
+    for (; c; c = c->next) b += sizeof(PatientChunk);
+    return b;
+}
+
+inline MemRegister gPatientQueueMem(MEM_PATIENTS, "queues (chunks in use)", [] {
+    return sizeof(gPatients) + sizeof(gPatientsRoom2)
+         + patient_chunks_bytes(gPatients.head) + patient_chunks_bytes(gPatientsRoom2.head);
+});
+inline MemRegister gPatientFreeMem(MEM_PATIENTS, "spare chunks",
+                                   [] { return patient_chunks_bytes(gPatientChunkFree); });
+inline MemRegister gPatientPoolMem(MEM_PATIENTS, "string pools", [] {
+    size_t b = sizeof(StringPool) + gPatients.pool->buf.capacity();
+    if (gPatientsRoom2.pool != gPatients.pool)
+        b += sizeof(StringPool) + gPatientsRoom2.pool->buf.capacity();
+    return b;
+});
+inline MemRegister gPatientIndexMem(MEM_PATIENTS, "ID index", [] {
+    size_t b = mem_hash(gPatientIndex);
+    for (const auto& kv : gPatientIndex) b += mem_string(kv.first);
+    return b;
+});
+inline MemRegister gPatientCompact(MEM_PATIENTS, [] {
+    gPatients.compact();
+    gPatientsRoom2.compact();
+    while (gPatientChunkFree) {
+        PatientChunk* c = gPatientChunkFree;
+        gPatientChunkFree = c->next;
+        delete c;
+    }
+    gPatientIndex.rehash(0);
+});
+
+// ================= SPILL (PATIENT MEMORY LIMIT REACHED) ====================
+// --------------------------------------------------------------------------
+// With the "spill" policy (memory.hpp), a patient admitted while the role
+// is at its memory limit is appended to PATIENT_SPILL_FILE (same format as
+// PATIENT_FILE) instead of gPatients. While anyone waits there, new
+// admissions go there too, so arrival order is kept, and patient_unspill()
+// moves them back, oldest first, at the next admission or discharge that
+// finds room.
+// Patients on disk are shown only as a count in the queue view; they cannot
+// be escalated or found by a query until they are back in memory. Only
+// their IDs stay in memory (gPatientSpillIds), for the duplicate check at
+// admission.
+// --------------------------------------------------------------------------
+inline int gPatientsSpilled = 0;   // patients waiting in PATIENT_SPILL_FILE
+inline unordered_set<string> gPatientSpillIds;   // their IDs
+
+inline MemRegister gPatientSpillMem(MEM_PATIENTS, "spilled IDs", [] {
+    size_t b = mem_hash(gPatientSpillIds);
+    for (const string& id : gPatientSpillIds) b += mem_string(id);
+    return b;
+});
+
+// Records of the spill file, oldest first (id, name, condition each)
+inline vector<string> read_patient_spill() {
+    vector<string> rec;
+    ifstream in(PATIENT_SPILL_FILE);
+    string sid, sname, scond;
+    while (getline(in, sid)) {
+        if (sid.empty()) continue;
+        if (!getline(in, sname) || !getline(in, scond)) break;
+        rec.push_back(sid);
+        rec.push_back(sname);
+        rec.push_back(scond);
+    }
+    return rec;
+}
+
+inline bool patient_spill(const string& id, const string& name, const string& cond) {
+    ofstream out(PATIENT_SPILL_FILE, ios::app);
+    if (!out) {
+        cout << "[Error] Cannot open " << PATIENT_SPILL_FILE << " for writing.\n";
+        return false;
+    }
+    out << id << '\n' << name << '\n' << cond << '\n';
+    gPatientsSpilled++;
+    gPatientSpillIds.insert(id);
+    gMem.spilled[MEM_PATIENTS]++;
+    return true;
+}
+
+// true if a patient with this ID waits in the spill file
+inline bool patient_spilled(const string& id) {
+    return gPatientSpillIds.count(id) > 0;
+}
+
+// --------------------------------------------------------------------------
+// patient_unspill()
+// --------------------------------------------------------------------------
+// Purpose : Move spilled patients back to the tail of gPatients, oldest
+//           first, while the queue has room and the role is under its
+//           limit, then rewrite the spill file with the rest.
+// Return  : number of patients moved (the caller saves PATIENT_FILE).
+// Note    : May compact gPatients' pool (see make()).
+// --------------------------------------------------------------------------
+inline int patient_unspill() {
+    if (gPatientsSpilled == 0) return 0;
+    vector<string> rec = read_patient_spill();
+    size_t i = 0;
+    while (i < rec.size() && !gPatients.isFull() && mem_under_limit(MEM_PATIENTS)) {
+        gPatients.enqueue(gPatients.make(rec[i], rec[i + 1], rec[i + 2]));
+        gPatientSpillIds.erase(rec[i]);
+        i += 3;
+    }
+    gPatientsSpilled = (int)((rec.size() - i) / 3);
+    if (gPatientsSpilled == 0) {
+        remove(PATIENT_SPILL_FILE);
+    } else if (i > 0) {
+        ofstream out(PATIENT_SPILL_FILE);
+        for (size_t k = i; k < rec.size(); ++k) out << rec[k] << '\n';
+    }
+    return (int)(i / 3);
+}
+
+// Patients waiting anywhere (both rooms and the spill file)
+inline int patients_waiting() {
+    return gPatients.count + gPatientsRoom2.count + gPatientsSpilled;
+}
+
+inline PlanRegister gPatientsPlan(PLAN_PATIENTS, patients_waiting);
+
+// --------------------------------------------------------------------------
+// remove_waiting_patient()
+// --------------------------------------------------------------------------
+// Purpose : Find a waiting patient by ID (main queue or room 2) through
+//           gPatientIndex and take them out of their queue.
+// Output  : out  - the removed record (strings in from's pool)
+//           from - the queue they were waiting in
+// Return  : false if no patient with that ID is waiting.
+// --------------------------------------------------------------------------
+inline bool remove_waiting_patient(const string& id, Patient& out,
+                                   PatientQueue*& from) {
+    auto it = gPatientIndex.find(id);
+    if (it == gPatientIndex.end()) return false;
+    PatientRef ref = it->second;
+    from = ref.chunk->owner;
+    from->removeAt(ref.chunk, ref.slot, out);
+    return true;
+}
+
+// Change-stream image of a patient record (see cdc.hpp)
+inline string patient_image(const PatientQueue& q, const Patient& p, int room) {
+    return cdc_image({ q.str(p.id), q.str(p.name), q.str(p.condition),
+                       to_string(room) });
+}
+
+// One "update" event per patient of q, moving from room `from` to `to`
+inline void publish_room_moves(const PatientQueue& q, int from, int to) {
+    for (PatientChunk* c = q.head; c; c = c->next)
+        for (int i = c->begin; i < c->end; ++i)
+            publish_event(EV_PATIENTS, EV_UPDATE, q.str(c->slot[i].id), to,
+                          patient_image(q, c->slot[i], from),
+                          patient_image(q, c->slot[i], to));
+}
 
 // ====================== UI FUNCTIONS FOR ROLE 1 ============================
 
@@ -183,23 +730,53 @@ inline PatientQueue gPatients;
 //           On success, it also saves the queue to PATIENT_FILE.
 // --------------------------------------------------------------------------
 inline void ui_admit_patient() {
+    // Patients spilled earlier go first; while some are left, so does this
+    // one. Done before the full check, so a queue they fill is reported
+    // now and not after the clerk has typed the new patient in.
+    if (patient_unspill() > 0) gPatients.saveToFile(PATIENT_FILE);
     if (gPatients.isFull()) {
         cout << "Patient queue is full.\n";
         return;
     }
-    Patient p{};
+    MemAdmit room = gPatientsSpilled > 0 ? MEM_ADMIT_SPILL : mem_admit(MEM_PATIENTS);
+    if (room == MEM_ADMIT_REJECT) {
+        cout << "[Error] Memory limit of patients reached ("
+             << mem_role_bytes(MEM_PATIENTS) << " of " << gMem.limit[MEM_PATIENTS]
+             << " bytes). Not admitted.\n";
+        return;
+    }
+    string id, name, cond;
 
     cout << "Enter Patient ID (e.g., P028): ";
-    safe_getline(p.id, 16);      // no numeric check anymore (text ID)
+    safe_getline(id);            // no numeric check anymore (text ID)
+    if (gPatientIndex.count(id) || patient_spilled(id)) {
+        cout << "Patient " << id << " is already waiting.\n";
+        return;
+    }
 
     cout << "Enter Patient Name: ";
-    safe_getline(p.name, 50);
+    safe_getline(name);
+    warn_possible_duplicates(name);   // same-sounding waiting/emergency names
 
     cout << "Enter Condition Type (e.g., Flu/Checkup): ";
-    safe_getline(p.condition, 30);
+    safe_getline(cond);
+
+    if (room == MEM_ADMIT_SPILL) {
+        if (!patient_spill(id, name, cond)) return;
+        cout << "Admitted. Waiting on disk until there is memory for them ("
+             << gPatientsSpilled << " patient(s) there).\n";
+        publish_event(EV_PATIENTS, EV_INSERT, id.c_str(), 1, "",
+                      cdc_image({ id, name, cond, "1" }));
+        master_record(id, name, cond, "waiting");
+        return;
+    }
 
+    Patient p = gPatients.make(id, name, cond);
     if (gPatients.enqueue(p)) {
         cout << "Admitted to queue.\n";
+        publish_event(EV_PATIENTS, EV_INSERT, id.c_str(), 1, "",
+                      patient_image(gPatients, p, 1));
+        master_record(id, name, cond, "waiting");
         gPatients.saveToFile(PATIENT_FILE);   // auto-save after change
     } else {
         cout << "Failed to admit.\n";
@@ -215,17 +792,94 @@ inline void ui_admit_patient() {
 //           On success, it also saves the queue to PATIENT_FILE.
 // --------------------------------------------------------------------------
 inline void ui_discharge_patient() {
-    Patient p{};
+    Patient p;
     if (gPatients.dequeue(p)) {
         cout << "Discharged earliest admitted patient: ["
-             << p.id << "] " << p.name
-             << " (" << p.condition << ")\n";
+             << gPatients.str(p.id) << "] " << gPatients.str(p.name)
+             << " (" << gPatients.str(p.condition) << ")\n";
+        publish_event(EV_PATIENTS, EV_REMOVE, gPatients.str(p.id), 1,
+                      patient_image(gPatients, p, 1), "");
+        master_record(gPatients.str(p.id), gPatients.str(p.name),
+                      gPatients.str(p.condition), "discharged");
+        int back = patient_unspill();         // `p` is not used after this
+        if (back > 0) cout << back << " patient(s) moved back from disk.\n";
         gPatients.saveToFile(PATIENT_FILE);   // auto-save after discharge
     } else {
         cout << "No patients to discharge.\n";
     }
 }
 
+// --------------------------------------------------------------------------
+// ui_open_second_room()
+// --------------------------------------------------------------------------
+// Purpose : A second room opens: the later-arrived half of the waiting
+//           patients moves to gPatientsRoom2 (splitAt(), no record copies).
+//           New admissions keep going to the main queue.
+// --------------------------------------------------------------------------
+inline void ui_open_second_room() {
+    if (!gPatientsRoom2.isEmpty()) {
+        cout << "Second room is already open.\n";
+        return;
+    }
+    if (gPatients.count < 2) {
+        cout << "Not enough patients waiting to split.\n";
+        return;
+    }
+    int keep = (gPatients.count + 1) / 2;
+    gPatients.splitAt(keep, gPatientsRoom2);
+    cout << "Second room opened: " << gPatientsRoom2.count
+         << " patient(s) moved, " << gPatients.count << " stay.\n";
+    publish_room_moves(gPatientsRoom2, 1, 2);
+    gPatients.saveToFile(PATIENT_FILE);
+    gPatientsRoom2.saveToFile(PATIENT_ROOM2_FILE);
+}
+
+// --------------------------------------------------------------------------
+// ui_close_second_room()
+// --------------------------------------------------------------------------
+// Purpose : The second room closes: its remaining patients go back into the
+//           main queue in order of arrival (mergeByArrival()).
+// --------------------------------------------------------------------------
+inline void ui_close_second_room() {
+    if (gPatientsRoom2.isEmpty()) {
+        cout << "Second room has no waiting patients.\n";
+        remove(PATIENT_ROOM2_FILE);
+        return;
+    }
+    int moved = gPatientsRoom2.count;
+    if (gPatients.count + moved > MAX_PATIENTS) {
+        cout << "Main queue is too full to take back room 2 patients.\n";
+        return;
+    }
+    publish_room_moves(gPatientsRoom2, 2, 1);   // before the merge empties it
+    gPatients.mergeByArrival(gPatientsRoom2);
+    cout << "Second room closed: " << moved
+         << " patient(s) merged back by arrival.\n";
+    gPatients.saveToFile(PATIENT_FILE);
+    remove(PATIENT_ROOM2_FILE);
+}
+
+// --------------------------------------------------------------------------
+// ui_discharge_room2()
+// --------------------------------------------------------------------------
+// Purpose : Discharge the earliest patient waiting for the second room.
+// --------------------------------------------------------------------------
+inline void ui_discharge_room2() {
+    Patient p;
+    if (gPatientsRoom2.dequeue(p)) {
+        cout << "Room 2 discharged: ["
+             << gPatientsRoom2.str(p.id) << "] " << gPatientsRoom2.str(p.name)
+             << " (" << gPatientsRoom2.str(p.condition) << ")\n";
+        publish_event(EV_PATIENTS, EV_REMOVE, gPatientsRoom2.str(p.id), 2,
+                      patient_image(gPatientsRoom2, p, 2), "");
+        master_record(gPatientsRoom2.str(p.id), gPatientsRoom2.str(p.name),
+                      gPatientsRoom2.str(p.condition), "discharged");
+        gPatientsRoom2.saveToFile(PATIENT_ROOM2_FILE);
+    } else {
+        cout << "No patients waiting for room 2.\n";
+    }
+}
+
 // --------------------------------------------------------------------------
 // menu_patients()
 // --------------------------------------------------------------------------
@@ -235,6 +889,12 @@ inline void ui_discharge_patient() {
 //   1) Admit Patient
 //   2) Discharge Patient (earliest)
 //   3) View Patient Queue
+//   4) Open Second Room (move later half of the queue)
+//   5) Discharge Patient from Room 2
+//   6) View Room 2 Queue
+//   7) Close Second Room (merge back by arrival)
+//   8) Look Up Any Patient (master index, all patients ever seen)
+//   9) Master Index Status
 //   0) Back (return to main menu)
 // --------------------------------------------------------------------------
 inline void menu_patients() {
@@ -245,10 +905,17 @@ inline void menu_patients() {
         cout << "1) Admit Patient\n";
         cout << "2) Discharge Patient (earliest)\n";
         cout << "3) View Patient Queue\n";
+        cout << "4) Open Second Room (split queue)\n";
+        cout << "5) Discharge Patient from Room 2\n";
+        cout << "6) View Room 2 Queue\n";
+        cout << "7) Close Second Room (merge back)\n";
+        cout << "8) Look Up Any Patient (master index)\n";
+        cout << "9) Master Index Status\n";
         cout << "0) Back\n> ";
 
         int ch;
         if (!(cin >> ch)) {
+            if (cin.eof()) return;          // end of input
             // Input validation: if not an integer, clear and retry
             cin.clear();
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -260,7 +927,18 @@ inline void menu_patients() {
         if (ch == 0) break;                 // return to main menu
         else if (ch == 1) ui_admit_patient();
         else if (ch == 2) ui_discharge_patient();
-        else if (ch == 3) gPatients.print();
+        else if (ch == 3) {
+            gPatients.print();
+            if (gPatientsSpilled > 0)
+                cout << "(+" << gPatientsSpilled << " later arrival(s) waiting on disk,"
+                     << " patient memory limit reached)\n";
+        }
+        else if (ch == 4) ui_open_second_room();
+        else if (ch == 5) ui_discharge_room2();
+        else if (ch == 6) gPatientsRoom2.print();
+        else if (ch == 7) ui_close_second_room();
+        else if (ch == 8) ui_master_lookup();
+        else if (ch == 9) print_master();
         else cout << "Invalid choice.\n";
     }
 }
@@ -269,10 +947,32 @@ inline void menu_patients() {
 // load_patients_from_file()
 // --------------------------------------------------------------------------
 // Convenience wrapper for main.cpp to load patients into the global queue
-// from PATIENT_FILE at program startup.
+// from PATIENT_FILE at program startup. If the second room was open when
+// the program last ran, its queue is restored too (its patients then count
+// as arriving after the main queue's, since arrival numbers are not saved).
+// Patients spilled to PATIENT_SPILL_FILE stay there until there is room.
 // --------------------------------------------------------------------------
 inline void load_patients_from_file() {
     gPatients.loadFromFile(PATIENT_FILE);
+    vector<string> spilled = read_patient_spill();
+    gPatientsSpilled = (int)(spilled.size() / 3);
+    gPatientSpillIds.clear();
+    for (size_t i = 0; i < spilled.size(); i += 3) gPatientSpillIds.insert(spilled[i]);
+    if (gPatientsSpilled > 0)
+        load_log() << "[Info] " << gPatientsSpilled << " patient(s) waiting in "
+                   << PATIENT_SPILL_FILE << " (memory limit).\n";
+    if (ifstream(PATIENT_ROOM2_FILE))
+        gPatientsRoom2.loadFromFile(PATIENT_ROOM2_FILE);
+}
+
+// The clerk role of the interactive program: the queues, then the patient
+// master index. The index is opened for writing (its logs are replayed and
+// removed, leftover run files deleted), so only the interactive program
+// opens it; --query and --batch load the queues alone and leave the index
+// of a running instance untouched.
+inline void load_patient_role() {
+    load_patients_from_file();
+    master_open();
 }
 
 #endif
@@ -0,0 +1,330 @@
+#ifndef PHONETIC_HPP
+#define PHONETIC_HPP
+
+#include "utils.hpp"
+#include "events.hpp"   // EventRole says where a name is (patients/emergencies)
+#include "memory.hpp"   // accounting
+#include <vector>
+#include <unordered_map>
+#include <algorithm>    // for sort (word keys, dedupe groups)
+#include <chrono>       // for steady_clock (dedupe timing)
+#include <functional>   // for hash<string>
+#include <thread>       // parallel batch dedupe
+#include <cctype>       // for isalpha/toupper
+
+// ---------------------------------------------------------------------------
+// phonetic.hpp
+// ---------------------------------------------------------------------------
+// Duplicate detection by how names SOUND. Spelling variants such as
+// "Nurul Izzah" / "Nurul Izza" or "Mohd Ali" / "Mohd Aly" get the same
+// phonetic key, so a second record for the same person can be flagged when
+// it is entered.
+//
+// Key: every word of the name is reduced with a simplified Metaphone
+// (consonant skeleton, silent letters dropped, similar sounds merged), and
+// the word keys are sorted and joined with ' ', so the order of the words
+// does not matter either ("Tan John" = "John Tan").
+//
+// gNames maps each key to the names currently stored under it, with a
+// count per (name, role). It is kept up to date on every insert and remove:
+//   - patients    : through the ID index of PatientQueue (a patient enters
+//                   gNames when their ID enters gPatientIndex and leaves it
+//                   when the ID is removed, in either room)
+//   - emergencies : at the mutation sites in emergency.hpp
+// A lookup is one key computation plus one hash lookup, O(1) expected.
+//
+// Batch mode for archives (one name per line), using all CPU cores:
+//   main --dedupe FILE
+// ---------------------------------------------------------------------------
+
+// ---------------------------------------------------------------------------
+// phonetic_word()
+// ---------------------------------------------------------------------------
+// Purpose : Simplified Metaphone key of one word (letters only, any case).
+//           Vowels only count as the first letter; adjacent equal codes
+//           are merged, so double letters do not matter.
+// ---------------------------------------------------------------------------
+inline string phonetic_word(const string& word) {
+    string w;
+    for (char c : word)
+        if (isalpha((unsigned char)c)) w += (char)toupper((unsigned char)c);
+    if (w.empty()) return w;
+
+    auto at = [&](size_t i) -> char { return i < w.size() ? w[i] : '\0'; };
+    auto vowel = [](char c) { return c && strchr("AEIOU", c) != nullptr; };
+
+    size_t i = 0;
+    string k;
+    // Silent first letters
+    if ((w[0] == 'K' || w[0] == 'G' || w[0] == 'P') && at(1) == 'N') i = 1;
+    else if (w[0] == 'W' && at(1) == 'R')                           i = 1;
+    else if (w[0] == 'A' && at(1) == 'E')                           i = 1;
+    else if (w[0] == 'X') { k += 'S'; i = 1; }
+    else if (w[0] == 'W' && at(1) == 'H') { k += 'W'; i = 2; }
+
+    for (; i < w.size(); ++i) {
+        char c = w[i], prev = i ? w[i - 1] : '\0', next = at(i + 1);
+        char code = 0;
+        switch (c) {
+        case 'A': case 'E': case 'I': case 'O': case 'U':
+            if (i == 0) code = 'A';
+            break;
+        case 'B':
+            if (!(prev == 'M' && i + 1 == w.size())) code = 'B';   // "-mb"
+            break;
+        case 'C':
+            if (next == 'I' && at(i + 2) == 'A')      code = 'X';
+            else if (next == 'H')                     { code = (prev == 'S') ? 'K' : 'X'; i++; }
+            else if (next == 'I' || next == 'E' || next == 'Y') code = 'S';
+            else                                      code = 'K';
+            break;
+        case 'D':
+            if (next == 'G' && at(i + 2) && strchr("EIY", at(i + 2))) { code = 'J'; i++; }
+            else                                      code = 'T';
+            break;
+        case 'G':
+            if (next == 'H' && !vowel(at(i + 2)))     { i++; break; }   // "-gh"
+            if (next == 'N' && i + 2 == w.size())     break;            // "-gn"
+            if (next == 'I' || next == 'E' || next == 'Y') code = 'J';
+            else                                      code = 'K';
+            break;
+        case 'H':
+            if (vowel(next) && !(prev && strchr("CSPTG", prev))) code = 'H';
+            break;
+        case 'K':
+            if (prev != 'C') code = 'K';
+            break;
+        case 'P':
+            if (next == 'H') { code = 'F'; i++; }
+            else             code = 'P';
+            break;
+        case 'Q': code = 'K'; break;
+        case 'S':
+            if (next == 'H')                          { code = 'X'; i++; }
+            else if (next == 'I' && (at(i + 2) == 'O' || at(i + 2) == 'A')) code = 'X';
+            else                                      code = 'S';
+            break;
+        case 'T':
+            if (next == 'I' && (at(i + 2) == 'O' || at(i + 2) == 'A')) code = 'X';
+            else if (next == 'H')                     { code = '0'; i++; }   // "th"
+            else if (!(next == 'C' && at(i + 2) == 'H')) code = 'T';
+            break;
+        case 'V': code = 'F'; break;
+        case 'W': case 'Y':
+            if (vowel(next)) code = c;
+            break;
+        case 'X':
+            if (k.empty() || k.back() != 'K') k += 'K';
+            code = 'S';
+            break;
+        case 'Z': code = 'S'; break;
+        default:  code = c;   break;   // F J L M N R
+        }
+        if (code && (k.empty() || k.back() != code)) k += code;
+    }
+    return k;
+}
+
+// ---------------------------------------------------------------------------
+// phonetic_key()
+// ---------------------------------------------------------------------------
+// Purpose : Key of a whole name: the sorted word keys joined with ' '.
+//           Empty if the name has no letters.
+// ---------------------------------------------------------------------------
+inline string phonetic_key(const string& name) {
+    vector<string> words;
+    size_t i = 0;
+    while (i < name.size()) {
+        while (i < name.size() && !isalpha((unsigned char)name[i])) i++;
+        size_t j = i;
+        while (j < name.size() && isalpha((unsigned char)name[j])) j++;
+        if (j > i) {
+            string wk = phonetic_word(name.substr(i, j - i));
+            if (!wk.empty()) words.push_back(wk);
+        }
+        i = j;
+    }
+    sort(words.begin(), words.end());
+    string key;
+    for (size_t w = 0; w < words.size(); ++w) {
+        if (w) key += ' ';
+        key += words[w];
+    }
+    return key;
+}
+
+// ---------------------------------------------------------------------------
+// PhoneticIndex
+// ---------------------------------------------------------------------------
+struct PhoneticEntry {
+    string name;     // name as stored
+    EventRole role;  // EV_PATIENTS or EV_EMERGENCIES
+    int count;       // records with exactly this name in this role
+};
+
+struct PhoneticIndex {
+    unordered_map<string, vector<PhoneticEntry> > buckets;
+
+    void add(EventRole role, const string& name) {
+        string key = phonetic_key(name);
+        if (key.empty()) return;
+        vector<PhoneticEntry>& b = buckets[key];
+        for (PhoneticEntry& e : b)
+            if (e.role == role && e.name == name) { e.count++; return; }
+        b.push_back(PhoneticEntry{ name, role, 1 });
+    }
+
+    void drop(EventRole role, const string& name) {
+        auto it = buckets.find(phonetic_key(name));
+        if (it == buckets.end()) return;
+        vector<PhoneticEntry>& b = it->second;
+        for (size_t i = 0; i < b.size(); ++i) {
+            if (b[i].role != role || b[i].name != name) continue;
+            if (--b[i].count == 0) {
+                b[i] = b.back();
+                b.pop_back();
+                if (b.empty()) buckets.erase(it);
+            }
+            return;
+        }
+    }
+
+    // Forget every name of one role (before reloading that role)
+    void dropRole(EventRole role) {
+        for (auto it = buckets.begin(); it != buckets.end();) {
+            vector<PhoneticEntry>& b = it->second;
+            b.erase(remove_if(b.begin(), b.end(),
+                              [&](const PhoneticEntry& e) { return e.role == role; }),
+                    b.end());
+            if (b.empty()) it = buckets.erase(it);
+            else           ++it;
+        }
+    }
+
+    // Names that sound like `name` (nullptr if none)
+    const vector<PhoneticEntry>* find(const string& name) const {
+        auto it = buckets.find(phonetic_key(name));
+        return it == buckets.end() ? nullptr : &it->second;
+    }
+};
+
+// Names of all waiting patients and emergency cases (C++17 inline variable)
+inline PhoneticIndex gNames;
+
+inline MemRegister gNamesMem(MEM_SHARED, "name index (phonetic)", [] {
+    size_t b = mem_hash(gNames.buckets);
+    for (const auto& kv : gNames.buckets) {
+        b += mem_string(kv.first) + mem_vector(kv.second);
+        for (const PhoneticEntry& e : kv.second) b += mem_string(e.name);
+    }
+    return b;
+});
+
+// ---------------------------------------------------------------------------
+// warn_possible_duplicates()
+// ---------------------------------------------------------------------------
+// Purpose : Called when a name is entered: list the stored names that sound
+//           the same, so the user can check for a duplicate record.
+// Return  : true if at least one was found.
+// ---------------------------------------------------------------------------
+inline bool warn_possible_duplicates(const string& name) {
+    const vector<PhoneticEntry>* b = gNames.find(name);
+    if (!b) return false;
+    cout << "[Warn] Possible duplicate of:";
+    for (size_t i = 0; i < b->size(); ++i) {
+        const PhoneticEntry& e = (*b)[i];
+        cout << (i ? ", " : " ") << '"' << e.name << "\" ("
+             << (e.role == EV_PATIENTS ? "waiting patient" : "emergency case");
+        if (e.count > 1) cout << " x" << e.count;
+        cout << ")";
+    }
+    cout << "\n";
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// dedupe_cli()
+// ---------------------------------------------------------------------------
+// Purpose : "--dedupe FILE": group the names of an archive (one per line)
+//           by phonetic key and print every group with more than one
+//           record, largest first:
+//             <key> TAB <records> TAB <line>:<name> | <line>:<name> ...
+//           A summary goes to cerr.
+// Method  : Two parallel passes over T = hardware threads:
+//   1) each thread computes the keys of one slice of the lines and sorts
+//      the line numbers into T partitions by hash(key);
+//   2) each thread groups the lines of one partition with its own hash
+//      map, so no map is shared and nothing is locked.
+// Return  : process exit code.
+// ---------------------------------------------------------------------------
+inline int dedupe_cli(const string& file) {
+    ifstream in(file);
+    if (!in) {
+        cerr << "[Error] Cannot open " << file << ".\n";
+        return 1;
+    }
+    vector<string> names;
+    string s;
+    while (getline(in, s)) {
+        if (!s.empty() && s.back() == '\r') s.pop_back();
+        names.push_back(s);
+    }
+    auto t0 = chrono::steady_clock::now();
+
+    const size_t n = names.size();
+    int T = (int)thread::hardware_concurrency();
+    if (T < 1) T = 1;
+    if ((size_t)T > n / 1024 + 1) T = (int)(n / 1024 + 1);   // small files
+
+    vector<string> keys(n);
+    vector<vector<vector<uint32_t> > > part(T, vector<vector<uint32_t> >(T));
+    vector<thread> pool;
+    for (int t = 0; t < T; ++t) {
+        pool.emplace_back([&, t] {
+            size_t lo = n * t / T, hi = n * (t + 1) / T;
+            hash<string> h;
+            for (size_t i = lo; i < hi; ++i) {
+                keys[i] = phonetic_key(names[i]);
+                if (!keys[i].empty()) part[t][h(keys[i]) % T].push_back((uint32_t)i);
+            }
+        });
+    }
+    for (thread& th : pool) th.join();
+    pool.clear();
+
+    vector<vector<vector<uint32_t> > > groups(T);
+    for (int t = 0; t < T; ++t) {
+        pool.emplace_back([&, t] {
+            unordered_map<string, vector<uint32_t> > byKey;
+            for (int src = 0; src < T; ++src)        // slices in line order
+                for (uint32_t i : part[src][t]) byKey[keys[i]].push_back(i);
+            for (auto& g : byKey)
+                if (g.second.size() > 1) groups[t].push_back(move(g.second));
+        });
+    }
+    for (thread& th : pool) th.join();
+
+    vector<vector<uint32_t> > all;
+    for (auto& g : groups)
+        for (auto& v : g) all.push_back(move(v));
+    sort(all.begin(), all.end(), [](const vector<uint32_t>& a, const vector<uint32_t>& b) {
+        return a.size() != b.size() ? a.size() > b.size() : a[0] < b[0];
+    });
+    auto ms = chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - t0).count();
+
+    size_t dups = 0;
+    for (const auto& g : all) {
+        dups += g.size() - 1;
+        cout << keys[g[0]] << '\t' << g.size() << '\t';
+        for (size_t k = 0; k < g.size(); ++k)
+            cout << (k ? " | " : "") << (g[k] + 1) << ':' << names[g[k]];
+        cout << '\n';
+    }
+    cerr << "[Dedupe] " << n << " name(s), " << all.size() << " group(s), "
+         << dups << " likely duplicate(s); " << T << " thread(s), "
+         << ms << " ms\n";
+    return 0;
+}
+
+#endif
@@ -0,0 +1,379 @@
+#ifndef PLANNER_HPP
+#define PLANNER_HPP
+
+#include "utils.hpp"
+#include "events.hpp"   // event_clock_ns() (coarse monotonic clock)
+#include "memory.hpp"   // accounting
+#include <cmath>        // for exp, log
+
+// ---------------------------------------------------------------------------
+// planner.hpp
+// ---------------------------------------------------------------------------
+// Capacity planner: predicted waits of the patient queue and the emergency
+// queue for different numbers of staff, from what the queues actually do.
+//
+// Model: M/M/c (Poisson arrivals, exponential service, c staff, one queue).
+// Per queue, rolling sums over the last PLAN_WINDOW_SEC seconds give
+//   lambda = arrivals per second
+//   mu     = service starts per second while someone was waiting, per staff
+//            member (with a backlog every staff member is busy, so service
+//            starts then come at c * mu; c = staff on duty, see below)
+// and for c staff, with a = lambda / mu and rho = a / c < 1:
+//   B(c)     Erlang B by the recursion B(0) = 1, B(k) = a B / (k + a B)
+//   C(c)     = B / (1 - rho (1 - B))          probability of waiting
+//   mean     = C / (c mu - lambda)
+//   P(W > t) = C exp(-(c mu - lambda) t), so the p90 wait is
+//              ln(C / 0.1) / (c mu - lambda) if C > 0.1, else 0.
+// For the emergency queue, served by priority, the mean is the same as
+// first-come-first-served but the p90 is that of all cases together:
+// critical cases wait less and low-priority cases more.
+//
+// Counting: an event bus listener (events.hpp) calls plan_event() for
+// every published insert or remove of a patient or emergency, which adds to the current PLAN_BUCKET_SEC bucket of a ring and to
+// the rolling sums; a bucket that leaves the window is subtracted: O(1) per
+// change. The predictions are recomputed from the sums when shown, at most
+// every PLAN_REFRESH_SEC seconds.
+//
+// Staff on duty per queue are entered by the manager and kept in
+// STAFF_FILE ("<queue> <staff>" per line, 1 if not set).
+// Single writer (the menu thread).
+// ---------------------------------------------------------------------------
+
+#define STAFF_FILE "staffing.txt"
+
+const int    PLAN_BUCKET_SEC  = 10;     // width of one bucket
+const int    PLAN_BUCKETS     = 360;    // window = PLAN_BUCKETS * PLAN_BUCKET_SEC
+const int    PLAN_WINDOW_SEC  = PLAN_BUCKETS * PLAN_BUCKET_SEC;
+const int    PLAN_REFRESH_SEC = 5;
+const int    PLAN_MIN_EVENTS  = 5;      // arrivals and services before predicting
+const int    PLAN_EXTRA_STAFF = 3;      // levels shown above the current one
+const double PLAN_P90_TAIL    = 0.1;
+
+enum PlanQueue { PLAN_PATIENTS, PLAN_EMERGENCIES, PLAN_QUEUES };
+
+inline const char* plan_queue_name(int q) {
+    static const char* names[] = { "patients", "emergencies" };
+    return (q >= 0 && q < PLAN_QUEUES) ? names[q] : "?";
+}
+
+// Prediction for one staffing level
+struct PlanLevel {
+    int    staff;
+    double util;      // rho
+    bool   stable;    // rho < 1, else the queue grows without bound
+    double pWait;     // C(c)
+    double meanSec;
+    double p90Sec;
+};
+
+// ---------------------------------------------------------------------------
+// PlanSeries
+// ---------------------------------------------------------------------------
+struct PlanSeries {
+    struct Bucket {
+        long long slot = -1;    // bucket number (time / PLAN_BUCKET_SEC)
+        long long arrivals = 0, served = 0;
+        double    backlogSec = 0;
+    };
+    Bucket ring[PLAN_BUCKETS];
+    long long arrivals = 0, served = 0;   // sums over the window
+    double    backlogSec = 0;
+
+    int       waiting = -1;     // queue length after the last change (-1 = none yet)
+    long long lastNs  = 0;
+    long long firstNs = 0;
+    int       staff   = 1;
+
+    // Predictions, see refresh()
+    long long computedNs = -1;
+    double    lambda = 0, mu = 0;
+    PlanLevel level[PLAN_EXTRA_STAFF + 2];
+    int       levels = 0;
+
+    Bucket& bucketAt(long long ns) {
+        long long slot = ns / (PLAN_BUCKET_SEC * 1000000000LL);
+        Bucket& b = ring[slot % PLAN_BUCKETS];
+        if (b.slot != slot) {                    // reused: drop what it held
+            arrivals   -= b.arrivals;
+            served     -= b.served;
+            backlogSec -= b.backlogSec;
+            b = Bucket();
+            b.slot = slot;
+        }
+        return b;
+    }
+
+    // ----------------------------------------------------------------------
+    // add()
+    // ----------------------------------------------------------------------
+    // Purpose : Record a change of the queue: `arr` arrivals and `srv`
+    //           service starts, leaving `now` waiting. The time since the
+    //           last change counts as backlog if someone was waiting.
+    // Note    : Backlog time is booked to the bucket of this change, so a
+    //           long wait spanning buckets lands in the newest one.
+    // ----------------------------------------------------------------------
+    void add(int arr, int srv, int now, long long ns) {
+        Bucket& b = bucketAt(ns);
+        if (waiting < 0) {
+            firstNs = ns;
+        } else if (waiting > 0) {
+            double sec = (ns - lastNs) / 1e9;
+            b.backlogSec += sec;
+            backlogSec   += sec;
+        }
+        b.arrivals += arr;  arrivals += arr;
+        b.served   += srv;  served   += srv;
+        waiting = now;
+        lastNs  = ns;
+    }
+
+    // Drop the buckets that have left the window by now
+    void expire(long long ns) {
+        long long slot = ns / (PLAN_BUCKET_SEC * 1000000000LL);
+        for (Bucket& b : ring) {
+            if (b.slot < 0 || b.slot > slot - PLAN_BUCKETS) continue;
+            arrivals   -= b.arrivals;
+            served     -= b.served;
+            backlogSec -= b.backlogSec;
+            b = Bucket();
+        }
+    }
+
+    // ----------------------------------------------------------------------
+    // refresh()
+    // ----------------------------------------------------------------------
+    // Purpose : Recompute lambda, mu and the predictions for staff - 1 up
+    //           to staff + PLAN_EXTRA_STAFF, unless done less than
+    //           PLAN_REFRESH_SEC seconds ago.
+    // Return  : false if there is not enough data yet.
+    // ----------------------------------------------------------------------
+    bool refresh(long long ns, bool force = false) {
+        if (!force && computedNs >= 0 && ns - computedNs < PLAN_REFRESH_SEC * 1000000000LL)
+            return levels > 0;
+        computedNs = ns;
+        levels = 0;
+        expire(ns);
+        double span = min((double)PLAN_WINDOW_SEC, (ns - firstNs) / 1e9);
+        double backlog = backlogSec;
+        if (waiting > 0) backlog += (ns - lastNs) / 1e9;   // still waiting now
+        if (waiting < 0 || arrivals < PLAN_MIN_EVENTS || served < PLAN_MIN_EVENTS ||
+            span <= 0 || backlog <= 0)
+            return false;
+        lambda = arrivals / span;
+        mu     = served / (backlog * staff);
+        double a = lambda / mu;
+        double B = 1;
+        int lo = max(1, staff - 1);
+        for (int c = 1; c <= staff + PLAN_EXTRA_STAFF; ++c) {
+            B = a * B / (c + a * B);
+            if (c < lo) continue;
+            PlanLevel& L = level[levels++];
+            L.staff  = c;
+            L.util   = a / c;
+            L.stable = L.util < 1;
+            if (!L.stable) continue;
+            double C    = B / (1 - L.util * (1 - B));
+            double rate = c * mu - lambda;
+            L.pWait   = C;
+            L.meanSec = C / rate;
+            L.p90Sec  = C > PLAN_P90_TAIL ? log(C / PLAN_P90_TAIL) / rate : 0;
+        }
+        return true;
+    }
+};
+
+struct Planner {
+    PlanSeries queue[PLAN_QUEUES];
+    bool staffRead = false;
+};
+
+// Rolling counters of this process (C++17 inline variable)
+inline Planner gPlanner;
+
+inline MemRegister gPlannerMem(MEM_SHARED, "capacity planner counters",
+                               [] { return sizeof(gPlanner); });
+
+inline void plan_load_staff() {
+    gPlanner.staffRead = true;
+    ifstream in(STAFF_FILE);
+    string name;
+    int n;
+    while (in >> name >> n) {
+        for (int q = 0; q < PLAN_QUEUES; ++q)
+            if (name == plan_queue_name(q) && n >= 1) gPlanner.queue[q].staff = n;
+    }
+}
+
+inline void plan_save_staff() {
+    ofstream out(STAFF_FILE);
+    if (!out) {
+        cout << "[Error] Cannot open " << STAFF_FILE << " for writing.\n";
+        return;
+    }
+    for (int q = 0; q < PLAN_QUEUES; ++q)
+        out << plan_queue_name(q) << ' ' << gPlanner.queue[q].staff << '\n';
+}
+
+// ---------------------------------------------------------------------------
+// plan_event()
+// ---------------------------------------------------------------------------
+// Purpose : Called by the listener below after a queue changed: `arrivals` new entries, `served` entries taken out to
+//           be seen (discharge, most critical case, dispatch), `waiting` =
+//           queue length now. Transfers pass 0 and 0 with the new length.
+// ---------------------------------------------------------------------------
+inline void plan_event(PlanQueue q, int arrivals, int served, int waiting) {
+    gPlanner.queue[q].add(arrivals, served, waiting, event_clock_ns());
+}
+
+// Queue lengths, registered by the role modules (as MemRegister), e.g.
+//   inline PlanRegister gPatientsPlan(PLAN_PATIENTS, [] { return n; });
+inline int (*gPlanLength[PLAN_QUEUES])() = {};
+
+struct PlanRegister {
+    PlanRegister(PlanQueue q, int (*length)()) { gPlanLength[q] = length; }
+};
+
+// Inserts are arrivals and removes services, except transfers (an imported
+// backlog, an escalated patient) which only change the length
+inline EventListen gPlannerListen([](const Event& ev, const string&, const string&) {
+    if (ev.kind == EV_UPDATE) return;
+    PlanQueue q;
+    if      (ev.role == EV_PATIENTS)    q = PLAN_PATIENTS;
+    else if (ev.role == EV_EMERGENCIES) q = PLAN_EMERGENCIES;
+    else return;
+    if (!gPlanLength[q]) return;
+    bool counted = !(ev.flags & EVF_TRANSFER);
+    plan_event(q, counted && ev.kind == EV_INSERT, counted && ev.kind == EV_REMOVE,
+               gPlanLength[q]());
+});
+
+// ====================== UI FUNCTIONS ======================================
+
+// Wait in minutes, or seconds when short
+inline string plan_wait_str(double sec) {
+    char buf[32];
+    if (sec < 60) snprintf(buf, sizeof buf, "%.0f s", sec);
+    else          snprintf(buf, sizeof buf, "%.1f min", sec / 60);
+    return buf;
+}
+
+// --------------------------------------------------------------------------
+// print_plan()
+// --------------------------------------------------------------------------
+// Purpose : Show, per queue, the observed rates and the predicted waits for
+//           each staffing level, and what one more staff member changes.
+// --------------------------------------------------------------------------
+inline void print_plan() {
+    if (!gPlanner.staffRead) plan_load_staff();
+    long long ns = event_clock_ns();
+    line('=');
+    cout << "CAPACITY PLANNER (M/M/c, last " << PLAN_WINDOW_SEC / 60 << " min)\n";
+    line('=');
+    for (int q = 0; q < PLAN_QUEUES; ++q) {
+        PlanSeries& s = gPlanner.queue[q];
+        cout << plan_queue_name(q) << ": " << s.staff << " staff on duty";
+        if (s.waiting >= 0) cout << ", " << s.waiting << " waiting";
+        cout << "\n";
+        if (!s.refresh(ns)) {
+            cout << "  Not enough data yet (needs " << PLAN_MIN_EVENTS
+                 << " arrivals and " << PLAN_MIN_EVENTS
+                 << " served while others waited, in the window).\n";
+            continue;
+        }
+        cout << fixed << setprecision(1)
+             << "  arrivals " << s.lambda * 3600 << "/h, served "
+             << s.mu * 3600 << "/h per staff member\n";
+        cout << "  " << left << setw(7) << "Staff" << right << setw(7) << "Util"
+             << setw(9) << "P(wait)" << setw(12) << "Mean wait" << setw(12)
+             << "p90 wait" << "\n";
+        const PlanLevel* cur = nullptr;
+        const PlanLevel* more = nullptr;
+        for (int i = 0; i < s.levels; ++i) {
+            const PlanLevel& L = s.level[i];
+            if (L.staff == s.staff) cur = &L;
+            if (L.staff == s.staff + 1) more = &L;
+            cout << "  " << left << setw(7) << L.staff << right << setw(6)
+                 << setprecision(0) << L.util * 100 << "%";
+            if (!L.stable) {
+                cout << "   queue keeps growing\n";
+                continue;
+            }
+            cout << setw(9) << setprecision(2) << L.pWait << setw(12)
+                 << plan_wait_str(L.meanSec) << setw(12) << plan_wait_str(L.p90Sec)
+                 << (L.staff == s.staff ? "  <- now" : "") << "\n";
+        }
+        if (more && more->stable) {
+            cout << "  One more staff member: p90 wait ";
+            if (cur && cur->stable) cout << plan_wait_str(cur->p90Sec) << " -> ";
+            else                    cout << "unbounded -> ";
+            cout << plan_wait_str(more->p90Sec) << ".\n";
+        }
+        cout.unsetf(ios::floatfield);
+        cout << left;
+    }
+}
+
+// --------------------------------------------------------------------------
+// ui_set_staff()
+// --------------------------------------------------------------------------
+// Purpose : Ask for a queue and the number of staff on duty for it.
+// --------------------------------------------------------------------------
+inline void ui_set_staff() {
+    if (!gPlanner.staffRead) plan_load_staff();
+    int q, n;
+    cout << "Queue (1 patients, 2 emergencies): ";
+    if (!(cin >> q) || q < 1 || q > PLAN_QUEUES) {
+        if (!cin.eof()) cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Invalid queue.\n";
+        return;
+    }
+    cout << "Staff on duty (>= 1): ";
+    if (!(cin >> n) || n < 1) {
+        if (!cin.eof()) cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Invalid number.\n";
+        return;
+    }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    PlanSeries& s = gPlanner.queue[q - 1];
+    s.staff = n;
+    s.computedNs = -1;          // predictions depend on it
+    plan_save_staff();
+    cout << "Staff on duty for " << plan_queue_name(q - 1) << ": " << n << ".\n";
+}
+
+// --------------------------------------------------------------------------
+// menu_planner()
+// --------------------------------------------------------------------------
+// Options :
+//   1) View Predicted Waits
+//   2) Set Staff on Duty
+//   0) Back
+// --------------------------------------------------------------------------
+inline void menu_planner() {
+    while (true) {
+        line('=');
+        cout << "CAPACITY PLANNER\n";
+        line('=');
+        cout << "1) View Predicted Waits\n";
+        cout << "2) Set Staff on Duty\n";
+        cout << "0) Back\n> ";
+
+        int ch;
+        if (!(cin >> ch)) {
+            if (cin.eof()) return;
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            continue;
+        }
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+        if (ch == 0) break;
+        else if (ch == 1) print_plan();
+        else if (ch == 2) ui_set_staff();
+        else cout << "Invalid choice.\n";
+    }
+}
+
+#endif
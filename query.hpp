@@ -0,0 +1,548 @@
+#ifndef QUERY_HPP
+#define QUERY_HPP
+
+#include "utils.hpp"
+#include "patient.hpp"
+#include "supply.hpp"
+#include "emergency.hpp"
+#include "ambulance.hpp"
+#include <vector>
+#include <algorithm>  // for stable_sort (emergencies, most critical first)
+#include <cctype>     // for isalpha/isdigit/tolower (tokenizer)
+
+// ---------------------------------------------------------------------------
+// query.hpp
+// ---------------------------------------------------------------------------
+// A small query language for ad-hoc lookups over the four role containers,
+// so questions beyond "print all" need no code changes:
+//
+//   patients where condition = "Flu"
+//   patients where id = P002
+//   emergencies where priority >= 8 limit 5
+//   supplies where type ~ glove and quantity < 50
+//
+// Syntax (keywords are case-insensitive):
+//   <table> [where <cond> {and <cond>}] [limit <n>]
+//   <cond>  = <field> <op> <value>
+//   <op>    = "=" "!=" "<" "<=" ">" ">=" on numbers,
+//             "=" "!=" (exact) and "~" (contains, any case) on text
+//   <value> = number, "quoted text" or a single word
+//
+// Tables and fields:
+//   patients    : id, name, condition, room (1 = main queue, 2 = room 2)
+//   supplies    : type, quantity, batch          (top of the stack first)
+//   emergencies : patient, type, priority, id    (most critical first; id =
+//                                                 escalated patient's ID)
+//   ambulances  : plate, position                (next up first)
+//
+// Planner: uses the indexes that exist and otherwise scans:
+//   - patients with "id = X"        -> gPatientIndex lookup, O(1)
+//   - patients with "room = 1|2"    -> scans only that room's queue
+//   - emergencies with a lower bound on priority (>=, >, =) -> walks the
+//     priority queue and skips every subtree below the bound
+//   - everything else               -> scan
+// Scans are vectorized: rows are gathered QUERY_BATCH at a time into
+// column arrays, and each condition filters the whole batch in one tight
+// loop over a selection vector, instead of interpreting every condition
+// once per row.
+//
+// Used from the main menu ("Query") and in batch mode:
+//   main --query "emergencies where priority >= 8"
+//   main --batch FILE      (one query per line, "-" = stdin)
+// ---------------------------------------------------------------------------
+
+const int QUERY_BATCH    = 64;
+const int QUERY_MAX_COLS = 4;
+
+enum QueryOp { Q_EQ, Q_NE, Q_LT, Q_LE, Q_GT, Q_GE, Q_LIKE };
+
+struct QueryTable {
+    const char* name;
+    int ncols;
+    const char* cols[QUERY_MAX_COLS];
+    bool numeric[QUERY_MAX_COLS];
+};
+
+const QueryTable QUERY_TABLES[] = {
+    { "patients",    4, { "id", "name", "condition", "room" },  { false, false, false, true } },
+    { "supplies",    3, { "type", "quantity", "batch" },        { false, true, false } },
+    { "emergencies", 4, { "patient", "type", "priority", "id" }, { false, false, true, false } },
+    { "ambulances",  2, { "plate", "position" },                 { false, true } },
+};
+
+struct QueryCond {
+    int col;
+    QueryOp op;
+    string text;       // value for text fields
+    long long num;     // value for number fields
+};
+
+struct Query {
+    const QueryTable* table = nullptr;
+    vector<QueryCond> conds;
+    long long limit = -1;   // -1 = no limit
+};
+
+// One batch of rows in column form. Number columns use num[], text
+// columns use str[] (pointers into the containers' string pools).
+struct QueryBatch {
+    int n = 0;
+    const char* str[QUERY_MAX_COLS][QUERY_BATCH];
+    long long   num[QUERY_MAX_COLS][QUERY_BATCH];
+};
+
+// A result row (same column layout as the batch)
+struct QueryRow {
+    const char* str[QUERY_MAX_COLS];
+    long long   num[QUERY_MAX_COLS];
+};
+
+// ------------------------------- parsing -----------------------------------
+
+inline bool query_same_word(const string& a, const char* b) {
+    size_t n = strlen(b);
+    if (a.size() != n) return false;
+    for (size_t i = 0; i < n; ++i)
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    return true;
+}
+
+// Split a query into words, numbers, quoted strings and operators.
+// Quoted strings keep a leading '"' so they are never taken as keywords.
+inline bool query_tokenize(const string& s, vector<string>& out) {
+    size_t i = 0;
+    while (i < s.size()) {
+        char c = s[i];
+        if (isspace((unsigned char)c)) { i++; continue; }
+        if (c == '"' || c == '\'') {
+            size_t j = s.find(c, i + 1);
+            if (j == string::npos) {
+                cout << "[Error] Missing closing quote.\n";
+                return false;
+            }
+            out.push_back('"' + s.substr(i + 1, j - i - 1));
+            i = j + 1;
+        } else if (strchr("=!<>~", c)) {
+            size_t j = i + 1;
+            if (j < s.size() && s[j] == '=') j++;
+            out.push_back(s.substr(i, j - i));
+            i = j;
+        } else {
+            size_t j = i;
+            while (j < s.size() && !isspace((unsigned char)s[j]) && !strchr("=!<>~\"'", s[j]))
+                j++;
+            out.push_back(s.substr(i, j - i));
+            i = j;
+        }
+    }
+    return true;
+}
+
+inline bool query_number(const string& tok, long long& v) {
+    if (tok.empty() || tok[0] == '"') return false;
+    char* end;
+    v = strtoll(tok.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+// ---------------------------------------------------------------------------
+// query_parse()
+// ---------------------------------------------------------------------------
+// Purpose : Turn the text of a query into a Query.
+// Return  : false (after printing an [Error] line) if the text is invalid.
+// ---------------------------------------------------------------------------
+inline bool query_parse(const string& text, Query& q) {
+    vector<string> t;
+    if (!query_tokenize(text, t)) return false;
+    if (t.empty()) {
+        cout << "[Error] Empty query.\n";
+        return false;
+    }
+
+    for (const QueryTable& tab : QUERY_TABLES)
+        if (query_same_word(t[0], tab.name)) q.table = &tab;
+    if (!q.table) {
+        cout << "[Error] Unknown table '" << t[0]
+             << "' (patients, supplies, emergencies, ambulances).\n";
+        return false;
+    }
+
+    size_t i = 1;
+    if (i < t.size() && query_same_word(t[i], "where")) {
+        do {
+            i++;
+            if (i + 2 >= t.size()) {
+                cout << "[Error] Incomplete condition.\n";
+                return false;
+            }
+            QueryCond c;
+            c.col = -1;
+            for (int k = 0; k < q.table->ncols; ++k)
+                if (query_same_word(t[i], q.table->cols[k])) c.col = k;
+            if (c.col < 0) {
+                cout << "[Error] Unknown field '" << t[i] << "' for "
+                     << q.table->name << ".\n";
+                return false;
+            }
+            const string& op = t[i + 1];
+            if      (op == "=" || op == "==")  c.op = Q_EQ;
+            else if (op == "!=")               c.op = Q_NE;
+            else if (op == "<")                c.op = Q_LT;
+            else if (op == "<=")               c.op = Q_LE;
+            else if (op == ">")                c.op = Q_GT;
+            else if (op == ">=")               c.op = Q_GE;
+            else if (op == "~")                c.op = Q_LIKE;
+            else {
+                cout << "[Error] Unknown operator '" << op << "'.\n";
+                return false;
+            }
+            const string& val = t[i + 2];
+            if (q.table->numeric[c.col]) {
+                if (c.op == Q_LIKE || !query_number(val, c.num)) {
+                    cout << "[Error] Field '" << q.table->cols[c.col]
+                         << "' needs a number and = != < <= > >=.\n";
+                    return false;
+                }
+            } else {
+                if (c.op != Q_EQ && c.op != Q_NE && c.op != Q_LIKE) {
+                    cout << "[Error] Field '" << q.table->cols[c.col]
+                         << "' is text: use =, != or ~.\n";
+                    return false;
+                }
+                c.text = (val[0] == '"') ? val.substr(1) : val;
+            }
+            q.conds.push_back(c);
+            i += 3;
+        } while (i < t.size() && query_same_word(t[i], "and"));
+    }
+
+    if (i < t.size() && query_same_word(t[i], "limit")) {
+        if (i + 1 >= t.size() || !query_number(t[i + 1], q.limit) || q.limit < 0) {
+            cout << "[Error] limit needs a number >= 0.\n";
+            return false;
+        }
+        i += 2;
+    }
+    if (i < t.size()) {
+        cout << "[Error] Unexpected '" << t[i] << "'.\n";
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------- execution ---------------------------------
+
+// Case-insensitive "needle occurs in hay"
+inline bool query_contains(const char* hay, const string& needle) {
+    size_t n = needle.size();
+    for (const char* h = hay; ; ++h) {
+        size_t k = 0;
+        while (k < n && h[k] &&
+               tolower((unsigned char)h[k]) == tolower((unsigned char)needle[k]))
+            k++;
+        if (k == n) return true;
+        if (!*h) return false;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// query_filter()
+// ---------------------------------------------------------------------------
+// Purpose : Keep only the rows of sel[0..m-1] (indices into batch b) that
+//           satisfy c. Each case is one tight loop over a single column;
+//           the number comparisons are branch-free so the compiler can
+//           vectorize them.
+// Return  : the new number of selected rows.
+// ---------------------------------------------------------------------------
+inline int query_filter(const QueryCond& c, bool numeric, const QueryBatch& b,
+                        int* sel, int m) {
+    int out = 0;
+    if (numeric) {
+        const long long* col = b.num[c.col];
+        const long long v = c.num;
+        switch (c.op) {
+        case Q_EQ: for (int k = 0; k < m; ++k) { int r = sel[k]; sel[out] = r; out += col[r] == v; } break;
+        case Q_NE: for (int k = 0; k < m; ++k) { int r = sel[k]; sel[out] = r; out += col[r] != v; } break;
+        case Q_LT: for (int k = 0; k < m; ++k) { int r = sel[k]; sel[out] = r; out += col[r] <  v; } break;
+        case Q_LE: for (int k = 0; k < m; ++k) { int r = sel[k]; sel[out] = r; out += col[r] <= v; } break;
+        case Q_GT: for (int k = 0; k < m; ++k) { int r = sel[k]; sel[out] = r; out += col[r] >  v; } break;
+        case Q_GE: for (int k = 0; k < m; ++k) { int r = sel[k]; sel[out] = r; out += col[r] >= v; } break;
+        default: break;
+        }
+        return out;
+    }
+
+    const char* const* col = b.str[c.col];
+    const char* v = c.text.c_str();
+    switch (c.op) {
+    case Q_EQ: for (int k = 0; k < m; ++k) { int r = sel[k]; sel[out] = r; out += strcmp(col[r], v) == 0; } break;
+    case Q_NE: for (int k = 0; k < m; ++k) { int r = sel[k]; sel[out] = r; out += strcmp(col[r], v) != 0; } break;
+    case Q_LIKE:
+        for (int k = 0; k < m; ++k) {
+            int r = sel[k];
+            sel[out] = r;
+            out += query_contains(col[r], c.text);
+        }
+        break;
+    default: break;
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// QueryRun
+// ---------------------------------------------------------------------------
+// Runs one parsed query: the table scans below push rows with add(), full
+// batches are filtered, and the surviving rows are collected in `rows`.
+// ---------------------------------------------------------------------------
+struct QueryRun {
+    const Query& q;
+    QueryBatch batch;
+    vector<QueryRow> rows;
+    long long scanned = 0;     // rows looked at
+    bool keepAll;              // rows are sorted after the scan, so the
+                               // limit can only be applied at the end
+
+    QueryRun(const Query& query, bool sortedLater)
+        : q(query), keepAll(sortedLater) {}
+
+    // Limit reached: the scans stop early
+
+    bool full() const {
+        return !keepAll && q.limit >= 0 && (long long)rows.size() >= q.limit;
+    }
+
+    // Row slot to fill in the current batch (flushes a full batch first)
+    int add() {
+        if (batch.n == QUERY_BATCH) flush();
+        scanned++;
+        return batch.n++;
+    }
+
+    // Filter the gathered batch and keep the rows that pass
+    void flush() {
+        int sel[QUERY_BATCH];
+        int m = batch.n;
+        for (int k = 0; k < m; ++k) sel[k] = k;
+        for (const QueryCond& c : q.conds)
+            m = query_filter(c, q.table->numeric[c.col], batch, sel, m);
+        for (int k = 0; k < m && !full(); ++k) {
+            QueryRow row;
+            for (int c = 0; c < q.table->ncols; ++c) {
+                row.str[c] = batch.str[c][sel[k]];
+                row.num[c] = batch.num[c][sel[k]];
+            }
+            rows.push_back(row);
+        }
+        batch.n = 0;
+    }
+};
+
+// ------------------------------ table scans --------------------------------
+
+// Add one patient as a row (columns: id, name, condition, room)
+inline void query_add_patient(QueryRun& run, const PatientQueue& q,
+                              const Patient& p, int room) {
+    int r = run.add();
+    run.batch.str[0][r] = q.str(p.id);
+    run.batch.str[1][r] = q.str(p.name);
+    run.batch.str[2][r] = q.str(p.condition);
+    run.batch.num[3][r] = room;
+}
+
+inline void query_scan_room(QueryRun& run, const PatientQueue& q, int room) {
+    for (PatientChunk* c = q.head; c && !run.full(); c = c->next)
+        for (int i = c->begin; i < c->end; ++i)
+            query_add_patient(run, q, c->slot[i], room);
+}
+
+inline string query_plan_patients(const Query& q, QueryRun& run) {
+    for (const QueryCond& c : q.conds) {
+        if (c.col == 0 && c.op == Q_EQ) {
+            auto it = gPatientIndex.find(c.text);
+            if (it != gPatientIndex.end()) {
+                const PatientQueue* owner = it->second.chunk->owner;
+                query_add_patient(run, *owner,
+                                  it->second.chunk->slot[it->second.slot],
+                                  owner == &gPatientsRoom2 ? 2 : 1);
+            }
+            return "index lookup on id (gPatientIndex)";
+        }
+    }
+    for (const QueryCond& c : q.conds) {
+        if (c.col == 3 && c.op == Q_EQ && (c.num == 1 || c.num == 2)) {
+            query_scan_room(run, c.num == 1 ? gPatients : gPatientsRoom2, (int)c.num);
+            return "scan of room " + to_string(c.num) + " queue only";
+        }
+    }
+    query_scan_room(run, gPatients, 1);
+    query_scan_room(run, gPatientsRoom2, 2);
+    return "scan";
+}
+
+inline string query_plan_supplies(QueryRun& run) {
+    for (int i = gSupplies.top; i >= 0 && !run.full(); --i) {
+        const Supply& s = gSupplies.data[i];
+        int r = run.add();
+        run.batch.str[0][r] = gSupplies.str(s.type);
+        run.batch.num[1][r] = s.quantity;
+        run.batch.str[2][r] = gSupplies.str(s.batch);
+    }
+    return "scan";
+}
+
+inline string query_plan_emergencies(const Query& q, QueryRun& run) {
+    // Lower bound on priority from the conditions, if any
+    bool bounded = false;
+    long long lo = 0;
+    for (const QueryCond& c : q.conds) {
+        if (c.col != 2) continue;
+        long long b;
+        if      (c.op == Q_GE || c.op == Q_EQ) b = c.num;
+        else if (c.op == Q_GT)                 b = c.num + 1;
+        else continue;
+        if (!bounded || b > lo) lo = b;
+        bounded = true;
+    }
+
+    auto addCase = [&](const EmergencyCase& e) {
+        int r = run.add();
+        run.batch.str[0][r] = gEmerg.str(e.patient);
+        run.batch.str[1][r] = gEmerg.str(e.type);
+        run.batch.num[2][r] = e.priority;
+        run.batch.str[3][r] = gEmerg.str(e.patientId);
+    };
+    if (bounded) {
+        int from = (int)max(min(lo, (long long)numeric_limits<int>::max()),
+                            (long long)numeric_limits<int>::min());
+        gEmerg.forEachAtLeast(from, addCase);
+        return "pruned walk of the priority queue (priority >= " + to_string(from) + ")";
+    }
+    gEmerg.forEach(addCase);
+    return "scan";
+}
+
+inline string query_plan_ambulances(QueryRun& run) {
+    for (int i = 0; i < gAmb.count && !run.full(); ++i) {
+        int r = run.add();
+        run.batch.str[0][r] = gAmb.data[(gAmb.head + i) % MAX_AMBULANCES].plate;
+        run.batch.num[1][r] = i;
+    }
+    return "scan";
+}
+
+// ---------------------------------------------------------------------------
+// run_query()
+// ---------------------------------------------------------------------------
+// Purpose : Parse, plan and run one query, then print the result table
+//           and a one-line summary with the plan that was used.
+// Return  : false if the query text is invalid.
+// ---------------------------------------------------------------------------
+inline bool run_query(const string& text) {
+    Query q;
+    if (!query_parse(text, q)) return false;
+
+    bool isEmerg = (q.table == &QUERY_TABLES[2]);
+    QueryRun run(q, isEmerg);
+    string plan;
+    if      (q.table == &QUERY_TABLES[0]) plan = query_plan_patients(q, run);
+    else if (q.table == &QUERY_TABLES[1]) plan = query_plan_supplies(run);
+    else if (isEmerg)                     plan = query_plan_emergencies(q, run);
+    else                                  plan = query_plan_ambulances(run);
+    run.flush();
+
+    // Emergencies come out most critical first, like the queue serves them
+    if (isEmerg) {
+        stable_sort(run.rows.begin(), run.rows.end(),
+                    [](const QueryRow& a, const QueryRow& b) { return a.num[2] > b.num[2]; });
+        if (q.limit >= 0 && (long long)run.rows.size() > q.limit)
+            run.rows.resize((size_t)q.limit);
+    }
+
+    const QueryTable& t = *q.table;
+    for (int c = 0; c < t.ncols; ++c)
+        cout << left << setw(c == 1 ? 24 : 16) << t.cols[c] << ' ';
+    cout << "\n";
+    line();
+    for (const QueryRow& row : run.rows) {
+        for (int c = 0; c < t.ncols; ++c) {
+            cout << left << setw(c == 1 ? 24 : 16);
+            if (t.numeric[c]) cout << row.num[c];
+            else              cout << row.str[c];
+            cout << ' ';      // keeps long values apart
+        }
+        cout << "\n";
+    }
+    cout << "(" << run.rows.size() << " row(s); plan: " << plan
+         << "; " << run.scanned << " row(s) read)\n";
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// ui_query()
+// ---------------------------------------------------------------------------
+// Purpose : Interactive query prompt (main menu). An empty line returns.
+// ---------------------------------------------------------------------------
+inline void ui_query() {
+    line('=');
+    cout << "QUERY (e.g. patients where condition = \"Flu\",\n"
+         << "       emergencies where priority >= 8 limit 5; empty line = back)\n";
+    line('=');
+    while (true) {
+        cout << "query> ";
+        string text;
+        safe_getline(text);
+        if (text.empty()) return;   // also at end of input
+        run_query(text);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// query_batch()
+// ---------------------------------------------------------------------------
+// Purpose : Batch mode: run every query in `in` (one per line; empty lines
+//           and lines starting with '#' are skipped).
+// Return  : process exit code (1 if any query was invalid).
+// ---------------------------------------------------------------------------
+inline int query_batch(istream& in) {
+    int rc = 0;
+    string text;
+    while (getline(in, text)) {
+        if (!text.empty() && text.back() == '\r') text.pop_back();
+        if (text.empty() || text[0] == '#') continue;
+        cout << "query> " << text << "\n";
+        if (!run_query(text)) rc = 1;
+        cout << "\n";
+    }
+    return rc;
+}
+
+// ---------------------------------------------------------------------------
+// query_cli()
+// ---------------------------------------------------------------------------
+// Purpose : "--query TEXT" and "--batch FILE|-": load the role files without
+//           their console messages, run the queries and exit. Nothing is
+//           written back (escalations.log is left for the next interactive
+//           run to replay).
+// Return  : process exit code.
+// ---------------------------------------------------------------------------
+inline int query_cli(const string& option, const string& arg) {
+    streambuf* saved = cout.rdbuf(nullptr);   // silence the load messages
+    load_patients_from_file();
+    load_supplies_from_file();
+    load_emergencies_from_file();
+    load_ambulances_from_file();
+    cout.rdbuf(saved);
+    cout.clear();
+
+    if (option == "--query") return run_query(arg) ? 0 : 1;
+    if (arg == "-") return query_batch(cin);
+    ifstream in(arg);
+    if (!in) {
+        cout << "[Error] Cannot open query file " << arg << ".\n";
+        return 1;
+    }
+    return query_batch(in);
+}
+
+#endif
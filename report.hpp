@@ -0,0 +1,382 @@
+#ifndef REPORT_HPP
+#define REPORT_HPP
+
+#include "utils.hpp"
+#include "cdc.hpp"      // segment files and manifest, image escaping
+#include <vector>
+#include <unordered_map>
+#include <algorithm>    // for sort (largest segment first, report rows)
+#include <atomic>       // next segment to take
+#include <chrono>       // for steady_clock (report timing)
+#include <cstdio>       // for fopen/fread (whole segments)
+#include <filesystem>   // segment sizes and ages
+#include <thread>
+
+// ---------------------------------------------------------------------------
+// report.hpp
+// ---------------------------------------------------------------------------
+// Operation reports over the change stream (cdc.hpp), which holds every
+// change of the four roles:
+//   - discharges by condition   : patients "remove" lines, except those
+//                                 directly followed by the emergency insert
+//                                 of an escalation of the same patient ID
+//                                 (also across a segment boundary, see
+//                                 ReportEdge)
+//   - supply usage by type      : supplies "remove" lines (a batch used up),
+//                                 units and batches
+//   - emergencies by priority   : cases logged ("insert") and processed
+//                                 ("remove")
+//   - dispatches per unit       : ambulances "update" lines that move a unit
+//                                 back in the rotation (rotate shift, batch
+//                                 dispatch)
+// Limits of the history (change lines carry no time):
+//   - A time range is chosen by whole segments: "last N days" takes the
+//     segments written to in the last N days (file modification time), so
+//     it may include up to one segment (CDC_SEGMENT_BYTES) of older changes.
+//   - Only the last CDC_RETAIN_BYTES of changes are kept (1 MiB by default,
+//     HOSPITAL_CDC_RETAIN_BYTES): on a busy site a monthly report needs a
+//     larger value. When the chosen period reaches back past the oldest
+//     retained segment, and older changes were deleted, the report says so.
+//
+// Map-reduce over a pool of T threads (T = hardware threads, at most one
+// per segment):
+//   map    : each thread takes the next segment (largest first, from one
+//            atomic counter), reads it in one piece and adds its lines to
+//            its own ReportAgg (hash maps), so nothing is shared or locked;
+//   reduce : the T aggregates are merged on the calling thread, then the
+//            patient removals left open at the end of a segment are settled
+//            against the first line of the next segment.
+// The map is O(bytes / T); the reduce is O(T * distinct keys + segments),
+// small next to it. See the report benchmark in bench.cpp.
+//
+//   main --report [DAYS]    print the reports (all retained history if no
+//                           DAYS) and exit; also on the main menu.
+// ---------------------------------------------------------------------------
+
+const int REPORT_MAX_PRIORITY = 100;   // priorities are clamped to 0..100
+
+// ---------------------------------------------------------------------------
+// ReportEdge
+// ---------------------------------------------------------------------------
+// The ends of one segment, for the reduce step: a patient removal on the
+// last line is a discharge unless the next segment starts with the
+// escalation of that patient, which its own map step cannot see.
+// ---------------------------------------------------------------------------
+struct ReportEdge {
+    Lsn first = 0, last = 0;   // LSNs of the first and last line
+    string headId;             // patient ID if the first line is an escalation
+    bool tail = false;         // last line is a patient removal, not counted
+    string tailId, tailCond;
+};
+
+// ---------------------------------------------------------------------------
+// ReportAgg
+// ---------------------------------------------------------------------------
+struct ReportAgg {
+    unordered_map<string, long long> discharges;      // condition -> patients
+    unordered_map<string, long long> supplyUnits;     // type -> units used
+    unordered_map<string, long long> supplyBatches;   // type -> batches used
+    unordered_map<string, long long> dispatches;      // plate -> dispatches
+    long long logged[REPORT_MAX_PRIORITY + 1] = {};
+    long long processed[REPORT_MAX_PRIORITY + 1] = {};
+    long long lines = 0, bytes = 0, segments = 0;
+    vector<ReportEdge> edges;                         // one per segment read
+
+    void merge(const ReportAgg& o) {
+        for (const auto& kv : o.discharges)    discharges[kv.first]    += kv.second;
+        for (const auto& kv : o.supplyUnits)   supplyUnits[kv.first]   += kv.second;
+        for (const auto& kv : o.supplyBatches) supplyBatches[kv.first] += kv.second;
+        for (const auto& kv : o.dispatches)    dispatches[kv.first]    += kv.second;
+        for (int p = 0; p <= REPORT_MAX_PRIORITY; ++p) {
+            logged[p]    += o.logged[p];
+            processed[p] += o.processed[p];
+        }
+        lines += o.lines;
+        bytes += o.bytes;
+        segments += o.segments;
+        edges.insert(edges.end(), o.edges.begin(), o.edges.end());
+    }
+
+    // --------------------------------------------------------------------
+    // settleEdges()
+    // --------------------------------------------------------------------
+    // Purpose : After the merge: count the removal left open at the end of
+    //           each segment as a discharge, unless the segment that
+    //           directly follows it (by LSN) was read and starts with the
+    //           escalation of the same patient.
+    // --------------------------------------------------------------------
+    void settleEdges() {
+        sort(edges.begin(), edges.end(),
+             [](const ReportEdge& a, const ReportEdge& b) { return a.first < b.first; });
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const ReportEdge& e = edges[i];
+            if (!e.tail) continue;
+            bool escalated = i + 1 < edges.size() && edges[i + 1].first == e.last + 1 &&
+                             edges[i + 1].headId == e.tailId;
+            if (!escalated) discharges[e.tailCond]++;
+        }
+        edges.clear();
+    }
+};
+
+inline int report_priority(const string& s) {
+    int p = atoi(s.c_str());
+    return p < 0 ? 0 : p > REPORT_MAX_PRIORITY ? REPORT_MAX_PRIORITY : p;
+}
+
+// ---------------------------------------------------------------------------
+// report_map_segment()
+// ---------------------------------------------------------------------------
+// Purpose : The map step: add the changes of one segment file to `agg`.
+// Note    : A patient removal is only counted as a discharge once the next
+//           line is known not to be the escalation of that patient; one on
+//           the last line is left to the reduce step (ReportEdge).
+// ---------------------------------------------------------------------------
+inline void report_map_segment(const string& path, ReportAgg& agg) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return;
+    vector<char> buf;
+    char chunk[1 << 16];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof chunk, f)) > 0) buf.insert(buf.end(), chunk, chunk + got);
+    fclose(f);
+    agg.bytes += (long long)buf.size();
+    agg.segments++;
+
+    vector<string> before, after;     // fields (only the first nb / na valid)
+    size_t nb, na;
+    string pendingId, pendingCond;     // last patient removal, not counted yet
+    bool pending = false;
+    ReportEdge edge;
+    const char* p = buf.data();
+    const char* end = p + buf.size();
+    while (p < end) {
+        const char* eol = (const char*)memchr(p, '\n', end - p);
+        if (!eol) eol = end;
+        const char* col[5];
+        int ncol = 0;
+        col[ncol++] = p;
+        for (const char* q = p; q < eol && ncol < 5; ++q)
+            if (*q == '\t') col[ncol++] = q + 1;
+        if (ncol == 5) {
+            bool firstLine = edge.last == 0;        // LSNs start at 1
+            agg.lines++;
+            edge.last = strtoull(col[0], nullptr, 10);
+            if (firstLine) edge.first = edge.last;
+            // col[1] role, col[2] kind, col[3] before, col[4] after;
+            // only the images a report needs are split
+            char role = *col[1];
+            char kind = *col[2];                       // i / r / u
+            bool escalation = false;
+            if (role == 'e' && kind == 'i') {          // emergency logged
+                na = cdc_fields(col[4], eol, after);
+                if (na > 2) agg.logged[report_priority(after[2])]++;
+                escalation = pending && na > 3 && after[3] == pendingId;
+                if (firstLine && na > 3) edge.headId = after[3];
+            }
+            if (pending && !escalation) agg.discharges[pendingCond]++;
+            pending = false;
+
+            if (kind == 'r') {
+                nb = cdc_fields(col[3], col[4] - 1, before);
+                if (role == 'p' && nb > 2) {           // patient left the queue
+                    pending = true;
+                    pendingId.swap(before[0]);
+                    pendingCond.swap(before[2]);
+                } else if (role == 's' && nb > 1) {    // supply batch used
+                    agg.supplyUnits[before[0]] += atoll(before[1].c_str());
+                    agg.supplyBatches[before[0]]++;
+                } else if (role == 'e' && nb > 2) {    // emergency processed
+                    agg.processed[report_priority(before[2])]++;
+                }
+            } else if (role == 'a' && kind == 'u') {   // unit moved in rotation
+                nb = cdc_fields(col[3], col[4] - 1, before);
+                na = cdc_fields(col[4], eol, after);
+                if (nb > 1 && na > 1 && atoi(after[1].c_str()) > atoi(before[1].c_str()))
+                    agg.dispatches[after[0]]++;
+            }
+        }
+        p = eol + 1;
+    }
+    if (edge.last == 0) return;        // no complete line
+    if (pending) {
+        edge.tail = true;
+        edge.tailId.swap(pendingId);
+        edge.tailCond.swap(pendingCond);
+    }
+    agg.edges.push_back(move(edge));
+}
+
+// ---------------------------------------------------------------------------
+// run_report()
+// ---------------------------------------------------------------------------
+// Purpose : Map the segment files over `threads` threads (0 = hardware
+//           threads) and reduce into one aggregate.
+// ---------------------------------------------------------------------------
+inline ReportAgg run_report(vector<string> files, int threads = 0) {
+    vector<pair<uintmax_t, string> > bySize;
+    for (const string& f : files) {
+        error_code ec;
+        uintmax_t sz = filesystem::file_size(f, ec);
+        bySize.push_back(make_pair(ec ? 0 : sz, f));
+    }
+    sort(bySize.begin(), bySize.end(), greater<pair<uintmax_t, string> >());
+
+    int T = threads > 0 ? threads : (int)thread::hardware_concurrency();
+    if (T < 1) T = 1;
+    if ((size_t)T > bySize.size()) T = max<int>(1, (int)bySize.size());
+
+    vector<ReportAgg> part(T);
+    atomic<size_t> next{0};
+    vector<thread> pool;
+    for (int t = 0; t < T; ++t) {
+        pool.emplace_back([&, t] {
+            size_t i;
+            while ((i = next.fetch_add(1)) < bySize.size())
+                report_map_segment(bySize[i].second, part[t]);
+        });
+    }
+    for (thread& th : pool) th.join();
+
+    for (int t = 1; t < T; ++t) part[0].merge(part[t]);
+    part[0].settleEdges();
+    return move(part[0]);
+}
+
+// Segment files of the change stream, all or those written to in the last
+// `days` days (days <= 0 = all). `lostBefore` is set to the first LSN of
+// the oldest retained segment if that one is in the period and retention
+// already deleted the changes before it (else 0).
+inline vector<string> report_segments(int days, Lsn& lostBefore) {
+    vector<string> files;
+    ifstream man(CDC_MANIFEST);
+    CdcSegment s;
+    bool oldest = true;
+    lostBefore = 0;
+    auto now = filesystem::file_time_type::clock::now();
+    while (man >> s.first >> s.bytes) {
+        string f = cdc_segment_name(s.first);
+        bool first = oldest;
+        oldest = false;
+        error_code ec;
+        auto t = filesystem::last_write_time(f, ec);
+        if (ec) continue;
+        if (days > 0 && now - t > chrono::hours(24) * days) continue;
+        if (first && s.first > 1) lostBefore = s.first;
+        files.push_back(f);
+    }
+    return files;
+}
+
+// Rows of a count map, largest first
+inline vector<pair<string, long long> > report_rows(const unordered_map<string, long long>& m) {
+    vector<pair<string, long long> > rows(m.begin(), m.end());
+    sort(rows.begin(), rows.end(), [](const pair<string, long long>& a,
+                                      const pair<string, long long>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    return rows;
+}
+
+// --------------------------------------------------------------------------
+// print_report()
+// --------------------------------------------------------------------------
+inline void print_report(const ReportAgg& r) {
+    line('=');
+    cout << "DISCHARGES BY CONDITION\n";
+    line();
+    for (const auto& row : report_rows(r.discharges))
+        cout << left << setw(40) << row.first << right << setw(10) << row.second << "\n";
+
+    line('=');
+    cout << "SUPPLY USAGE BY TYPE\n";
+    line();
+    cout << left << setw(40) << "Type" << right << setw(10) << "Units" << setw(10)
+         << "Batches" << "\n";
+    for (const auto& row : report_rows(r.supplyUnits))
+        cout << left << setw(40) << row.first << right << setw(10) << row.second
+             << setw(10) << r.supplyBatches.at(row.first) << "\n";
+
+    line('=');
+    cout << "EMERGENCIES BY PRIORITY\n";
+    line();
+    cout << left << setw(10) << "Priority" << right << setw(10) << "Logged" << setw(12)
+         << "Processed" << "\n";
+    for (int p = REPORT_MAX_PRIORITY; p >= 0; --p)
+        if (r.logged[p] || r.processed[p])
+            cout << left << setw(10) << p << right << setw(10) << r.logged[p]
+                 << setw(12) << r.processed[p] << "\n";
+
+    line('=');
+    cout << "AMBULANCE DISPATCHES PER UNIT\n";
+    line();
+    for (const auto& row : report_rows(r.dispatches))
+        cout << left << setw(40) << row.first << right << setw(10) << row.second << "\n";
+    line('=');
+    cout << left;
+}
+
+// Build and print the reports, with a summary line
+inline void report_run_and_print(int days) {
+    Lsn lostBefore;
+    vector<string> files = report_segments(days, lostBefore);
+    if (files.empty()) {
+        cout << "No change history" << (days > 0 ? " in that period" : "") << ".\n";
+        return;
+    }
+    if (lostBefore > 0)
+        cout << "[Warn] " << (days > 0 ? "The period goes back further than the kept"
+                                       : "Only part of the")
+             << " change history: changes before LSN " << lostBefore
+             << " were deleted (only the last " << CDC_RETAIN_BYTES / 1024
+             << " KiB are kept, HOSPITAL_CDC_RETAIN_BYTES).\n";
+    auto t0 = chrono::steady_clock::now();
+    ReportAgg r = run_report(files);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    print_report(r);
+    int T = min<int>(max(1u, thread::hardware_concurrency()), (int)files.size());
+    cout << r.lines << " change(s) in " << r.segments << " segment(s), "
+         << r.bytes << " bytes, read by " << T << " thread(s) in " << fixed
+         << setprecision(1) << ms << " ms.\n";
+    cout.unsetf(ios::floatfield);
+}
+
+// --------------------------------------------------------------------------
+// ui_reports()
+// --------------------------------------------------------------------------
+// Purpose : Ask for the period in days (empty = all history) and print the
+//           reports.
+// --------------------------------------------------------------------------
+inline void ui_reports() {
+    string s;
+    cout << "Last how many days (empty = all history): ";
+    safe_getline(s);
+    int days = 0;
+    if (!s.empty()) {
+        char* end;
+        long d = strtol(s.c_str(), &end, 10);
+        if (*end || d < 1) {
+            cout << "Invalid number.\n";
+            return;
+        }
+        days = (int)d;
+    }
+    report_run_and_print(days);
+}
+
+// "--report [DAYS]"
+inline int report_cli(const char* days) {
+    int d = 0;
+    if (days) {
+        char* end;
+        d = (int)strtol(days, &end, 10);
+        if (*end || d < 1) {
+            cerr << "[Error] DAYS must be a positive number.\n";
+            return 1;
+        }
+    }
+    report_run_and_print(d);
+    return 0;
+}
+
+#endif
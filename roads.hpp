@@ -0,0 +1,573 @@
+#ifndef ROADS_HPP
+#define ROADS_HPP
+
+#include "utils.hpp"
+#include "crew.hpp"            // only staffed units are ranked
+#include "staging.hpp"         // units wait at their staging points
+#include "memory.hpp"          // accounting (ambulance role)
+#include <vector>
+#include <list>                // LRU order of the ETA cache
+#include <unordered_map>
+#include <algorithm>           // for push_heap / pop_heap, sort
+#include <functional>          // for greater (min-heaps)
+#include <chrono>              // for steady_clock (build and query timing)
+#include <cstdio>              // for fopen/fgets (large road files)
+#include <cstdint>
+
+#define ROAD_FILE "roads.txt"
+
+// ==========================================================================
+// ROAD NETWORK (part of ROLE 4)
+// --------------------------------------------------------------------------
+// Travel times over the real road network, so the dispatcher can rank the
+// units by how fast they can reach an incident instead of by their place
+// in the rotation, and batch dispatch (dispatch.hpp) can use them as the
+// travel part of its cost.
+//
+// Input (ROAD_FILE), e.g. converted offline from an OpenStreetMap extract:
+//   # comment
+//   v x y            junction; numbered 0, 1, 2, ... in file order,
+//                    position in km (same frame as incidents.txt)
+//   e a b seconds    two-way road between junctions a and b
+//   o a b seconds    one-way road from a to b
+//
+// Engine: contraction hierarchies. At load time the junctions are
+// contracted one by one, least important first (see ChBuilder::priority(),
+// checked again just before contracting), and a shortcut u -> w is added
+// for every u -> v -> w that was a shortest path, unless a limited local
+// search finds another path that is as short ("witness"). A query is then
+// two small Dijkstra searches that only go UP the hierarchy, one from
+// each end, meeting at the most important junction of the route: a few
+// hundred nodes settled instead of a large part of the city. A node that
+// a higher node already reached more cheaply is not expanded ("stall on
+// demand").
+//
+// Results are kept in an LRU cache of ROAD_CACHE_SIZE (from, to) pairs,
+// as the same few stand-by points are asked about again and again.
+//
+// Unit positions: a unit waits at its staging point (staging.hpp); before
+// there is a plan it is taken to be at the depot (ROAD_DEPOT_X/Y).
+// ==========================================================================
+
+const int   ROAD_INF          = 0x3fffffff;   // unreachable
+const int   CH_WITNESS_SETTLE = 500;          // nodes a witness search may settle
+const int   ROAD_CACHE_SIZE   = 4096;         // cached (from, to) pairs
+const float ROAD_CELL_KM      = 0.5f;         // grid cell for snapping positions
+const float ROAD_DEPOT_X      = 0.0f;
+const float ROAD_DEPOT_Y      = 0.0f;
+
+struct RoadEdge {
+    int from, to;
+    int sec;       // travel time (seconds)
+};
+
+// ---------------------------------------------------------------------------
+// ChBuilder
+// ---------------------------------------------------------------------------
+// Contraction of a graph, used once by RoadGraph::build(). Every node keeps
+// its edges to and from the nodes not contracted yet; when a node is
+// contracted those edges are its edges up the hierarchy.
+// ---------------------------------------------------------------------------
+struct ChBuilder {
+    int n;
+    vector<vector<pair<int, int> > > out, in;     // (node, seconds)
+    vector<char> done;                            // contracted
+    vector<int>  gone;                            // contracted neighbours
+    vector<int>  level;                           // depth in the hierarchy so far
+    vector<int>  dist;
+    vector<unsigned> seen;                        // stamp of dist[]
+    unsigned stamp = 0;
+    vector<pair<int, int> > heap;
+    long long shortcuts = 0;
+
+    ChBuilder(int nodes, const vector<RoadEdge>& edges)
+        : n(nodes), out(nodes), in(nodes), done(nodes, 0), gone(nodes, 0), level(nodes, 0),
+          dist(nodes), seen(nodes, 0) {
+        for (const RoadEdge& e : edges)
+            if (e.from != e.to) addArc(e.from, e.to, e.sec);
+    }
+
+    // Add a -> b, or lower its time if it already exists
+    void addArc(int a, int b, int sec) {
+        for (auto& e : out[a]) {
+            if (e.first != b) continue;
+            if (sec < e.second) {
+                e.second = sec;
+                for (auto& f : in[b]) if (f.first == a) f.second = sec;
+            }
+            return;
+        }
+        out[a].push_back({ b, sec });
+        in[b].push_back({ a, sec });
+    }
+
+    // Limited Dijkstra from u over the remaining graph without `skip`; the
+    // distances found are real paths, so they are valid witnesses even
+    // where the search stopped early
+    void witness(int u, int skip, int limit) {
+        ++stamp;
+        heap.clear();
+        dist[u] = 0;
+        seen[u] = stamp;
+        heap.push_back({ 0, u });
+        int settled = 0;
+        while (!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), greater<pair<int, int> >());
+            pair<int, int> top = heap.back();
+            heap.pop_back();
+            int d = top.first, a = top.second;
+            if (d > dist[a]) continue;
+            if (d > limit || ++settled > CH_WITNESS_SETTLE) break;
+            for (auto& e : out[a]) {
+                int b = e.first, nd = d + e.second;
+                if (b == skip || (seen[b] == stamp && nd >= dist[b])) continue;
+                seen[b] = stamp;
+                dist[b] = nd;
+                heap.push_back({ nd, b });
+                push_heap(heap.begin(), heap.end(), greater<pair<int, int> >());
+            }
+        }
+    }
+
+    // Shortcuts needed to contract v (added if `apply`)
+    int contract(int v, bool apply) {
+        int added = 0;
+        for (auto& ie : in[v]) {
+            int u = ie.first, limit = -1;
+            for (auto& oe : out[v])
+                if (oe.first != u) limit = max(limit, ie.second + oe.second);
+            if (limit < 0) continue;
+            witness(u, v, limit);
+            for (auto& oe : out[v]) {
+                int w = oe.first, via = ie.second + oe.second;
+                if (w == u || (seen[w] == stamp && dist[w] <= via)) continue;
+                added++;
+                if (apply) addArc(u, w, via);
+            }
+        }
+        return added;
+    }
+
+    // Lower = contract earlier: twice the edge difference (shortcuts added
+    // minus edges removed), plus contracted neighbours and level, which
+    // spread the contraction evenly over the map
+    int priority(int v) {
+        int ed = contract(v, false) - (int)(in[v].size() + out[v].size());
+        return 2 * ed + gone[v] + level[v];
+    }
+
+    // Take v out of the remaining graph
+    void remove(int v) {
+        for (auto& e : out[v]) {
+            auto& l = in[e.first];
+            for (size_t k = 0; k < l.size(); ++k)
+                if (l[k].first == v) { l[k] = l.back(); l.pop_back(); break; }
+            gone[e.first]++;
+            level[e.first] = max(level[e.first], level[v] + 1);
+        }
+        for (auto& e : in[v]) {
+            auto& l = out[e.first];
+            for (size_t k = 0; k < l.size(); ++k)
+                if (l[k].first == v) { l[k] = l.back(); l.pop_back(); break; }
+            gone[e.first]++;
+            level[e.first] = max(level[e.first], level[v] + 1);
+        }
+        done[v] = 1;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// RoadCache
+// ---------------------------------------------------------------------------
+// Least-recently-used cache of travel times by (from, to) junction pair.
+// ---------------------------------------------------------------------------
+struct RoadCache {
+    typedef pair<uint64_t, int> Entry;
+    list<Entry> lru;                                  // most recent first
+    unordered_map<uint64_t, list<Entry>::iterator> at;
+    long long hits = 0, misses = 0;
+
+    static uint64_t key(int from, int to) { return (uint64_t)(uint32_t)from << 32 | (uint32_t)to; }
+
+    bool get(int from, int to, int& sec) {
+        auto it = at.find(key(from, to));
+        if (it == at.end()) { misses++; return false; }
+        lru.splice(lru.begin(), lru, it->second);     // now most recent
+        sec = it->second->second;
+        hits++;
+        return true;
+    }
+
+    void put(int from, int to, int sec) {
+        if ((int)lru.size() == ROAD_CACHE_SIZE) {
+            at.erase(lru.back().first);
+            lru.pop_back();
+        }
+        lru.push_front({ key(from, to), sec });
+        at[key(from, to)] = lru.begin();
+    }
+
+    void clear() { lru.clear(); at.clear(); hits = misses = 0; }
+};
+
+// ---------------------------------------------------------------------------
+// RoadGraph
+// ---------------------------------------------------------------------------
+struct RoadGraph {
+    vector<float> x, y;                  // junction positions (km)
+    long long roads = 0;                 // edges read from the file
+
+    // Edges up the hierarchy in compressed rows: node v's edges are
+    // [first[v], first[v + 1]). up = forward (v -> higher), down = the
+    // reversed edges into v from higher nodes (backward search).
+    vector<int> upFirst, upTo, upSec;
+    vector<int> downFirst, downTo, downSec;
+    long long shortcuts = 0;
+    double buildMs = 0;
+
+    // Snapping grid: nodes of cell c are cellNode[cellFirst[c] .. cellFirst[c + 1])
+    float gx0 = 0, gy0 = 0;
+    int   gw = 0, gh = 0;
+    vector<int> cellFirst, cellNode;
+
+    // Query scratch (stamp instead of clearing)
+    vector<int> distF, distB;
+    vector<unsigned> seenF, seenB;
+    unsigned stamp = 0;
+    vector<pair<int, int> > heapF, heapB;
+    RoadCache cache;
+
+    int size() const { return (int)x.size(); }
+    bool isEmpty() const { return x.empty(); }
+
+    // ----------------------------------------------------------------------
+    // build()
+    // ----------------------------------------------------------------------
+    // Purpose : Contract the graph and set up the query and snapping data.
+    // ----------------------------------------------------------------------
+    void build(const vector<RoadEdge>& edges) {
+        auto t0 = chrono::steady_clock::now();
+        int n = size();
+        ChBuilder ch(n, edges);
+        vector<pair<int, int> > queue;            // (priority, node), min-heap
+        for (int v = 0; v < n; ++v) queue.push_back({ ch.priority(v), v });
+        make_heap(queue.begin(), queue.end(), greater<pair<int, int> >());
+
+        vector<vector<pair<int, int> > > up(n), down(n);
+        while (!queue.empty()) {
+            pop_heap(queue.begin(), queue.end(), greater<pair<int, int> >());
+            int v = queue.back().second;
+            queue.pop_back();
+            int p = ch.priority(v);                // lazy update
+            if (!queue.empty() && p > queue.front().first) {
+                queue.push_back({ p, v });
+                push_heap(queue.begin(), queue.end(), greater<pair<int, int> >());
+                continue;
+            }
+            ch.shortcuts += ch.contract(v, true);
+            up[v]   = ch.out[v];
+            down[v] = ch.in[v];
+            ch.remove(v);
+        }
+        shortcuts = ch.shortcuts;
+        flatten(up, upFirst, upTo, upSec);
+        flatten(down, downFirst, downTo, downSec);
+
+        distF.assign(n, ROAD_INF);
+        distB.assign(n, ROAD_INF);
+        seenF.assign(n, 0);
+        seenB.assign(n, 0);
+        buildGrid();
+        cache.clear();
+        buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    }
+
+    static void flatten(const vector<vector<pair<int, int> > >& adj,
+                        vector<int>& first, vector<int>& to, vector<int>& sec) {
+        first.assign(1, 0);
+        to.clear();
+        sec.clear();
+        for (const auto& l : adj) {
+            for (const auto& e : l) {
+                to.push_back(e.first);
+                sec.push_back(e.second);
+            }
+            first.push_back((int)to.size());
+        }
+    }
+
+    void buildGrid() {
+        if (x.empty()) return;
+        gx0 = *min_element(x.begin(), x.end());
+        gy0 = *min_element(y.begin(), y.end());
+        gw = (int)((*max_element(x.begin(), x.end()) - gx0) / ROAD_CELL_KM) + 1;
+        gh = (int)((*max_element(y.begin(), y.end()) - gy0) / ROAD_CELL_KM) + 1;
+        cellFirst.assign((size_t)gw * gh + 1, 0);
+        for (int v = 0; v < size(); ++v) cellFirst[cellOf(x[v], y[v]) + 1]++;
+        for (size_t c = 1; c < cellFirst.size(); ++c) cellFirst[c] += cellFirst[c - 1];
+        cellNode.resize(size());
+        vector<int> fill(cellFirst.begin(), cellFirst.end() - 1);
+        for (int v = 0; v < size(); ++v) cellNode[fill[cellOf(x[v], y[v])]++] = v;
+    }
+
+    int cellOf(float px, float py) const {
+        int cx = min(gw - 1, max(0, (int)((px - gx0) / ROAD_CELL_KM)));
+        int cy = min(gh - 1, max(0, (int)((py - gy0) / ROAD_CELL_KM)));
+        return cy * gw + cx;
+    }
+
+    // ----------------------------------------------------------------------
+    // nearest()
+    // ----------------------------------------------------------------------
+    // Purpose : Junction closest to (px, py), searching the grid in rings
+    //           around the cell of the point. -1 if the graph is empty.
+    // ----------------------------------------------------------------------
+    int nearest(float px, float py) const {
+        if (isEmpty()) return -1;
+        int c = cellOf(px, py), cx = c % gw, cy = c / gw;
+        int best = -1;
+        float bestD = 0;
+        for (int r = 0; r <= max(gw, gh); ++r) {
+            for (int j = cy - r; j <= cy + r; ++j) {
+                if (j < 0 || j >= gh) continue;
+                for (int i = cx - r; i <= cx + r; ++i) {
+                    if (i < 0 || i >= gw) continue;
+                    if (max(abs(i - cx), abs(j - cy)) != r) continue;   // ring only
+                    int cell = j * gw + i;
+                    for (int k = cellFirst[cell]; k < cellFirst[cell + 1]; ++k) {
+                        int v = cellNode[k];
+                        float dx = x[v] - px, dy = y[v] - py, d = dx * dx + dy * dy;
+                        if (best < 0 || d < bestD) { best = v; bestD = d; }
+                    }
+                }
+            }
+            // Cells further out are at least r cells away
+            float reach = r * ROAD_CELL_KM;
+            if (best >= 0 && reach * reach >= bestD) break;
+        }
+        return best;
+    }
+
+    // ----------------------------------------------------------------------
+    // query()
+    // ----------------------------------------------------------------------
+    // Purpose : Travel time in seconds from junction s to junction t
+    //           (ROAD_INF if t cannot be reached), through the cache.
+    // ----------------------------------------------------------------------
+    int query(int s, int t) {
+        int sec;
+        if (cache.get(s, t, sec)) return sec;
+        sec = search(s, t);
+        cache.put(s, t, sec);
+        return sec;
+    }
+
+    // Bidirectional upward search; the route's top node is settled by both
+    int search(int s, int t) {
+        if (s == t) return 0;
+        ++stamp;
+        heapF.clear();
+        heapB.clear();
+        relax(heapF, distF, seenF, s, 0);
+        relax(heapB, distB, seenB, t, 0);
+        int best = ROAD_INF;
+        while (!heapF.empty() || !heapB.empty()) {
+            int topF = heapF.empty() ? ROAD_INF : heapF.front().first;
+            int topB = heapB.empty() ? ROAD_INF : heapB.front().first;
+            if (min(topF, topB) >= best) break;
+            bool forward = topF <= topB;
+            vector<pair<int, int> >& h = forward ? heapF : heapB;
+            pop_heap(h.begin(), h.end(), greater<pair<int, int> >());
+            int d = h.back().first, v = h.back().second;
+            h.pop_back();
+            vector<int>& dist = forward ? distF : distB;
+            if (d > dist[v]) continue;
+            // Met the other search?
+            if (forward ? seenB[v] == stamp : seenF[v] == stamp)
+                best = min(best, d + (forward ? distB[v] : distF[v]));
+            const vector<int>& first = forward ? upFirst : downFirst;
+            const vector<int>& to    = forward ? upTo    : downTo;
+            const vector<int>& sec   = forward ? upSec   : downSec;
+            if (stalled(v, d, forward)) continue;
+            for (int k = first[v]; k < first[v + 1]; ++k)
+                relax(h, dist, forward ? seenF : seenB, to[k], d + sec[k]);
+        }
+        return best;
+    }
+
+    // Stall on demand: if a node higher up, already reached by this
+    // search, has an edge down to v that beats d, then d is not v's
+    // distance and the search does not need to go on from v
+    bool stalled(int v, int d, bool forward) const {
+        const vector<int>& first = forward ? downFirst : upFirst;
+        const vector<int>& to    = forward ? downTo    : upTo;
+        const vector<int>& sec   = forward ? downSec   : upSec;
+        const vector<int>& dist  = forward ? distF     : distB;
+        const vector<unsigned>& seen = forward ? seenF : seenB;
+        for (int k = first[v]; k < first[v + 1]; ++k) {
+            int u = to[k];
+            if (seen[u] == stamp && dist[u] + sec[k] < d) return true;
+        }
+        return false;
+    }
+
+    void relax(vector<pair<int, int> >& h, vector<int>& dist, vector<unsigned>& seen,
+               int v, int d) {
+        if (seen[v] == stamp && d >= dist[v]) return;
+        seen[v] = stamp;
+        dist[v] = d;
+        h.push_back({ d, v });
+        push_heap(h.begin(), h.end(), greater<pair<int, int> >());
+    }
+
+    // ----------------------------------------------------------------------
+    // loadFromFile()
+    // ----------------------------------------------------------------------
+    // Purpose : Read ROAD_FILE (format at the top of this file) and build.
+    // Return  : false if the file cannot be opened.
+    // ----------------------------------------------------------------------
+    bool loadFromFile(const char* filename) {
+        x.clear();
+        y.clear();
+        roads = 0;
+        FILE* f = fopen(filename, "r");
+        if (!f) return false;
+        vector<RoadEdge> edges;
+        long long bad = 0;
+        char buf[128];
+        while (fgets(buf, sizeof buf, f)) {
+            char kind;
+            float px, py;
+            int a, b, sec;
+            if (buf[0] == '#' || buf[0] == '\n' || buf[0] == '\r') continue;
+            if (sscanf(buf, "v %f %f", &px, &py) == 2) {
+                x.push_back(px);
+                y.push_back(py);
+            } else if (sscanf(buf, "%c %d %d %d", &kind, &a, &b, &sec) == 4 &&
+                       (kind == 'e' || kind == 'o') && a >= 0 && b >= 0 &&
+                       a < size() && b < size() && sec >= 0) {
+                edges.push_back({ a, b, sec });
+                if (kind == 'e') edges.push_back({ b, a, sec });
+                roads++;
+            } else {
+                bad++;
+            }
+        }
+        fclose(f);
+        if (bad) load_log() << "[Warn] " << filename << ": " << bad << " bad line(s) skipped.\n";
+        build(edges);
+        return true;
+    }
+};
+
+// Road network of the service area (C++17 inline variable)
+inline RoadGraph gRoads;
+
+// Memory accounting (memory.hpp). The ETA cache is dropped by compaction.
+inline MemRegister gRoadsMem(MEM_AMBULANCES, "road graph", [] {
+    const RoadGraph& g = gRoads;
+    return mem_vector(g.x) + mem_vector(g.y)
+         + mem_vector(g.upFirst) + mem_vector(g.upTo) + mem_vector(g.upSec)
+         + mem_vector(g.downFirst) + mem_vector(g.downTo) + mem_vector(g.downSec)
+         + mem_vector(g.cellFirst) + mem_vector(g.cellNode)
+         + mem_vector(g.distF) + mem_vector(g.distB) + mem_vector(g.seenF)
+         + mem_vector(g.seenB) + mem_vector(g.heapF) + mem_vector(g.heapB);
+});
+inline MemRegister gRoadCacheMem(MEM_AMBULANCES, "ETA cache", [] {
+    return mem_list(gRoads.cache.lru) + mem_hash(gRoads.cache.at);
+});
+inline MemRegister gRoadCacheCompact(MEM_AMBULANCES, [] { gRoads.cache.clear(); });
+
+inline void load_roads_from_file() {
+    if (!gRoads.loadFromFile(ROAD_FILE)) {
+        load_log() << "[Info] " << ROAD_FILE << " not found. Travel times unavailable.\n";
+        return;
+    }
+    load_log() << "[OK] Loaded road network from " << ROAD_FILE << " ("
+               << gRoads.size() << " junctions, " << gRoads.roads << " roads; "
+               << gRoads.shortcuts << " shortcuts in " << (long long)gRoads.buildMs
+               << " ms)\n";
+}
+
+// Travel time (seconds) of the unit at place `rank` in the rotation, from
+// its stand-by position, to junction `to` (batch dispatch, dispatch.hpp)
+inline int unit_eta(int rank, int to) {
+    float x = ROAD_DEPOT_X, y = ROAD_DEPOT_Y;
+    staging_point(rank, x, y);
+    return gRoads.query(gRoads.nearest(x, y), to);
+}
+
+// "m:ss", or "-" if unreachable
+inline string road_time_str(int sec) {
+    if (sec >= ROAD_INF) return "-";
+    char buf[16];
+    snprintf(buf, sizeof buf, "%d:%02d", sec / 60, sec % 60);
+    return buf;
+}
+
+// --------------------------------------------------------------------------
+// ui_rank_by_eta()
+// --------------------------------------------------------------------------
+// Purpose : Rank the staffed units (plates in rotation order) by travel
+//           time to an incident position the dispatcher enters.
+// Steps   :
+//   1) Read the incident position (x y, km) and snap it to a junction.
+//   2) For every unit staffed this hour, snap its stand-by position and
+//      query the travel time.
+//   3) Print the units fastest first, with their place in the rotation.
+// --------------------------------------------------------------------------
+inline void ui_rank_by_eta(const vector<string>& plates) {
+    if (gRoads.isEmpty()) {
+        cout << "No road network loaded (" << ROAD_FILE << ").\n";
+        return;
+    }
+    if (plates.empty()) {
+        cout << "No ambulances in rotation.\n";
+        return;
+    }
+    string s;
+    cout << "Incident position (x y, km): ";
+    safe_getline(s);
+    float px, py;
+    if (sscanf(s.c_str(), "%f %f", &px, &py) != 2) {
+        cout << "Invalid position.\n";
+        return;
+    }
+    int to = gRoads.nearest(px, py);
+
+    struct Row { int sec; int rank; float x, y; };
+    vector<Row> rows;
+    int slot = crew_current_slot();
+    long long hits = gRoads.cache.hits;
+    auto t0 = chrono::steady_clock::now();
+    for (int i = 0; i < (int)plates.size(); ++i) {
+        if (!gRoster.staffed(plates[i], slot)) continue;
+        Row r{ 0, i, ROAD_DEPOT_X, ROAD_DEPOT_Y };
+        staging_point(i, r.x, r.y);
+        r.sec = gRoads.query(gRoads.nearest(r.x, r.y), to);
+        rows.push_back(r);
+    }
+    auto us = chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - t0).count();
+    if (rows.empty()) {
+        cout << "No staffed ambulances available this hour.\n";
+        return;
+    }
+    stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.sec < b.sec; });
+
+    line();
+    cout << left << setw(10) << "Unit" << setw(10) << "ETA" << setw(10) << "Rotation"
+         << "Waiting at (x, y km)" << "\n";
+    line();
+    for (const Row& r : rows) {
+        char pos[32];
+        snprintf(pos, sizeof pos, "(%.2f, %.2f)", r.x, r.y);
+        cout << left << setw(10) << plates[r.rank] << setw(10) << road_time_str(r.sec)
+             << setw(10) << ("#" + to_string(r.rank + 1)) << pos << "\n";
+    }
+    line();
+    cout << rows.size() << " unit(s) ranked in " << us << " us ("
+         << gRoads.cache.hits - hits << " from cache).\n";
+}
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include "utils.hpp"
+#include "memory.hpp"   // accounting
+#include <chrono>     // for steady_clock (line timings)
+#include <thread>     // for this_thread::sleep_for (paced replay)
+#include <streambuf>  // for the custom cin buffers
+#include <filesystem> // data file snapshot and the replay directory
+#include <unistd.h>   // for getpid (replay directory name)
+
+// ---------------------------------------------------------------------------
+// session.hpp
+// ---------------------------------------------------------------------------
+// Record-and-replay of interactive sessions.
+//
+//   main --record FILE           run normally, but save every input line
+//                                and when it arrived into FILE
+//   main --replay FILE           feed FILE back as stdin at full speed
+//   main --replay FILE --paced   ... waiting the original time between lines
+//
+// Every menu (main menu, menu_patients, menu_supplies, menu_emergency,
+// menu_ambulance) reads from cin, so both modes simply swap cin's stream
+// buffer: nothing in the role modules needs to know about sessions.
+// At the end of a replay the elapsed time is reported on cerr, so a real
+// production session becomes a repeatable end-to-end benchmark even with
+// the normal console output redirected to /dev/null.
+//
+// A session only makes sense on the data it was recorded against, and a
+// replay changes data files like any run. So:
+//   - --record first copies the data files of the current directory (role
+//     files, journals, change stream and master index: *.txt, *.log and
+//     master_*) into the directory FILE.snapshot;
+//   - --replay copies FILE.snapshot into a new scratch directory under the
+//     system temp directory, runs there, and deletes it at the end. The
+//     live data files, change stream and master index are not touched.
+//     Without a snapshot the replay is refused.
+//
+// Session file format (one input line per line):
+//   # hospital-session v1
+//   <milliseconds since session start> <input line exactly as typed>
+// ---------------------------------------------------------------------------
+
+inline long long session_ms_since(chrono::steady_clock::time_point t0) {
+    return chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - t0).count();
+}
+
+// ---------------------------------------------------------------------------
+// SessionRecordBuf
+// ---------------------------------------------------------------------------
+// Stream buffer placed in front of the real stdin buffer. Each time cin
+// needs more input it pulls one whole line from the real buffer, appends it
+// to the session file with its arrival time, and hands it to cin.
+// ---------------------------------------------------------------------------
+struct SessionRecordBuf : public streambuf {
+    streambuf* src = nullptr;   // the original cin buffer
+    ofstream   out;             // session file being written
+    string     cur;             // line currently being handed out
+    chrono::steady_clock::time_point t0;
+
+    bool open(const char* filename, streambuf* source) {
+        out.open(filename);
+        if (!out) return false;
+        src = source;
+        t0  = chrono::steady_clock::now();
+        out << "# hospital-session v1\n";
+        return true;
+    }
+
+protected:
+    int_type underflow() override {
+        cur.clear();
+        int_type c;
+        while ((c = src->sbumpc()) != traits_type::eof()) {
+            cur.push_back(traits_type::to_char_type(c));
+            if (c == '\n') break;
+        }
+        if (cur.empty()) return traits_type::eof();
+
+        // Store the line without its '\n' (and '\r' from Windows consoles)
+        string text = cur;
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+            text.pop_back();
+        out << session_ms_since(t0) << ' ' << text << '\n';
+        out.flush();   // keep the session even if the program is killed
+
+        setg(&cur[0], &cur[0], &cur[0] + cur.size());
+        return traits_type::to_int_type(cur[0]);
+    }
+};
+
+// ---------------------------------------------------------------------------
+// SessionReplayBuf
+// ---------------------------------------------------------------------------
+// Stream buffer that serves the lines of a session file as if they were
+// typed. With paced = true it sleeps until each line's original offset
+// (relative to the start of the replay) before handing it out.
+// ---------------------------------------------------------------------------
+struct SessionReplayBuf : public streambuf {
+    ifstream in;
+    bool     paced = false;
+    string   cur;
+    long     lines = 0;          // lines served so far
+    chrono::steady_clock::time_point t0;
+
+    bool open(const char* filename, bool pacedReplay) {
+        in.open(filename);
+        if (!in) return false;
+        paced = pacedReplay;
+        t0    = chrono::steady_clock::now();
+        return true;
+    }
+
+protected:
+    int_type underflow() override {
+        string rec;
+        while (getline(in, rec)) {
+            if (rec.empty() || rec[0] == '#') continue;   // header/comments
+
+            size_t sp = rec.find(' ');
+            long long at = atoll(rec.substr(0, sp).c_str());
+            cur = (sp == string::npos) ? string() : rec.substr(sp + 1);
+            cur.push_back('\n');
+
+            if (paced) {
+                long long wait = at - session_ms_since(t0);
+                if (wait > 0) this_thread::sleep_for(chrono::milliseconds(wait));
+            }
+            lines++;
+            setg(&cur[0], &cur[0], &cur[0] + cur.size());
+            return traits_type::to_int_type(cur[0]);
+        }
+        return traits_type::eof();
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Session state used by main.cpp
+// ---------------------------------------------------------------------------
+inline SessionRecordBuf gSessionRecord;
+inline SessionReplayBuf gSessionReplay;
+inline streambuf*       gSessionOrigCin = nullptr;   // restored at the end
+inline bool             gSessionReplaying = false;
+inline filesystem::path gSessionHome;                // directory before a replay
+inline filesystem::path gSessionScratch;             // replay directory
+
+// Files a run reads or writes (see the top of this file)
+inline bool session_data_file(const filesystem::path& p) {
+    string name = p.filename().string();
+    return p.extension() == ".txt" || p.extension() == ".log" ||
+           name.compare(0, 7, "master_") == 0;
+}
+
+// ---------------------------------------------------------------------------
+// session_copy_data()
+// ---------------------------------------------------------------------------
+// Purpose : Copy the data files of directory `from` into `to` (created
+//           empty), except `skip` (the session file itself).
+// Return  : false, with a message, if a file cannot be copied.
+// ---------------------------------------------------------------------------
+inline bool session_copy_data(const filesystem::path& from, const filesystem::path& to,
+                              const filesystem::path& skip = filesystem::path()) {
+    error_code ec;
+    filesystem::remove_all(to, ec);
+    if (!filesystem::create_directories(to, ec)) {
+        cout << "[Error] Cannot create " << to.string() << ".\n";
+        return false;
+    }
+    filesystem::directory_iterator it(from, ec);
+    if (ec) {
+        cout << "[Error] Cannot read " << from.string() << ".\n";
+        return false;
+    }
+    for (const auto& f : it) {
+        if (!f.is_regular_file() || !session_data_file(f.path())) continue;
+        if (!skip.empty() && filesystem::equivalent(f.path(), skip, ec)) continue;
+        if (!filesystem::copy_file(f.path(), to / f.path().filename(), ec)) {
+            cout << "[Error] Cannot copy " << f.path().string() << " to "
+                 << to.string() << ".\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Line buffers, plus the file buffer of the open session file
+inline MemRegister gSessionMem(MEM_SHARED, "session record/replay", [] {
+    return sizeof(gSessionRecord) + sizeof(gSessionReplay)
+         + mem_string(gSessionRecord.cur) + mem_string(gSessionReplay.cur)
+         + ((gSessionRecord.out.is_open() || gSessionReplay.in.is_open()) ? BUFSIZ : 0);
+});
+
+// ---------------------------------------------------------------------------
+// session_start()
+// ---------------------------------------------------------------------------
+// Purpose : Parse the command-line options described at the top of this
+//           file and redirect cin accordingly.
+// Return  : false if the options are invalid or the file cannot be opened.
+// ---------------------------------------------------------------------------
+inline bool session_start(int argc, char** argv) {
+    const char* recordFile = nullptr;
+    const char* replayFile = nullptr;
+    bool paced = false;
+
+    for (int i = 1; i < argc; ++i) {
+        string a = argv[i];
+        if      (a == "--record" && i + 1 < argc) recordFile = argv[++i];
+        else if (a == "--replay" && i + 1 < argc) replayFile = argv[++i];
+        else if (a == "--paced")                  paced = true;
+        else {
+            cout << "Usage: " << argv[0]
+                 << " [--record FILE | --replay FILE [--paced]]\n";
+            return false;
+        }
+    }
+    if (recordFile && replayFile) {
+        cout << "[Error] Use either --record or --replay, not both.\n";
+        return false;
+    }
+
+    if (recordFile) {
+        if (!gSessionRecord.open(recordFile, cin.rdbuf())) {
+            cout << "[Error] Cannot open " << recordFile << " for writing.\n";
+            return false;
+        }
+        string snap = string(recordFile) + ".snapshot";
+        if (!session_copy_data(filesystem::current_path(), snap, recordFile))
+            return false;
+        gSessionOrigCin = cin.rdbuf(&gSessionRecord);
+        cout << "[Info] Recording session to " << recordFile
+             << " (data files as of now in " << snap << ")\n";
+    }
+    if (replayFile) {
+        if (!gSessionReplay.open(replayFile, paced)) {
+            cout << "[Error] Cannot open " << replayFile << ".\n";
+            return false;
+        }
+        filesystem::path snap = filesystem::absolute(string(replayFile) + ".snapshot");
+        if (!filesystem::is_directory(snap)) {
+            cout << "[Error] No data snapshot " << snap.string()
+                 << ". Record the session again to replay it.\n";
+            return false;
+        }
+        gSessionHome    = filesystem::current_path();
+        gSessionScratch = filesystem::temp_directory_path() /
+                          ("hospital_replay_" + to_string(getpid()));
+        if (!session_copy_data(snap, gSessionScratch)) return false;
+        filesystem::current_path(gSessionScratch);
+        gSessionOrigCin = cin.rdbuf(&gSessionReplay);
+        gSessionReplaying = true;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// session_finish()
+// ---------------------------------------------------------------------------
+// Purpose : Restore cin and, after a replay, report how long it took and
+//           delete the replay directory.
+// ---------------------------------------------------------------------------
+inline void session_finish() {
+    if (gSessionReplaying) {
+        double ms = chrono::duration<double, milli>(
+            chrono::steady_clock::now() - gSessionReplay.t0).count();
+        cerr << "[Replay] " << gSessionReplay.lines << " input lines in "
+             << fixed << setprecision(3) << ms << " ms";
+        if (ms > 0)
+            cerr << " (" << setprecision(0)
+                 << (gSessionReplay.lines * 1000.0 / ms) << " lines/s)";
+        cerr << "\n";
+        error_code ec;
+        filesystem::current_path(gSessionHome, ec);
+        filesystem::remove_all(gSessionScratch, ec);
+    }
+    if (gSessionOrigCin) cin.rdbuf(gSessionOrigCin);
+}
+
+#endif
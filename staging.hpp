@@ -0,0 +1,444 @@
+#ifndef STAGING_HPP
+#define STAGING_HPP
+
+#include "utils.hpp"
+#include "memory.hpp"          // accounting (ambulance role)
+#include <vector>
+#include <memory>              // for shared_ptr (published plan)
+#include <mutex>
+#include <condition_variable>  // wakes the refresh thread
+#include <thread>
+#include <chrono>
+#include <cstdio>              // for fopen/fgets (large incident files)
+#include <cstdlib>             // for strtof
+#include <cfloat>              // for FLT_MAX
+#include <cmath>               // for fabsf
+#include <ctime>               // for localtime (current band)
+#include <algorithm>           // for stable_sort
+
+#define INCIDENT_FILE "incidents.txt"
+
+// ==========================================================================
+// STAGING POINTS (part of ROLE 4)
+// --------------------------------------------------------------------------
+// Recommended standby positions for the units of the ambulance rotation,
+// computed from where emergencies happened in the past.
+//
+// Input (INCIDENT_FILE), one incident per line:
+//   HH:MM x y        time of day, position in km east/north of the city
+//                    reference point (files may hold millions of lines)
+//
+// For each STAGING_BANDS time-of-day band (4 hours each) the incidents are
+// clustered with k-means, k = number of units in the rotation, and the k
+// centres are the staging points: a unit waiting at a centre is, on
+// average, closest to the incidents of that band.
+//
+// k-means (Lloyd's algorithm):
+//   - points are stored as separate x[] and y[] float arrays, and the
+//     assignment step runs over blocks of KMEANS_BLOCK points with the
+//     centre loop outside and a branch-free point loop inside, which the
+//     compiler vectorizes (SSE, or AVX with -march=native);
+//   - each iteration is split over all CPU threads; every thread sums its
+//     own points per centre and the sums are added up afterwards;
+//   - a cold start picks the first centres with k-means++ on a sample; a
+//     warm start begins from the previous plan's centres (same k), which
+//     usually needs only a few iterations after an hourly refresh.
+//
+// Refresh: a background thread recomputes the plan at start-up, every
+// STAGING_REFRESH_MIN minutes and when the number of units changes, and
+// then swaps in the new plan. The dispatcher only copies a shared_ptr
+// under a mutex, so reading the plan never waits for a computation.
+// ==========================================================================
+
+const int   STAGING_BANDS       = 6;      // 4-hour time-of-day bands
+const int   STAGING_REFRESH_MIN = 60;     // refresh period (minutes)
+const int   KMEANS_MAX_ITERS    = 50;
+const float KMEANS_EPS          = 0.005f; // stop when no centre moves more (km)
+const int   KMEANS_BLOCK        = 256;    // points per assignment block
+const int   KMEANS_SEED_SAMPLE  = 20000;  // points used by k-means++
+
+// Incidents of one band in structure-of-arrays form
+struct IncidentSet {
+    vector<float> x, y;
+    size_t size() const { return x.size(); }
+};
+
+struct KMeansResult {
+    vector<float> cx, cy;    // centres
+    vector<long long> count; // incidents closest to each centre
+    int    iters = 0;
+    double ms    = 0;
+    bool   warm  = false;    // started from the previous centres
+};
+
+struct StagingPlan {
+    int k = 0;
+    long long incidents = 0;
+    KMeansResult band[STAGING_BANDS];
+};
+
+// Small deterministic generator for seeding (xorshift64)
+struct KMeansRng {
+    unsigned long long s = 88172645463325252ULL;
+    unsigned long long next() {
+        s ^= s << 13;
+        s ^= s >> 7;
+        s ^= s << 17;
+        return s;
+    }
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+// ---------------------------------------------------------------------------
+// kmeans_assign()
+// ---------------------------------------------------------------------------
+// Purpose : Assignment step for points [lo, hi): add every point to the
+//           sums of its nearest centre.
+// ---------------------------------------------------------------------------
+inline void kmeans_assign(const IncidentSet& pts, size_t lo, size_t hi,
+                          const float* cx, const float* cy, int k,
+                          double* sx, double* sy, long long* cnt) {
+    // The block is copied into local arrays of a fixed size (the last one
+    // padded), so the loop below has no aliasing and no remainder and the
+    // compiler vectorizes it even at -O2.
+    float xb[KMEANS_BLOCK], yb[KMEANS_BLOCK], best[KMEANS_BLOCK];
+    int   lab[KMEANS_BLOCK];
+    for (size_t b = lo; b < hi; b += KMEANS_BLOCK) {
+        int m = (int)min((size_t)KMEANS_BLOCK, hi - b);
+        for (int i = 0; i < KMEANS_BLOCK; ++i) {
+            xb[i] = i < m ? pts.x[b + i] : 0.0f;
+            yb[i] = i < m ? pts.y[b + i] : 0.0f;
+            best[i] = FLT_MAX;
+            lab[i]  = 0;
+        }
+        for (int c = 0; c < k; ++c) {
+            const float ux = cx[c], uy = cy[c];
+            for (int i = 0; i < KMEANS_BLOCK; ++i) {   // vectorized
+                float dx = xb[i] - ux, dy = yb[i] - uy;
+                float d = dx * dx + dy * dy;
+                int closer = d < best[i];
+                best[i] = min(d, best[i]);
+                lab[i]  = closer ? c : lab[i];
+            }
+        }
+        for (int i = 0; i < m; ++i) {
+            sx[lab[i]] += xb[i];
+            sy[lab[i]] += yb[i];
+            cnt[lab[i]]++;
+        }
+    }
+}
+
+// k-means++ seeding on an evenly spaced sample of the points
+inline void kmeans_seed(const IncidentSet& pts, int k, vector<float>& cx, vector<float>& cy) {
+    size_t n = pts.size();
+    size_t step = max((size_t)1, n / KMEANS_SEED_SAMPLE);
+    vector<float> sx, sy;
+    for (size_t i = 0; i < n; i += step) {
+        sx.push_back(pts.x[i]);
+        sy.push_back(pts.y[i]);
+    }
+    KMeansRng rng;
+    size_t first = rng.next() % sx.size();
+    cx.assign(1, sx[first]);
+    cy.assign(1, sy[first]);
+    vector<double> d2(sx.size(), 1e300);
+    while ((int)cx.size() < k) {
+        double total = 0;
+        for (size_t i = 0; i < sx.size(); ++i) {
+            double dx = sx[i] - cx.back(), dy = sy[i] - cy.back();
+            d2[i] = min(d2[i], dx * dx + dy * dy);
+            total += d2[i];
+        }
+        size_t pick = 0;
+        double r = rng.unit() * total;
+        for (size_t i = 0; i < sx.size(); ++i) {
+            r -= d2[i];
+            if (r <= 0) { pick = i; break; }
+        }
+        cx.push_back(sx[pick]);
+        cy.push_back(sy[pick]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// kmeans()
+// ---------------------------------------------------------------------------
+// Purpose : Cluster pts into k groups using `threads` threads. If `warm`
+//           holds k centres they are the starting point.
+// ---------------------------------------------------------------------------
+inline KMeansResult kmeans(const IncidentSet& pts, int k, const KMeansResult* warm,
+                           int threads) {
+    auto t0 = chrono::steady_clock::now();
+    KMeansResult r;
+    size_t n = pts.size();
+    if (n == 0 || k <= 0) return r;
+    if ((size_t)k > n) k = (int)n;
+    if (threads < 1) threads = 1;
+    if ((size_t)threads > n / 4096 + 1) threads = (int)(n / 4096 + 1);
+
+    if (warm && (int)warm->cx.size() == k) {
+        r.cx = warm->cx;
+        r.cy = warm->cy;
+        r.warm = true;
+    } else {
+        kmeans_seed(pts, k, r.cx, r.cy);
+    }
+
+    vector<double> sx(threads * k), sy(threads * k);
+    vector<long long> cnt(threads * k);
+    KMeansRng rng;
+    for (r.iters = 1; r.iters <= KMEANS_MAX_ITERS; ++r.iters) {
+        fill(sx.begin(), sx.end(), 0.0);
+        fill(sy.begin(), sy.end(), 0.0);
+        fill(cnt.begin(), cnt.end(), 0LL);
+        vector<thread> pool;
+        for (int t = 1; t < threads; ++t)
+            pool.emplace_back(kmeans_assign, cref(pts), n * t / threads, n * (t + 1) / threads,
+                              r.cx.data(), r.cy.data(), k,
+                              &sx[t * k], &sy[t * k], &cnt[t * k]);
+        kmeans_assign(pts, 0, n / threads, r.cx.data(), r.cy.data(), k,
+                      &sx[0], &sy[0], &cnt[0]);
+        for (thread& th : pool) th.join();
+
+        // Update step: new centre = mean of its points
+        float moved = 0;
+        r.count.assign(k, 0);
+        for (int c = 0; c < k; ++c) {
+            double mx = 0, my = 0;
+            for (int t = 0; t < threads; ++t) {
+                mx += sx[t * k + c];
+                my += sy[t * k + c];
+                r.count[c] += cnt[t * k + c];
+            }
+            float nx, ny;
+            if (r.count[c] > 0) {
+                nx = (float)(mx / r.count[c]);
+                ny = (float)(my / r.count[c]);
+            } else {                              // empty: restart elsewhere
+                size_t i = rng.next() % n;
+                nx = pts.x[i];
+                ny = pts.y[i];
+            }
+            moved = max(moved, max(fabsf(nx - r.cx[c]), fabsf(ny - r.cy[c])));
+            r.cx[c] = nx;
+            r.cy[c] = ny;
+        }
+        if (moved < KMEANS_EPS) break;
+    }
+    if (r.iters > KMEANS_MAX_ITERS) r.iters = KMEANS_MAX_ITERS;
+    r.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    return r;
+}
+
+// ---------------------------------------------------------------------------
+// load_incidents()
+// ---------------------------------------------------------------------------
+// Purpose : Read INCIDENT_FILE into one IncidentSet per band.
+// Return  : number of incidents read (bad lines are skipped).
+// ---------------------------------------------------------------------------
+inline long long load_incidents(const char* filename, IncidentSet band[STAGING_BANDS]) {
+    for (int b = 0; b < STAGING_BANDS; ++b) {
+        band[b].x.clear();
+        band[b].y.clear();
+    }
+    FILE* f = fopen(filename, "r");
+    if (!f) return 0;
+    long long n = 0;
+    char buf[128];
+    while (fgets(buf, sizeof buf, f)) {
+        int h, m;
+        char* p = buf;
+        if (sscanf(p, "%d:%d", &h, &m) != 2 || h < 0 || h > 23) continue;
+        p = strchr(p, ' ');
+        if (!p) continue;
+        char* end;
+        float x = strtof(p, &end);
+        if (end == p) continue;
+        p = end;
+        float y = strtof(p, &end);
+        if (end == p) continue;
+        IncidentSet& s = band[h * STAGING_BANDS / 24];
+        s.x.push_back(x);
+        s.y.push_back(y);
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// StagingService
+// ---------------------------------------------------------------------------
+// The refresh thread and the latest plan. Only plan (the pointer) and
+// units/dirty/stop are shared, all under `m`.
+// ---------------------------------------------------------------------------
+struct StagingService {
+    mutex m;
+    condition_variable wake;
+    shared_ptr<const StagingPlan> plan;   // nullptr until the first refresh
+    int  units = 0;                       // k wanted
+    bool dirty = false;
+    bool stop  = false;
+    bool busy  = false;                   // a refresh is running
+    thread worker;
+
+    // One refresh: read the incidents, cluster every band, publish
+    void refresh(int k) {
+        IncidentSet band[STAGING_BANDS];
+        long long n = load_incidents(INCIDENT_FILE, band);
+        shared_ptr<const StagingPlan> old = current();
+        auto next = make_shared<StagingPlan>();
+        next->k = k;
+        next->incidents = n;
+        int threads = (int)thread::hardware_concurrency();
+        for (int b = 0; b < STAGING_BANDS; ++b) {
+            const KMeansResult* warm = (old && old->k == k) ? &old->band[b] : nullptr;
+            next->band[b] = kmeans(band[b], k, warm, threads);
+        }
+        lock_guard<mutex> lock(m);
+        plan = next;
+    }
+
+    void run() {
+        unique_lock<mutex> lock(m);
+        while (!stop) {
+            wake.wait_for(lock, chrono::minutes(STAGING_REFRESH_MIN),
+                          [&] { return stop || dirty; });
+            if (stop) break;
+            dirty = false;
+            int k = units;
+            if (k <= 0) continue;
+            busy = true;
+            lock.unlock();
+            refresh(k);                     // dispatch keeps running meanwhile
+            lock.lock();
+            busy = false;
+        }
+    }
+
+    shared_ptr<const StagingPlan> current() {
+        lock_guard<mutex> lock(m);
+        return plan;
+    }
+};
+
+inline StagingService gStaging;
+
+// The published plan; the incidents are only in memory during a refresh
+inline MemRegister gStagingMem(MEM_AMBULANCES, "staging plan", [] {
+    shared_ptr<const StagingPlan> p = gStaging.current();
+    size_t b = 0;
+    if (p) {
+        b = sizeof(StagingPlan);
+        for (const KMeansResult& r : p->band)
+            b += mem_vector(r.cx) + mem_vector(r.cy) + mem_vector(r.count);
+    }
+    return b;
+});
+
+// Start the refresh thread (main, before the menu)
+inline void staging_start() {
+    gStaging.worker = thread([] { gStaging.run(); });
+}
+
+// Stop it (main, before returning); waits for a refresh in progress
+inline void staging_finish() {
+    {
+        lock_guard<mutex> lock(gStaging.m);
+        gStaging.stop = true;
+    }
+    gStaging.wake.notify_one();
+    if (gStaging.worker.joinable()) gStaging.worker.join();
+}
+
+// The number of units changed (or is first known): plan again now
+inline void staging_set_units(int k) {
+    {
+        lock_guard<mutex> lock(gStaging.m);
+        if (k == gStaging.units && gStaging.plan) return;
+        gStaging.units = k;
+        gStaging.dirty = true;
+    }
+    gStaging.wake.notify_one();
+}
+
+// Band of the current local time
+inline int staging_current_band() {
+    time_t t = time(nullptr);
+    tm* lt = localtime(&t);
+    return (lt ? lt->tm_hour : 0) * STAGING_BANDS / 24;
+}
+
+// Centres of a band, busiest first: the unit at place i in the rotation is
+// sent to centre order[i]
+inline vector<int> staging_order(const KMeansResult& r) {
+    vector<int> order(r.cx.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+    stable_sort(order.begin(), order.end(),
+                [&](int a, int c) { return r.count[a] > r.count[c]; });
+    return order;
+}
+
+// Staging point of the unit at place `rank` in the rotation, now; false if
+// there is no plan (or fewer points than units)
+inline bool staging_point(int rank, float& x, float& y) {
+    shared_ptr<const StagingPlan> p = gStaging.current();
+    if (!p) return false;
+    const KMeansResult& r = p->band[staging_current_band()];
+    vector<int> order = staging_order(r);
+    if (rank < 0 || rank >= (int)order.size()) return false;
+    x = r.cx[order[rank]];
+    y = r.cy[order[rank]];
+    return true;
+}
+
+// --------------------------------------------------------------------------
+// print_staging()
+// --------------------------------------------------------------------------
+// Purpose : Show the staging points of the current band, strongest first.
+//           `plates` are the units in rotation order: the unit next up is
+//           listed against the busiest point.
+// --------------------------------------------------------------------------
+inline void print_staging(const vector<string>& plates) {
+    shared_ptr<const StagingPlan> p = gStaging.current();
+    if (!p) {
+        bool busy;
+        {
+            lock_guard<mutex> lock(gStaging.m);
+            busy = gStaging.busy || gStaging.dirty;
+        }
+        cout << (busy ? "Staging plan is being computed, try again shortly.\n"
+                      : "No staging plan (no units or no " INCIDENT_FILE ").\n");
+        return;
+    }
+    int b = staging_current_band();
+    const KMeansResult& r = p->band[b];
+    cout << "Staging points " << setfill('0') << setw(2) << b * 24 / STAGING_BANDS
+         << ":00-" << setw(2) << (b + 1) * 24 / STAGING_BANDS << ":00" << setfill(' ')
+         << " (" << p->incidents << " incidents on file, k = " << p->k << ")\n";
+    line();
+    if (r.cx.empty()) {
+        cout << "No incidents in this time band.\n";
+        return;
+    }
+    vector<int> order = staging_order(r);
+    long long total = 0;
+    for (long long c : r.count) total += c;
+    cout << left << setw(12) << "Unit" << setw(20) << "Stage at (x, y km)"
+         << "Share of incidents" << "\n";
+    for (size_t i = 0; i < order.size(); ++i) {
+        int c = order[i];
+        char pos[32];
+        snprintf(pos, sizeof pos, "(%.2f, %.2f)", r.cx[c], r.cy[c]);
+        cout << left << setw(12) << (i < plates.size() ? plates[i] : "-")
+             << setw(20) << pos << fixed << setprecision(1)
+             << (total ? 100.0 * r.count[c] / total : 0.0) << " %\n";
+        cout.unsetf(ios::floatfield);
+    }
+    cout << "(" << r.iters << " iteration(s), " << fixed << setprecision(1) << r.ms
+         << " ms, " << (r.warm ? "warm start" : "cold start") << ")\n";
+    cout.unsetf(ios::floatfield);
+}
+
+#endif
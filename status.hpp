@@ -0,0 +1,305 @@
+#ifndef STATUS_HPP
+#define STATUS_HPP
+
+#include "utils.hpp"
+#include "patient.hpp"
+#include "supply.hpp"
+#include "emergency.hpp"
+#include "ambulance.hpp"
+#include "loader.hpp"   // which roles are loaded yet
+#include "events.hpp"   // refreshed after every published change
+#include "memory.hpp"   // accounting
+#include <atomic>       // board version and words
+#include <cstdint>
+#include <ctime>        // for time (last update)
+#include <thread>       // for this_thread::yield (reader retry)
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>    // file mapping
+#else
+#include <fcntl.h>      // for open
+#include <sys/mman.h>   // for mmap
+#include <sys/stat.h>   // for fstat (reader checks the size)
+#include <unistd.h>     // for ftruncate, getpid
+#endif
+
+// ---------------------------------------------------------------------------
+// status.hpp
+// ---------------------------------------------------------------------------
+// A small status board for wallboards and monitoring agents, in shared
+// memory: the file STATUS_FILE, mapped by this process and by any reader.
+// It holds a fixed-layout StatusData: queue depths, the most critical
+// emergency, the next ambulance, supply batches and the number of supply
+// types low on stock.
+//
+// Seqlock (as the event bus slots, events.hpp): the one writer (the menu
+// thread) makes the version odd, stores the data words, and makes it even
+// again. A reader copies the words between two reads of the version and
+// retries if it was odd or changed. Readers take no lock and never write,
+// so any number of them, at any rate, cost this process nothing.
+//
+// The board is rewritten after every published change (a bus listener) and
+// after every menu, in O(1): it only reads counters and the tops of the
+// containers. A role that is not loaded yet shows as -1 / empty.
+//
+//   main --status    print the board of a running instance and exit
+// ---------------------------------------------------------------------------
+
+#define STATUS_FILE "status_board.bin"
+
+const uint32_t STATUS_MAGIC = 0x48534231;   // "HSB1"
+
+// The board's data. Only fixed-size fields, so other programs can map the
+// same layout; grow it by adding fields at the end (STATUS_LAYOUT = size).
+struct StatusData {
+    int64_t updated;           // time of the last update (seconds)
+    int64_t changes;           // changes published so far by this run
+    int32_t pid;               // writer process
+    int32_t running;           // 0 once the writer has exited
+    int32_t patientsWaiting;   // main queue + room 2 + spilled to disk
+    int32_t room2Waiting;
+    int32_t emergencies;
+    int32_t topPriority;       // -1 = no case
+    int32_t ambulances;
+    int32_t supplyBatches;
+    int32_t lowStockTypes;     // types below SUPPLY_LOW_STOCK units
+    int32_t reserved;
+    char    topPatient[40];    // most critical case (may be truncated)
+    char    topType[24];
+    char    nextPlate[16];     // next ambulance in the rotation
+};
+
+const int STATUS_WORDS = sizeof(StatusData) / sizeof(uint64_t);
+const uint32_t STATUS_LAYOUT = sizeof(StatusData);
+static_assert(sizeof(StatusData) % sizeof(uint64_t) == 0, "StatusData must be whole words");
+static_assert(atomic<uint64_t>::is_always_lock_free, "board words must be lock-free");
+
+struct StatusBoard {
+    uint32_t magic;            // STATUS_MAGIC once initialised
+    uint32_t layout;           // STATUS_LAYOUT of the writer
+    atomic<uint64_t> version;  // odd while the words are being written
+    atomic<uint64_t> word[STATUS_WORDS];
+};
+
+// ---------------------------------------------------------------------------
+// StatusMap
+// ---------------------------------------------------------------------------
+// The board file mapped into this process, for writing (created and sized
+// if needed) or for reading only.
+// ---------------------------------------------------------------------------
+struct StatusMap {
+    StatusBoard* board = nullptr;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+
+    bool open(const char* path, bool write) {
+        file = CreateFileA(path, write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                           write ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        mapping = CreateFileMappingA(file, nullptr, write ? PAGE_READWRITE : PAGE_READONLY,
+                                     0, write ? (DWORD)sizeof(StatusBoard) : 0, nullptr);
+        if (mapping)
+            board = (StatusBoard*)MapViewOfFile(mapping, write ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                                0, 0, sizeof(StatusBoard));
+        if (!board) close();
+        return board != nullptr;
+    }
+
+    void close() {
+        if (board) UnmapViewOfFile(board);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        board = nullptr;
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+    }
+#else
+    bool open(const char* path, bool write) {
+        int fd = ::open(path, write ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = write ? ftruncate(fd, sizeof(StatusBoard)) == 0
+                        : fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(StatusBoard);
+        void* p = ok ? mmap(nullptr, sizeof(StatusBoard), write ? PROT_READ | PROT_WRITE : PROT_READ,
+                            MAP_SHARED, fd, 0)
+                     : MAP_FAILED;
+        ::close(fd);                       // the mapping stays valid
+        if (p == MAP_FAILED) return false;
+        board = (StatusBoard*)p;
+        return true;
+    }
+
+    void close() {
+        if (board) munmap(board, sizeof(StatusBoard));
+        board = nullptr;
+    }
+#endif
+};
+
+inline StatusMap gStatus;   // the writer's mapping (menu thread only)
+
+inline MemRegister gStatusMem(MEM_SHARED, "status board (shared)",
+                              [] { return gStatus.board ? sizeof(StatusBoard) : 0; });
+
+inline bool status_loaded(LoadRole r) {
+    return gLoader.roles[r].done.load(memory_order_acquire);
+}
+
+// Copy a C string into a fixed field, '\0'-padded
+inline void status_copy(char* dst, size_t cap, const char* src) {
+    size_t i = 0;
+    for (; i + 1 < cap && src[i]; ++i) dst[i] = src[i];
+    for (; i < cap; ++i) dst[i] = '\0';
+}
+
+// ---------------------------------------------------------------------------
+// status_publish()
+// ---------------------------------------------------------------------------
+// Purpose : Fill a StatusData from the containers and store it on the
+//           board under the seqlock. Menu thread only; O(1).
+// ---------------------------------------------------------------------------
+inline void status_publish(bool running = true) {
+    StatusBoard* b = gStatus.board;
+    if (!b) return;
+    StatusData d;
+    memset(&d, 0, sizeof d);
+    d.updated = (int64_t)time(nullptr);
+    d.changes = (int64_t)gEvents.head.load(memory_order_relaxed);
+#ifdef _WIN32
+    d.pid = (int32_t)GetCurrentProcessId();
+#else
+    d.pid = (int32_t)getpid();
+#endif
+    d.running = running;
+    d.patientsWaiting = d.room2Waiting = d.emergencies = d.topPriority = -1;
+    d.ambulances = d.supplyBatches = d.lowStockTypes = -1;
+    if (status_loaded(LOAD_PATIENTS)) {
+        d.patientsWaiting = patients_waiting();
+        d.room2Waiting = gPatientsRoom2.count;
+    }
+    if (status_loaded(LOAD_EMERGENCIES)) {
+        d.emergencies = gEmerg.size();
+        if (!gEmerg.isEmpty()) {
+            EmergencyCase top = gEmerg.top();
+            d.topPriority = top.priority;
+            status_copy(d.topPatient, sizeof d.topPatient, gEmerg.str(top.patient));
+            status_copy(d.topType, sizeof d.topType, gEmerg.str(top.type));
+        }
+    }
+    if (status_loaded(LOAD_AMBULANCES)) {
+        d.ambulances = gAmb.count;
+        if (!gAmb.isEmpty())
+            status_copy(d.nextPlate, sizeof d.nextPlate, gAmb.data[gAmb.head].plate);
+    }
+    if (status_loaded(LOAD_SUPPLIES)) {
+        d.supplyBatches = gSupplies.top + 1;
+        d.lowStockTypes = gSupplies.lowTypes;
+    }
+
+    uint64_t w[STATUS_WORDS];
+    memcpy(w, &d, sizeof d);
+    uint64_t v = b->version.load(memory_order_relaxed);
+    b->version.store(v + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (int k = 0; k < STATUS_WORDS; ++k) b->word[k].store(w[k], memory_order_relaxed);
+    b->version.store(v + 2, memory_order_release);
+}
+
+// ---------------------------------------------------------------------------
+// status_read()
+// ---------------------------------------------------------------------------
+// Purpose : Reader side: a consistent copy of the board's data.
+// Return  : false if the board is not initialised or has another layout,
+//           or if no consistent copy was had in many tries.
+// ---------------------------------------------------------------------------
+inline bool status_read(const StatusBoard* b, StatusData& out) {
+    if (b->magic != STATUS_MAGIC || b->layout != STATUS_LAYOUT) return false;
+    for (int tries = 0; tries < 100000; ++tries) {
+        uint64_t v = b->version.load(memory_order_acquire);
+        if (v & 1) {                       // being written
+            this_thread::yield();
+            continue;
+        }
+        uint64_t w[STATUS_WORDS];
+        for (int k = 0; k < STATUS_WORDS; ++k) w[k] = b->word[k].load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (b->version.load(memory_order_relaxed) == v) {
+            memcpy(&out, w, sizeof out);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Map the board, publish the first state, refresh after every change
+inline void status_start() {
+    if (!gStatus.open(STATUS_FILE, true)) {
+        cout << "[Error] Cannot map " << STATUS_FILE << ". No status board.\n";
+        return;
+    }
+    StatusBoard* b = gStatus.board;
+    b->magic = 0;                          // readers wait until it is whole
+    b->layout = STATUS_LAYOUT;
+    if (b->version.load(memory_order_relaxed) & 1)   // a writer died mid-update
+        b->version.store(0, memory_order_relaxed);
+    status_publish();
+    b->magic = STATUS_MAGIC;
+}
+
+// Refresh after every published change, while the board is mapped
+inline EventListen gStatusListen([](const Event&, const string&, const string&) {
+    status_publish();
+});
+
+// Mark the board as no longer running and unmap it
+inline void status_finish() {
+    if (!gStatus.board) return;
+    status_publish(false);
+    gStatus.close();
+}
+
+// ---------------------------------------------------------------------------
+// status_cli()
+// ---------------------------------------------------------------------------
+// Purpose : "--status": print the board of the instance in this directory.
+// Return  : process exit code.
+// ---------------------------------------------------------------------------
+inline int status_cli() {
+    StatusMap m;
+    StatusData d;
+    if (!m.open(STATUS_FILE, false)) {
+        cerr << "[Error] No status board (" << STATUS_FILE << ") here.\n";
+        return 1;
+    }
+    bool ok = status_read(m.board, d);
+    m.close();
+    if (!ok) {
+        cerr << "[Error] Status board is not readable (not started, or another version).\n";
+        return 1;
+    }
+    auto num = [](int32_t v) { return v < 0 ? string("-") : to_string(v); };
+    long long age = (long long)time(nullptr) - d.updated;
+    cout << "Instance            : pid " << d.pid
+         << (d.running ? "" : " (not running)") << ", updated " << age
+         << " s ago, " << d.changes << " change(s)\n";
+    cout << "Patients waiting    : " << num(d.patientsWaiting)
+         << " (room 2: " << num(d.room2Waiting) << ")\n";
+    cout << "Emergencies pending : " << num(d.emergencies);
+    if (d.topPriority >= 0)
+        cout << ", most critical: " << d.topPatient << " (" << d.topType
+             << ") priority " << d.topPriority;
+    cout << "\n";
+    cout << "Ambulances          : " << num(d.ambulances);
+    if (d.nextPlate[0]) cout << ", next up: " << d.nextPlate;
+    cout << "\n";
+    cout << "Supply batches      : " << num(d.supplyBatches) << ", types below "
+         << SUPPLY_LOW_STOCK << " units: " << num(d.lowStockTypes) << "\n";
+    return 0;
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef STRPOOL_HPP
+#define STRPOOL_HPP
+
+#include "utils.hpp"
+#include <cstdint>    // for uint32_t
+#include <vector>     // for the pool's byte buffer
+#include <algorithm>  // for max (compaction threshold)
+
+// ---------------------------------------------------------------------------
+// strpool.hpp
+// ---------------------------------------------------------------------------
+// Compact string storage shared by the record structs of every role.
+//
+// Records used to reserve fixed char arrays (e.g. 50 bytes for a name) even
+// though most names are short, and long names were silently cut off by
+// strncpy. Instead, each string field is now a 16-byte PoolStr:
+//
+//   - Short strings (up to PoolStr::INLINE_CAP chars) are stored inline,
+//     directly inside the record ("small-string inlining").
+//   - Longer strings are stored once in the owning container's StringPool,
+//     and the record only keeps their offset and length.
+//
+// Rules of use:
+//   - A PoolStr is only meaningful together with the pool of the container
+//     that created it (use the container's str() helper to read it).
+//   - The pointer returned by StringPool::get() stays valid until the next
+//     intern() or compaction on that pool, so print/copy it right away.
+// ---------------------------------------------------------------------------
+
+struct PoolStr {
+    static const uint32_t INLINE_CAP = 11;   // max chars stored inline
+
+    uint32_t len = 0;          // string length (without '\0')
+    union {
+        char     sso[12] = {}; // inline chars + '\0' when len <= INLINE_CAP
+        uint32_t off;          // byte offset into the pool otherwise
+    };
+
+    bool isInline() const { return len <= INLINE_CAP; }
+};
+
+struct StringPool {
+    // Out-of-line characters, each string followed by its own '\0' so that
+    // get() can hand out plain C strings for cout/strcmp.
+    vector<char> buf;
+
+    // ----------------------------------------------------------------------
+    // intern()
+    // ----------------------------------------------------------------------
+    // Purpose : Store a string and return the compact reference to it.
+    // Note    : Short strings never touch the pool at all.
+    // ----------------------------------------------------------------------
+    PoolStr intern(const char* s, size_t n) {
+        PoolStr r;
+        r.len = (uint32_t)n;
+        if (r.isInline()) {
+            memcpy(r.sso, s, n);
+            r.sso[n] = '\0';
+            return r;
+        }
+        r.off = (uint32_t)buf.size();
+        buf.insert(buf.end(), s, s + n);
+        buf.push_back('\0');
+        return r;
+    }
+
+    PoolStr intern(const string& s) { return intern(s.data(), s.size()); }
+    PoolStr intern(const char* s)   { return intern(s, strlen(s)); }
+
+    // Read a string back as a C string (see the lifetime note above).
+    const char* get(const PoolStr& s) const {
+        return s.isInline() ? s.sso : &buf[s.off];
+    }
+
+    // Re-intern a string that currently lives in another pool (used when
+    // compacting, or when a record moves between containers).
+    PoolStr copyFrom(const StringPool& src, const PoolStr& s) {
+        if (s.isInline()) return s;
+        return intern(src.get(s), s.len);
+    }
+
+    // Bytes currently held out-of-line (live + garbage).
+    size_t bytes() const { return buf.size(); }
+
+    void clear() { buf.clear(); }
+};
+
+// ---------------------------------------------------------------------------
+// Pool compaction policy
+// ---------------------------------------------------------------------------
+// Removing a record does not free its pool bytes straight away. Instead each
+// container rebuilds its pool from the live records once the pool has
+// doubled since the last rebuild, so the cost stays amortised O(1) per insert.
+// ---------------------------------------------------------------------------
+const size_t POOL_COMPACT_MIN = 4096;   // never compact below this size
+
+#endif
@@ -2,9 +2,21 @@
 #define SUPPLY_HPP
 
 #include "utils.hpp"
+#include "strpool.hpp"
+#include "events.hpp"   // change notifications
+#include "cdc.hpp"      // change-data-capture stream
+#include "metrics.hpp"  // supply use per minute
+#include "memory.hpp"   // accounting and the role's memory limit
+#include <unordered_map> // units on hand per type
 
 #define SUPPLY_FILE "supplies.txt"
 
+#ifndef HOSPITAL_SUPPLY_LOW_STOCK
+#define HOSPITAL_SUPPLY_LOW_STOCK 20
+#endif
+
+const long long SUPPLY_LOW_STOCK = HOSPITAL_SUPPLY_LOW_STOCK;   // units
+
 // ==========================================================================
 // ROLE 2: MEDICAL SUPPLY MANAGER (STACK)
 // --------------------------------------------------------------------------
@@ -16,12 +28,15 @@
 //   - This gives O(1) push (add supply) and pop (use supply).
 //   - Each element represents one batch of a particular supply type.
 //   - "Use Last Added Supply" simply pops the most recently added batch.
+//   - Units on hand are also summed per type (hash map), and the number of
+//     types below SUPPLY_LOW_STOCK units (a type used up counts too) is
+//     kept up to date on every push/pop, so it is known in O(1).
 // ==========================================================================
 
 struct Supply {
-    char type[30];   // Name of supply type (e.g. "Surgical Masks")
-    int  quantity;   // Quantity in this batch (must be >= 1)
-    char batch[20];  // Batch identifier (e.g. "MASK-BATCH-001")
+    PoolStr type;      // Name of supply type (e.g. "Surgical Masks")
+    int     quantity;  // Quantity in this batch (must be >= 1)
+    PoolStr batch;     // Batch identifier (e.g. "MASK-BATCH-001")
 };
 
 struct SupplyStack {
@@ -31,6 +46,13 @@ struct SupplyStack {
     // top index: -1 means the stack is empty.
     int top = -1; // -1 means empty
 
+    // Out-of-line storage for long strings (see strpool.hpp)
+    StringPool pool;
+    size_t compactAt = POOL_COMPACT_MIN;
+
+    unordered_map<string, long long> units;   // type -> units on hand
+    int lowTypes = 0;                         // types below SUPPLY_LOW_STOCK
+
     // Check if the stack is full
     bool isFull()  const { return top == MAX_SUPPLIES - 1; }
 
@@ -38,7 +60,51 @@ struct SupplyStack {
     bool isEmpty() const { return top == -1; }
 
     // Reset stack to empty state
-    void clear() { top = -1; }
+    void clear() {
+        top = -1;
+        pool.clear();
+        compactAt = POOL_COMPACT_MIN;
+        units.clear();
+        lowTypes = 0;
+    }
+
+    // Add d units of a type and keep lowTypes up to date
+    void addUnits(const char* type, long long d) {
+        auto ins = units.insert(make_pair(string(type), 0LL));
+        long long& u = ins.first->second;
+        bool wasLow = !ins.second && u < SUPPLY_LOW_STOCK;
+        u += d;
+        lowTypes += (u < SUPPLY_LOW_STOCK) - wasLow;
+    }
+
+    // Read one of a record's string fields as a C string
+    const char* str(const PoolStr& s) const { return pool.get(s); }
+
+    // ----------------------------------------------------------------------
+    // make()
+    // ----------------------------------------------------------------------
+    // Purpose : Build a Supply whose strings are stored in this stack's
+    //           pool. The record is not pushed yet.
+    // ----------------------------------------------------------------------
+    Supply make(const string& type, int qty, const string& batch) {
+        if (pool.bytes() > compactAt) compact();
+        Supply s;
+        s.type     = pool.intern(type);
+        s.quantity = qty;
+        s.batch    = pool.intern(batch);
+        return s;
+    }
+
+    // Rebuild the pool from the batches still on the stack
+    void compact() {
+        StringPool fresh;
+        for (int i = 0; i <= top; ++i) {
+            data[i].type  = fresh.copyFrom(pool, data[i].type);
+            data[i].batch = fresh.copyFrom(pool, data[i].batch);
+        }
+        pool.buf.swap(fresh.buf);
+        compactAt = max(POOL_COMPACT_MIN, 2 * pool.bytes());
+    }
 
     // ----------------------------------------------------------------------
     // push()
@@ -51,6 +117,7 @@ struct SupplyStack {
         if (isFull()) return false;
         top++;
         data[top] = s;
+        addUnits(str(s.type), s.quantity);
         return true;
     }
 
@@ -65,6 +132,7 @@ struct SupplyStack {
         if (isEmpty()) return false;
         out = data[top];
         top--;
+        addUnits(str(out.type), -out.quantity);
         return true;
     }
 
@@ -84,9 +152,9 @@ struct SupplyStack {
              << "Batch" << "\n";
         line();
         for (int i = top; i >= 0; --i) {
-            cout << left << setw(16) << data[i].type
+            cout << left << setw(16) << str(data[i].type)
                  << setw(10) << data[i].quantity
-                 << data[i].batch << "\n";
+                 << str(data[i].batch) << "\n";
         }
     }
 
@@ -107,9 +175,9 @@ struct SupplyStack {
         }
         for (int i = 0; i <= top; ++i) {
             const Supply& s = data[i];
-            out << s.type     << '\n'
-                << s.quantity << '\n'
-                << s.batch    << '\n';
+            out << str(s.type)  << '\n'
+                << s.quantity   << '\n'
+                << str(s.batch) << '\n';
         }
     }
 
@@ -125,7 +193,7 @@ struct SupplyStack {
     void loadFromFile(const char* filename) {
         ifstream in(filename);
         if (!in) {
-            cout << "[Info] " << filename
+            load_log() << "[Info] " << filename
                  << " not found. Starting with empty supplies.\n";
             clear();
             return;
@@ -143,14 +211,10 @@ struct SupplyStack {
             string sbatch;
             if (!getline(in, sbatch)) break;
 
-            Supply s{};
-            strncpy(s.type,  stype.c_str(),  sizeof(s.type)  - 1);
-            s.quantity = qty;
-            strncpy(s.batch, sbatch.c_str(), sizeof(s.batch) - 1);
-
-            if (!push(s)) break;
+            if (isFull()) break;
+            push(make(stype, qty, sbatch));
         }
-        cout << "[OK] Loaded supplies from " << filename
+        load_log() << "[OK] Loaded supplies from " << filename
              << " (count=" << (top + 1) << ")\n";
     }
 };
@@ -158,6 +222,18 @@ struct SupplyStack {
 // Global stack instance (C++17 inline variable)
 inline SupplyStack gSupplies;
 
+// Memory accounting (memory.hpp)
+inline MemRegister gSupplyMem(MEM_SUPPLIES, "stack array",
+                              [] { return sizeof(gSupplies); });
+inline MemRegister gSupplyPoolMem(MEM_SUPPLIES, "string pool",
+                                  [] { return gSupplies.pool.buf.capacity(); });
+inline MemRegister gSupplyUnitsMem(MEM_SUPPLIES, "units per type", [] {
+    size_t b = mem_hash(gSupplies.units);
+    for (const auto& kv : gSupplies.units) b += mem_string(kv.first);
+    return b;
+});
+inline MemRegister gSupplyCompact(MEM_SUPPLIES, [] { gSupplies.compact(); });
+
 // ====================== UI FUNCTIONS FOR ROLE 2 ============================
 
 // --------------------------------------------------------------------------
@@ -175,21 +251,24 @@ inline void ui_add_supply(){
         cout<<"Supply store is full.\n";
         return;
     }
+    if (!mem_admit_or_report(MEM_SUPPLIES)) return;
 
-    Supply s{};
+    string type, batch;
+    int qty = 0;
     cout<<"Enter Supply Type: ";
-    safe_getline(s.type, 30);
+    safe_getline(type);
 
     // Quantity validation: must be a number and at least 1
     while(true){
         cout<<"Enter Quantity (>= 1): ";
-        if(!(cin>>s.quantity)){
+        if(!(cin>>qty)){
+            if(cin.eof()) return;
             cin.clear();
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
             cout<<"Invalid input. Please enter a number.\n";
             continue;
         }
-        if(s.quantity < 1){
+        if(qty < 1){
             cout<<"Quantity must be at least 1. Please try again.\n";
             continue;
         }
@@ -198,10 +277,12 @@ inline void ui_add_supply(){
     }
 
     cout<<"Enter Batch: ";
-    safe_getline(s.batch, 20);
+    safe_getline(batch);
 
-    if (gSupplies.push(s)) {
+    if (gSupplies.push(gSupplies.make(type, qty, batch))) {
         cout << "Recorded (stack top).\n";
+        publish_event(EV_SUPPLIES, EV_INSERT, type.c_str(), qty, "",
+                      cdc_image({ type, to_string(qty), batch }));
         gSupplies.saveToFile(SUPPLY_FILE);    // auto-save after adding
     } else {
         cout << "Failed to add supply.\n";
@@ -223,16 +304,19 @@ inline void ui_use_last_supply() {
         return;
     }
 
-    Supply used{};
+    Supply used;
     if (!gSupplies.pop(used)) {
         cout << "Failed to use supply.\n";
         return;
     }
 
     cout << "Using last added supply batch:\n";
-    cout << "  Type : " << used.type << "\n";
+    cout << "  Type : " << gSupplies.str(used.type) << "\n";
     cout << "  Qty  : " << used.quantity << "\n";
-    cout << "  Batch: " << used.batch << "\n";
+    cout << "  Batch: " << gSupplies.str(used.batch) << "\n";
+    publish_event(EV_SUPPLIES, EV_REMOVE, gSupplies.str(used.type), used.quantity,
+                  cdc_image({ gSupplies.str(used.type), to_string(used.quantity),
+                              gSupplies.str(used.batch) }), "");
 
     gSupplies.saveToFile(SUPPLY_FILE);
 }
@@ -260,6 +344,7 @@ inline void menu_supplies() {
 
         int ch;
         if (!(cin >> ch)) {
+            if (cin.eof()) return;          // end of input
             cin.clear();
             cin.ignore(numeric_limits<streamsize>::max(), '\n');
             continue;
@@ -11,7 +11,7 @@
 // It provides:
 //   - Global configuration constants for array sizes
 //   - A simple line() function for formatting console output
-//   - A safe_getline() function to read C-style strings from input safely
+//   - safe_getline() functions to read a line of input safely
 // ---------------------------------------------------------------------------
 
 #include <iostream>   // for cin, cout
@@ -32,11 +32,27 @@ using namespace std;
 //   MAX_SUPPLIES   -> maximum number of supply records in the supply stack
 //   MAX_EMERG      -> maximum number of emergency records in the heap
 //   MAX_AMBULANCES -> maximum number of ambulances in the circular queue
+//
+// Each size can be overridden at build time, e.g. the benchmark program
+// uses -DHOSPITAL_MAX_EMERG=4096 to test queues larger than the default.
 // ---------------------------------------------------------------------------
-const int MAX_PATIENTS   = 100;   // Role 1 (Queue)
-const int MAX_SUPPLIES   = 100;   // Role 2 (Stack)
-const int MAX_EMERG      = 100;   // Role 3 (Priority Queue)
-const int MAX_AMBULANCES = 20;    // Role 4 (Circular Queue)
+#ifndef HOSPITAL_MAX_PATIENTS
+#define HOSPITAL_MAX_PATIENTS   100
+#endif
+#ifndef HOSPITAL_MAX_SUPPLIES
+#define HOSPITAL_MAX_SUPPLIES   100
+#endif
+#ifndef HOSPITAL_MAX_EMERG
+#define HOSPITAL_MAX_EMERG      100
+#endif
+#ifndef HOSPITAL_MAX_AMBULANCES
+#define HOSPITAL_MAX_AMBULANCES 20
+#endif
+
+const int MAX_PATIENTS   = HOSPITAL_MAX_PATIENTS;    // Role 1 (Queue)
+const int MAX_SUPPLIES   = HOSPITAL_MAX_SUPPLIES;    // Role 2 (Stack)
+const int MAX_EMERG      = HOSPITAL_MAX_EMERG;       // Role 3 (Priority Queue)
+const int MAX_AMBULANCES = HOSPITAL_MAX_AMBULANCES;  // Role 4 (Circular Queue)
 
 // ---------------------------------------------------------------------------
 // line()
@@ -51,6 +67,19 @@ inline void line(char ch = '-', int n = 60) {
     cout << "\n";
 }
 
+// ---------------------------------------------------------------------------
+// load_log()
+// ---------------------------------------------------------------------------
+// Purpose : Stream for the messages of the loadFromFile() functions. It is
+//           cout, except while a role is loaded by the loader (loader.hpp),
+//           which collects the messages of each load and shows them when
+//           the role is first opened. Per thread, so a background load never
+//           writes into the menu.
+// ---------------------------------------------------------------------------
+inline thread_local ostream* tLoadLog = &cout;
+
+inline ostream& load_log() { return *tLoadLog; }
+
 // ---------------------------------------------------------------------------
 // safe_getline()
 // ---------------------------------------------------------------------------
@@ -86,4 +115,21 @@ inline void safe_getline(char* buf, int cap) {
     }
 }
 
+// ---------------------------------------------------------------------------
+// safe_getline() (std::string version)
+// ---------------------------------------------------------------------------
+// Purpose : Same as above, but reads into a std::string so there is no
+//           length limit. Records keep their text in a string pool
+//           (strpool.hpp), so long names no longer need to be cut off.
+// ---------------------------------------------------------------------------
+inline void safe_getline(string& s) {
+    s.clear();
+    if (!getline(cin, s)) {
+        cin.clear();
+        s.clear();
+    }
+    // Strip newline or carriage return characters at the end
+    while (!s.empty() && (s.back() == '\n' || s.back() == '\r')) s.pop_back();
+}
+
 #endif